@@ -1,8 +1,132 @@
 #include "binary_protocol.h"
+#include "columnar_snapshot.h"
 #include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <cstdlib>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+// 列式编码的字符串列，按此顺序写入（时间戳单独编码）
+typedef std::string TransactionRecord::*StringField;
+
+const StringField kRecordStringFields[] = {
+    &TransactionRecord::trans_id,
+    &TransactionRecord::item_id,
+    &TransactionRecord::item_name,
+    &TransactionRecord::type,
+    &TransactionRecord::manager_id,
+    &TransactionRecord::note,
+    &TransactionRecord::category,
+    &TransactionRecord::model,
+    &TransactionRecord::unit,
+    &TransactionRecord::partner_id,
+    &TransactionRecord::partner_name,
+    &TransactionRecord::warehouse_id,
+    &TransactionRecord::document_no
+};
+
+const size_t kRecordStringFieldCount = sizeof(kRecordStringFields) / sizeof(kRecordStringFields[0]);
+
+// 时间戳列编码：1-4 为统一格式（见 ColumnarSnapshot::parseTimestamp）的毫秒差分，
+// TS_MIXED_FORMATS 为逐条格式加毫秒差分，TS_STRING_TABLE 表示时间戳作为最后一个字符串列放入字符串表
+const uint8_t TS_STRING_TABLE = 0x00;
+const uint8_t TS_MIXED_FORMATS = 0xFF;
+
+// 每条记录的定长数值列：数量 4 字节 + 单价 8 字节
+const size_t kRecordNumericBytes = 12;
+
+// 信封部分与其他消息的字节序相同
+void appendUint32(std::vector<uint8_t>& out, uint32_t value) {
+    value = BinaryProtocol::htonl_portable(value);
+    out.push_back((value >> 24) & 0xFF);
+    out.push_back((value >> 16) & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back(value & 0xFF);
+}
+
+void appendString(std::vector<uint8_t>& out, std::string_view str) {
+    appendUint32(out, static_cast<uint32_t>(str.size()));
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+// 列数据为小端（与列式快照相同）
+void storeLittleEndian(uint8_t*& p, uint64_t value, size_t bytes) {
+    for (size_t b = 0; b < bytes; ++b) {
+        *p++ = static_cast<uint8_t>(value >> (8 * b));
+    }
+}
+
+uint64_t loadLittleEndian(const uint8_t*& p, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t b = 0; b < bytes; ++b) {
+        value |= static_cast<uint64_t>(*p++) << (8 * b);
+    }
+    return value;
+}
+
+void appendVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// 顺序读取负载，所有读取都检查剩余长度
+struct PayloadReader {
+    const uint8_t* p;
+    const uint8_t* end;
+
+    size_t remaining() const { return static_cast<size_t>(end - p); }
+
+    bool readByte(uint8_t& value) {
+        if (p >= end) return false;
+        value = *p++;
+        return true;
+    }
+
+    bool readUint32(uint32_t& value) {
+        if (remaining() < 4) return false;
+        value = BinaryProtocol::ntohl_portable((static_cast<uint32_t>(p[0]) << 24) |
+                                               (static_cast<uint32_t>(p[1]) << 16) |
+                                               (static_cast<uint32_t>(p[2]) << 8) |
+                                               static_cast<uint32_t>(p[3]));
+        p += 4;
+        return true;
+    }
+
+    bool readString(std::string& str) {
+        uint32_t length;
+        if (!readUint32(length) || length > remaining()) return false;
+        str.assign(reinterpret_cast<const char*>(p), length);
+        p += length;
+        return true;
+    }
+
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) return false;
+            uint8_t byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+};
+
+} // namespace
 
 // ========== 序列化方法实现 ==========
 
@@ -123,6 +247,110 @@ std::vector<uint8_t> BinaryProtocol::serializeError(uint32_t error_code, const s
     return result;
 }
 
+std::vector<uint8_t> BinaryProtocol::serializeTransactionBatch(const std::vector<uint32_t>& uint32_data,
+                                                              const std::vector<std::string>& string_data,
+                                                              const TransactionRecord* records, size_t count) {
+    return serializeTransactions(MSG_TRANSACTION_BATCH, uint32_data, string_data, records, count);
+}
+
+std::vector<uint8_t> BinaryProtocol::serializeTransactionResult(const std::vector<uint32_t>& uint32_data,
+                                                               const std::vector<std::string>& string_data,
+                                                               const TransactionRecord* records, size_t count) {
+    return serializeTransactions(MSG_TRANSACTION_RESULT, uint32_data, string_data, records, count);
+}
+
+std::vector<uint8_t> BinaryProtocol::serializeTransactions(MessageType type, const std::vector<uint32_t>& uint32_data,
+                                                          const std::vector<std::string>& string_data,
+                                                          const TransactionRecord* records, size_t count) {
+    // 负载格式：[uint32数组][字符串数组][记录数:4][字符串表][索引宽度:1][时间戳编码:1]
+    //          [字符串列...][数量列][单价列][时间戳列]
+    //   字符串表：[条数:4]{[长度:4][内容]}，所有字符串列共享，按首次出现的顺序编号
+    //   字符串列：每条记录一个字符串表索引，宽度按表大小取 1/2/4 字节
+    //   数量列每条 4 字节，单价列每条 8 字节（double 位模式），列数据为小端
+    //   时间戳列：[逐条格式（仅混合格式）]{毫秒差分 zigzag varint}
+    std::vector<uint8_t> payload;
+    appendUint32(payload, static_cast<uint32_t>(uint32_data.size()));
+    for (uint32_t value : uint32_data) {
+        appendUint32(payload, value);
+    }
+    appendUint32(payload, static_cast<uint32_t>(string_data.size()));
+    for (const auto& str : string_data) {
+        appendString(payload, str);
+    }
+    appendUint32(payload, static_cast<uint32_t>(count));
+
+    // 时间戳全部可解析时差分编码，否则作为字符串列放入字符串表
+    std::vector<int64_t> epoch_ms(count);
+    std::vector<uint8_t> formats(count);
+    bool timestamps_parsed = true;
+    bool mixed_formats = false;
+    for (size_t i = 0; i < count && timestamps_parsed; ++i) {
+        timestamps_parsed = ColumnarSnapshot::parseTimestamp(records[i].timestamp, epoch_ms[i], formats[i]);
+        if (i > 0 && formats[i] != formats[0]) mixed_formats = true;
+    }
+    size_t string_columns = kRecordStringFieldCount + (timestamps_parsed ? 0 : 1);
+
+    // 字符串表只引用记录中的字符串，写出后不再使用
+    std::unordered_map<std::string_view, uint32_t> table_index;
+    std::vector<std::string_view> table;
+    std::vector<uint32_t> ids(string_columns * count);
+    for (size_t f = 0; f < string_columns; ++f) {
+        for (size_t i = 0; i < count; ++i) {
+            std::string_view value = f < kRecordStringFieldCount ? records[i].*kRecordStringFields[f]
+                                                                 : records[i].timestamp;
+            auto inserted = table_index.emplace(value, static_cast<uint32_t>(table.size()));
+            if (inserted.second) {
+                table.push_back(value);
+            }
+            ids[f * count + i] = inserted.first->second;
+        }
+    }
+    appendUint32(payload, static_cast<uint32_t>(table.size()));
+    for (const auto& str : table) {
+        appendString(payload, str);
+    }
+
+    uint8_t width = table.size() <= 0x100 ? 1 : (table.size() <= 0x10000 ? 2 : 4);
+    uint8_t timestamp_encoding = TS_STRING_TABLE;
+    if (timestamps_parsed) {
+        timestamp_encoding = mixed_formats ? TS_MIXED_FORMATS : (count > 0 ? formats[0] : 1);
+    }
+    payload.push_back(width);
+    payload.push_back(timestamp_encoding);
+
+    size_t offset = payload.size();
+    payload.resize(offset + ids.size() * width + count * kRecordNumericBytes);
+    uint8_t* p = payload.data() + offset;
+    for (uint32_t id : ids) {
+        storeLittleEndian(p, id, width);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        storeLittleEndian(p, static_cast<uint32_t>(records[i].quantity), 4);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t bits;
+        std::memcpy(&bits, &records[i].unit_price, sizeof(bits));
+        storeLittleEndian(p, bits, 8);
+    }
+
+    if (timestamps_parsed) {
+        if (mixed_formats) {
+            payload.insert(payload.end(), formats.begin(), formats.end());
+        }
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            appendVarint(payload, zigzagEncode(epoch_ms[i] - previous));
+            previous = epoch_ms[i];
+        }
+    }
+
+    auto result = createMessage(type, payload);
+    getStats().messages_sent++;
+    getStats().bytes_sent += result.size();
+
+    return result;
+}
+
 // ========== 反序列化方法实现 ==========
 
 bool BinaryProtocol::parseHeader(const uint8_t* data, size_t size, MessageHeader& header) {
@@ -163,8 +391,8 @@ bool BinaryProtocol::deserializeUint32Array(const uint8_t* payload, size_t paylo
     
     uint32_t array_length = ntohl_portable(readUint32(payload));
     
-    // 验证负载大小
-    if (payload_size < 4 + array_length * 4) {
+    // 验证负载大小（先除后比较，避免长度字段过大时乘法溢出）
+    if (array_length > (payload_size - 4) / 4) {
         getStats().deserialization_errors++;
         return false;
     }
@@ -278,6 +506,112 @@ bool BinaryProtocol::deserializeError(const uint8_t* payload, size_t payload_siz
     return deserializeResponse(payload, payload_size, error_code, error_message);
 }
 
+bool BinaryProtocol::deserializeTransactions(const uint8_t* payload, size_t payload_size,
+                                            std::vector<uint32_t>& uint32_data,
+                                            std::vector<std::string>& string_data,
+                                            std::vector<TransactionRecord>& records) {
+    PayloadReader reader{ payload, payload + payload_size };
+    auto fail = [&records]() {
+        records.clear();
+        getStats().deserialization_errors++;
+        return false;
+    };
+
+    // 信封
+    uint32_t length;
+    if (!reader.readUint32(length) || length > reader.remaining() / 4) {
+        return fail();
+    }
+    uint32_data.resize(length);
+    for (auto& value : uint32_data) {
+        reader.readUint32(value);
+    }
+    if (!reader.readUint32(length) || length > reader.remaining() / 4) {
+        return fail();
+    }
+    string_data.resize(length);
+    for (auto& str : string_data) {
+        if (!reader.readString(str)) {
+            return fail();
+        }
+    }
+
+    // 字符串表
+    uint32_t count;
+    uint32_t table_size;
+    if (!reader.readUint32(count) || !reader.readUint32(table_size) || table_size > reader.remaining() / 4) {
+        return fail();
+    }
+    std::vector<std::string> table(table_size);
+    for (auto& str : table) {
+        if (!reader.readString(str)) {
+            return fail();
+        }
+    }
+
+    uint8_t width;
+    uint8_t timestamp_encoding;
+    if (!reader.readByte(width) || !reader.readByte(timestamp_encoding) ||
+        (width != 1 && width != 2 && width != 4) ||
+        (timestamp_encoding > 4 && timestamp_encoding != TS_MIXED_FORMATS)) {
+        return fail();
+    }
+
+    // 定长列的总长度可以直接校验，校验通过后才按记录数分配
+    size_t string_columns = kRecordStringFieldCount + (timestamp_encoding == TS_STRING_TABLE ? 1 : 0);
+    if (static_cast<uint64_t>(count) * (string_columns * width + kRecordNumericBytes) > reader.remaining()) {
+        return fail();
+    }
+
+    records.clear();
+    records.resize(count);
+    for (size_t f = 0; f < string_columns; ++f) {
+        for (auto& trans : records) {
+            uint64_t id = loadLittleEndian(reader.p, width);
+            if (id >= table.size()) {
+                return fail();
+            }
+            (f < kRecordStringFieldCount ? trans.*kRecordStringFields[f] : trans.timestamp) = table[id];
+        }
+    }
+    for (auto& trans : records) {
+        trans.quantity = static_cast<int>(static_cast<uint32_t>(loadLittleEndian(reader.p, 4)));
+    }
+    for (auto& trans : records) {
+        uint64_t bits = loadLittleEndian(reader.p, 8);
+        std::memcpy(&trans.unit_price, &bits, sizeof(bits));
+    }
+
+    if (timestamp_encoding != TS_STRING_TABLE) {
+        const uint8_t* formats = nullptr;
+        if (timestamp_encoding == TS_MIXED_FORMATS) {
+            if (reader.remaining() < count) {
+                return fail();
+            }
+            formats = reader.p;
+            reader.p += count;
+        }
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t delta;
+            if (!reader.readVarint(delta)) {
+                return fail();
+            }
+            previous += zigzagDecode(delta);
+            records[i].timestamp = ColumnarSnapshot::formatTimestamp(previous, formats ? formats[i] : timestamp_encoding);
+        }
+    }
+
+    if (reader.remaining() != 0) {
+        return fail();
+    }
+
+    getStats().messages_received++;
+    getStats().bytes_received += payload_size;
+
+    return true;
+}
+
 // ========== 工具方法实现 ==========
 
 bool BinaryProtocol::validateMessage(const uint8_t* data, size_t size) {
@@ -413,6 +747,12 @@ std::vector<uint8_t> BinaryClient::sendMixedData(const std::vector<uint32_t>& ui
     return BinaryProtocol::serializeMixedData(uint32_data, string_data);
 }
 
+std::vector<uint8_t> BinaryClient::sendTransactionBatch(const std::vector<uint32_t>& uint32_data,
+                                                      const std::vector<std::string>& string_data,
+                                                      const std::vector<TransactionRecord>& records) {
+    return BinaryProtocol::serializeTransactionBatch(uint32_data, string_data, records.data(), records.size());
+}
+
 bool BinaryClient::handleMessage(const uint8_t* data, size_t size) {
     last_response_ = Response();
     
@@ -442,6 +782,14 @@ bool BinaryClient::handleMessage(const uint8_t* data, size_t size) {
                                                                         last_response_.string_data);
             break;
             
+        case BinaryProtocol::MSG_TRANSACTION_BATCH:
+        case BinaryProtocol::MSG_TRANSACTION_RESULT:
+            last_response_.success = BinaryProtocol::deserializeTransactions(payload, header.payload_size,
+                                                                           last_response_.uint32_data,
+                                                                           last_response_.string_data,
+                                                                           last_response_.records);
+            break;
+            
         case BinaryProtocol::MSG_RESPONSE:
             last_response_.success = BinaryProtocol::deserializeResponse(payload, header.payload_size, 
                                                                        last_response_.status_code, 
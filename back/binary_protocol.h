@@ -1,13 +1,14 @@
 #ifndef BINARY_PROTOCOL_H
 #define BINARY_PROTOCOL_H
 
+#include "transaction.h"
 #include <vector>
 #include <string>
 #include <cstdint>
 #include <cstring>
 
 // 二进制协议：高性能数据传输
-// 支持 uint32 数组和字符串数组的高效序列化/反序列化
+// 支持 uint32 数组和字符串数组的高效序列化/反序列化，以及列式编码的交易记录批量
 class BinaryProtocol {
 public:
     // ========== 消息类型定义 ==========
@@ -17,7 +18,9 @@ public:
         MSG_STRING_ARRAY = 0x02,        // 字符串数组消息
         MSG_MIXED_DATA = 0x03,          // 混合数据消息
         MSG_RESPONSE = 0x04,            // 响应消息
-        MSG_ERROR = 0x05                // 错误消息
+        MSG_ERROR = 0x05,               // 错误消息
+        MSG_TRANSACTION_BATCH = 0x06,   // 交易记录批量（列式编码，写入）
+        MSG_TRANSACTION_RESULT = 0x07   // 交易记录查询结果（列式编码）
     };
     
     // ========== 消息头结构 ==========
@@ -54,6 +57,15 @@ public:
     // 序列化错误消息
     static std::vector<uint8_t> serializeError(uint32_t error_code, const std::string& error_message);
     
+    // 序列化交易记录批量 / 查询结果：信封（uint32数组 + 字符串数组）与混合数据相同，记录按列编码
+    // 所有字符串列共享一张字符串表，数量、单价为定长列，时间戳按毫秒差分
+    static std::vector<uint8_t> serializeTransactionBatch(const std::vector<uint32_t>& uint32_data,
+                                                          const std::vector<std::string>& string_data,
+                                                          const TransactionRecord* records, size_t count);
+    static std::vector<uint8_t> serializeTransactionResult(const std::vector<uint32_t>& uint32_data,
+                                                           const std::vector<std::string>& string_data,
+                                                           const TransactionRecord* records, size_t count);
+    
     // ========== 反序列化方法 ==========
     
     // 解析消息头
@@ -80,6 +92,12 @@ public:
     static bool deserializeError(const uint8_t* payload, size_t payload_size,
                                 uint32_t& error_code, std::string& error_message);
     
+    // 反序列化交易记录批量 / 查询结果（两种消息负载格式相同）
+    static bool deserializeTransactions(const uint8_t* payload, size_t payload_size,
+                                        std::vector<uint32_t>& uint32_data,
+                                        std::vector<std::string>& string_data,
+                                        std::vector<TransactionRecord>& records);
+    
     // ========== 工具方法 ==========
     
     // 验证消息完整性
@@ -120,6 +138,9 @@ public:
 private:
     // 内部辅助方法
     static std::vector<uint8_t> createMessage(MessageType type, const std::vector<uint8_t>& payload);
+    static std::vector<uint8_t> serializeTransactions(MessageType type, const std::vector<uint32_t>& uint32_data,
+                                                      const std::vector<std::string>& string_data,
+                                                      const TransactionRecord* records, size_t count);
     static void writeUint32(uint8_t* buffer, uint32_t value);
     static uint32_t readUint32(const uint8_t* buffer);
     static void writeUint16(uint8_t* buffer, uint16_t value);
@@ -144,6 +165,11 @@ public:
     std::vector<uint8_t> sendMixedData(const std::vector<uint32_t>& uint32_data,
                                       const std::vector<std::string>& string_data);
     
+    // 发送交易记录批量
+    std::vector<uint8_t> sendTransactionBatch(const std::vector<uint32_t>& uint32_data,
+                                             const std::vector<std::string>& string_data,
+                                             const std::vector<TransactionRecord>& records);
+    
     // 处理接收到的消息
     bool handleMessage(const uint8_t* data, size_t size);
     
@@ -154,6 +180,7 @@ public:
         std::string message;
         std::vector<uint32_t> uint32_data;
         std::vector<std::string> string_data;
+        std::vector<TransactionRecord> records;
         
         Response() : success(false), status_code(0) {}
     };
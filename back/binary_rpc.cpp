@@ -0,0 +1,753 @@
+#include "binary_rpc.h"
+#include "binary_protocol.h"
+#include "logger.h"
+#include "monitoring.h"
+#include <chrono>
+#include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+
+namespace {
+
+enum RpcOperation : uint32_t {
+    RPC_APPEND = 1,
+    RPC_APPEND_BATCH = 2,
+    RPC_QUERY = 3,
+    RPC_REPLY = 0x80
+};
+
+// 单条写入时记录的 uint32 部分：[数量][单价位模式低/高]；字符串部分见 appendRecordFields
+const size_t kRecordNumbers = 3;
+const size_t kRecordStrings = 13;
+
+// 单条消息的负载上限，防止错误的长度字段导致巨大的分配
+const uint32_t kMaxFramePayload = 16 * 1024 * 1024;
+
+// 单次查询返回的记录上限，以及查询响应中字符串的总字节上限（留出编码开销）
+const uint32_t kMaxQueryRecords = 10000;
+const size_t kMaxQueryStringBytes = kMaxFramePayload / 2;
+
+// 每个连接同时在工作线程中处理的请求上限，超出时暂停读取，由TCP流控让客户端等待
+const size_t kMaxInFlightPerConnection = 256;
+
+// 响应的发送期限：不读取响应的客户端不能让工作线程一直阻塞在 send 上
+// 慢速读取的客户端每次只收下少量数据，单次 send 的超时不够，整帧超过期限未写完即放弃
+const int kSendTimeoutSeconds = 5;
+const int kSendPollSeconds = 1;     // 单次 send 最多阻塞的时间（SO_SNDTIMEO），期限在两次 send 之间检查
+
+// accept 因描述符或内存耗尽失败时的退避等待（毫秒），逐次加倍
+const int kAcceptBackoffInitialMs = 10;
+const int kAcceptBackoffMaxMs = 1000;
+
+uint32_t low32(uint64_t value) { return static_cast<uint32_t>(value); }
+uint32_t high32(uint64_t value) { return static_cast<uint32_t>(value >> 32); }
+uint64_t join64(uint32_t low, uint32_t high) { return static_cast<uint64_t>(low) | (static_cast<uint64_t>(high) << 32); }
+
+void appendRecordFields(const TransactionRecord& trans, std::vector<uint32_t>& numbers, std::vector<std::string>& fields) {
+    uint64_t price_bits;
+    std::memcpy(&price_bits, &trans.unit_price, sizeof(price_bits));
+    numbers.push_back(static_cast<uint32_t>(trans.quantity));
+    numbers.push_back(low32(price_bits));
+    numbers.push_back(high32(price_bits));
+
+    fields.push_back(trans.trans_id);
+    fields.push_back(trans.item_id);
+    fields.push_back(trans.item_name);
+    fields.push_back(trans.type);
+    fields.push_back(trans.category);
+    fields.push_back(trans.model);
+    fields.push_back(trans.unit);
+    fields.push_back(trans.partner_id);
+    fields.push_back(trans.partner_name);
+    fields.push_back(trans.warehouse_id);
+    fields.push_back(trans.document_no);
+    fields.push_back(trans.timestamp);
+    fields.push_back(trans.note);
+}
+
+// numbers/fields 从给定下标起是一条记录；调用方已检查长度
+void readRecordFields(const std::vector<uint32_t>& numbers, size_t number_index,
+                      const std::vector<std::string>& fields, size_t field_index, TransactionRecord& trans) {
+    trans.quantity = static_cast<int>(numbers[number_index]);
+    uint64_t price_bits = join64(numbers[number_index + 1], numbers[number_index + 2]);
+    std::memcpy(&trans.unit_price, &price_bits, sizeof(price_bits));
+
+    const std::string* field = &fields[field_index];
+    trans.trans_id = field[0];
+    trans.item_id = field[1];
+    trans.item_name = field[2];
+    trans.type = field[3];
+    trans.category = field[4];
+    trans.model = field[5];
+    trans.unit = field[6];
+    trans.partner_id = field[7];
+    trans.partner_name = field[8];
+    trans.warehouse_id = field[9];
+    trans.document_no = field[10];
+    trans.timestamp = field[11];
+    trans.note = field[12];
+}
+
+std::vector<uint8_t> encodeReply(uint32_t request_id, ErrorCode code, const std::string& message,
+                                 std::vector<uint32_t> numbers = {}, std::vector<std::string> fields = {}) {
+    numbers.insert(numbers.begin(), { RPC_REPLY, request_id, static_cast<uint32_t>(code) });
+    fields.insert(fields.begin(), message);
+    return BinaryProtocol::serializeMixedData(numbers, fields);
+}
+
+std::string currentTimestamp() {
+    std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm utc;
+    gmtime_r(&now, &utc);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return buffer;
+}
+
+bool sendFully(int fd, const std::vector<uint8_t>& data,
+               std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::chrono::steady_clock::time_point sendDeadline() {
+    return std::chrono::steady_clock::now() + std::chrono::seconds(kSendTimeoutSeconds);
+}
+
+bool readFully(int fd, uint8_t* buffer, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(fd, buffer + received, size - received, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 读取一条完整消息并校验，连接关闭或消息损坏时返回 false；混合数据消息没有记录部分
+bool readFrame(int fd, std::vector<uint32_t>& numbers, std::vector<std::string>& fields,
+               std::vector<TransactionRecord>& records) {
+    const size_t header_size = sizeof(BinaryProtocol::MessageHeader);
+    std::vector<uint8_t> message(header_size);
+    if (!readFully(fd, message.data(), header_size)) {
+        return false;
+    }
+
+    BinaryProtocol::MessageHeader header;
+    if (!BinaryProtocol::parseHeader(message.data(), header_size, header) ||
+        (header.message_type != BinaryProtocol::MSG_MIXED_DATA &&
+         header.message_type != BinaryProtocol::MSG_TRANSACTION_BATCH &&
+         header.message_type != BinaryProtocol::MSG_TRANSACTION_RESULT) ||
+        header.payload_size > kMaxFramePayload) {
+        return false;
+    }
+
+    message.resize(header_size + header.payload_size);
+    if (!readFully(fd, message.data() + header_size, header.payload_size) ||
+        !BinaryProtocol::validateMessage(message.data(), message.size())) {
+        return false;
+    }
+
+    if (header.message_type != BinaryProtocol::MSG_MIXED_DATA) {
+        return BinaryProtocol::deserializeTransactions(message.data() + header_size, header.payload_size,
+                                                       numbers, fields, records);
+    }
+    records.clear();
+    return BinaryProtocol::deserializeMixedData(message.data() + header_size, header.payload_size,
+                                                numbers, fields);
+}
+
+}  // namespace
+
+// ========== 服务端 ==========
+
+struct BinaryRpcServer::Connection {
+    int socket;
+    std::string peer;
+    std::thread thread;
+    std::mutex send_mutex;      // 工作线程并发发送响应，整帧写出后才释放
+    std::mutex mutex;
+    std::condition_variable drained;
+    size_t in_flight;
+    bool closed;                // 描述符已关闭，stop() 不能再对其调用 shutdown
+    std::atomic<bool> finished;
+    std::atomic<bool> send_failed;  // 响应发送失败或超时，排队中的请求不再执行
+
+    Connection(int fd, const std::string& address)
+        : socket(fd), peer(address), in_flight(0), closed(false), finished(false), send_failed(false) {}
+};
+
+BinaryRpcServer::BinaryRpcServer(int port, std::shared_ptr<MemoryDatabase> db)
+    : port_(port), db_(db), running_(false), read_only_(false), server_fd_(-1), worker_threads_(0) {
+    LOG_INFO("BinaryRpcServer", "constructor", "Binary RPC server initialized on port " + std::to_string(port));
+}
+
+BinaryRpcServer::~BinaryRpcServer() {
+    stop();
+}
+
+bool BinaryRpcServer::start() {
+    if (running_) {
+        LOG_WARNING("BinaryRpcServer", "start", "Binary RPC server is already running");
+        return false;
+    }
+
+    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd_ == -1) {
+        LOG_ERROR("BinaryRpcServer", "start", "Failed to create socket: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port_);
+
+    if (bind(server_fd_, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(server_fd_, SOMAXCONN) < 0) {
+        LOG_ERROR("BinaryRpcServer", "start", "Failed to listen on RPC port " +
+                 std::to_string(port_) + ": " + std::string(strerror(errno)));
+        close(server_fd_);
+        server_fd_ = -1;
+        return false;
+    }
+
+    size_t threads = worker_threads_;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reset(new WorkerPool(threads, threads * kMaxInFlightPerConnection, std::chrono::milliseconds(5000)));
+
+    running_ = true;
+    accept_thread_ = std::thread(&BinaryRpcServer::acceptLoop, this);
+
+    LOG_INFO("BinaryRpcServer", "start", "Binary RPC server listening on port " + std::to_string(port_));
+    return true;
+}
+
+void BinaryRpcServer::stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+
+    // 关闭监听 socket 以唤醒 accept
+    shutdown(server_fd_, SHUT_RDWR);
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    close(server_fd_);
+    server_fd_ = -1;
+
+    // 断开所有连接，读取线程等处理中的请求完成后退出
+    std::vector<std::shared_ptr<Connection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.swap(connections_);
+    }
+    for (const auto& conn : connections) {
+        std::lock_guard<std::mutex> lock(conn->mutex);
+        if (!conn->closed) {
+            shutdown(conn->socket, SHUT_RDWR);
+        }
+    }
+    for (const auto& conn : connections) {
+        if (conn->thread.joinable()) {
+            conn->thread.join();
+        }
+    }
+    workers_->shutdown();
+    SET_GAUGE("rpc_connections", 0);
+
+    LOG_INFO("BinaryRpcServer", "stop", "Binary RPC server stopped");
+}
+
+size_t BinaryRpcServer::getConnectionCount() const {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    return connections_.size();
+}
+
+void BinaryRpcServer::acceptLoop() {
+    int backoff_ms = 0;
+    while (running_) {
+        struct sockaddr_in client_address;
+        socklen_t client_len = sizeof(client_address);
+
+        int client_socket = accept(server_fd_, (struct sockaddr*)&client_address, &client_len);
+        int accept_error = errno;
+        reapConnections();
+        if (client_socket < 0) {
+            if (!running_ || accept_error == EINTR || accept_error == ECONNABORTED) {
+                continue;
+            }
+            // EMFILE、ENFILE、ENOBUFS 等错误会立即重复出现：退避等待连接释放资源，每次退避只记录一次
+            if (backoff_ms == 0) {
+                LOG_ERROR("BinaryRpcServer", "accept", "Failed to accept connection: " + std::string(strerror(accept_error)));
+                INC_COUNTER("rpc_accept_errors");
+            }
+            backoff_ms = backoff_ms == 0 ? kAcceptBackoffInitialMs : std::min(backoff_ms * 2, kAcceptBackoffMaxMs);
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+            continue;
+        }
+        backoff_ms = 0;
+
+        int nodelay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        struct timeval send_timeout;
+        send_timeout.tv_sec = kSendPollSeconds;
+        send_timeout.tv_usec = 0;
+        setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+        char host[64] = {0};
+        getnameinfo((struct sockaddr*)&client_address, client_len, host, sizeof(host), nullptr, 0, NI_NUMERICHOST);
+        auto conn = std::make_shared<Connection>(client_socket,
+                                                 std::string(host) + ":" + std::to_string(ntohs(client_address.sin_port)));
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections_.push_back(conn);
+        conn->thread = std::thread(&BinaryRpcServer::serveConnection, this, conn);
+        SET_GAUGE("rpc_connections", connections_.size());
+    }
+}
+
+void BinaryRpcServer::reapConnections() {
+    std::vector<std::shared_ptr<Connection>> finished;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        auto split = std::partition(connections_.begin(), connections_.end(),
+                                    [](const std::shared_ptr<Connection>& conn) { return !conn->finished; });
+        finished.assign(split, connections_.end());
+        connections_.erase(split, connections_.end());
+        if (!finished.empty()) {
+            SET_GAUGE("rpc_connections", connections_.size());
+        }
+    }
+    for (const auto& conn : finished) {
+        conn->thread.join();
+    }
+}
+
+void BinaryRpcServer::serveConnection(std::shared_ptr<Connection> conn) {
+    LOG_DEBUG("BinaryRpcServer", "connection", "Client connected: " + conn->peer);
+
+    std::vector<uint32_t> numbers;
+    std::vector<std::string> fields;
+    std::vector<TransactionRecord> records;
+    while (running_ && readFrame(conn->socket, numbers, fields, records)) {
+        if (numbers.size() < 2) {
+            // 连请求ID都没有，无法回复，按协议错误断开
+            LOG_WARNING("BinaryRpcServer", "read", "Malformed request from " + conn->peer);
+            break;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(conn->mutex);
+            conn->drained.wait(lock, [&conn]() { return conn->in_flight < kMaxInFlightPerConnection; });
+            conn->in_flight++;
+        }
+
+        uint32_t request_id = numbers[1];
+        bool queued = workers_->submit([this, conn, numbers = std::move(numbers), fields = std::move(fields),
+                                        records = std::move(records)](bool expired) mutable {
+            // 发送失败或超时后关闭连接，同一连接排队中的请求直接丢弃，不再占用工作线程
+            if (!conn->send_failed) {
+                std::vector<uint8_t> reply = expired
+                    ? encodeReply(numbers[1], ErrorCode::OPERATION_TIMEOUT, "Server overloaded, retry later")
+                    : execute(numbers, fields, records);
+                std::lock_guard<std::mutex> lock(conn->send_mutex);
+                if (!conn->send_failed && !sendFully(conn->socket, reply, sendDeadline())) {
+                    conn->send_failed = true;
+                    shutdown(conn->socket, SHUT_RDWR);
+                }
+            }
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            conn->in_flight--;
+            conn->drained.notify_all();
+        });
+        if (!queued) {
+            std::lock_guard<std::mutex> send_lock(conn->send_mutex);
+            if (!conn->send_failed &&
+                !sendFully(conn->socket, encodeReply(request_id, ErrorCode::OPERATION_TIMEOUT, "Server overloaded, retry later"),
+                           sendDeadline())) {
+                conn->send_failed = true;
+                shutdown(conn->socket, SHUT_RDWR);
+            }
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            conn->in_flight--;
+        }
+        numbers.clear();
+        fields.clear();
+        records.clear();
+    }
+
+    // 等已提交的请求发送完响应后再关闭描述符
+    std::unique_lock<std::mutex> lock(conn->mutex);
+    conn->drained.wait(lock, [&conn]() { return conn->in_flight == 0; });
+    close(conn->socket);
+    conn->closed = true;
+    conn->finished = true;
+    LOG_DEBUG("BinaryRpcServer", "connection", "Client disconnected: " + conn->peer);
+}
+
+std::vector<uint8_t> BinaryRpcServer::execute(const std::vector<uint32_t>& numbers, const std::vector<std::string>& fields,
+                                              std::vector<TransactionRecord>& records) {
+    auto start_time = std::chrono::steady_clock::now();
+    uint32_t operation = numbers[0];
+    uint32_t request_id = numbers[1];
+    INC_COUNTER("rpc_requests");
+
+    std::vector<uint8_t> reply;
+    if (fields.empty() || fields[0].empty()) {
+        reply = encodeReply(request_id, ErrorCode::INVALID_PARAMETER, "Manager ID is required");
+    } else if (read_only_ && operation != RPC_QUERY) {
+        reply = encodeReply(request_id, ErrorCode::OPERATION_CANCELLED, "Read-only replica, send writes to the primary");
+    } else {
+        switch (operation) {
+            case RPC_APPEND:
+                reply = handleAppend(request_id, numbers, fields);
+                break;
+            case RPC_APPEND_BATCH:
+                reply = handleAppendBatch(request_id, numbers, fields, records);
+                break;
+            case RPC_QUERY:
+                reply = handleQuery(request_id, numbers, fields);
+                break;
+            default:
+                reply = encodeReply(request_id, ErrorCode::INVALID_PARAMETER,
+                                    "Unknown operation " + std::to_string(operation));
+                break;
+        }
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start_time;
+    OBSERVE_HISTOGRAM("rpc_request_time", std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1000.0);
+    return reply;
+}
+
+Result<void> BinaryRpcServer::appendRecord(const std::string& manager_id, TransactionRecord& trans) {
+    trans.manager_id = manager_id;
+    if (trans.trans_id.empty()) {
+        trans.trans_id = db_->generateTransactionId();
+    }
+    if (trans.timestamp.empty()) {
+        trans.timestamp = currentTimestamp();
+    }
+    auto result = db_->appendTransaction(manager_id, trans);
+    if (result.isSuccess()) {
+        INC_COUNTER("rpc_records_appended");
+    }
+    return result;
+}
+
+std::vector<uint8_t> BinaryRpcServer::handleAppend(uint32_t request_id, const std::vector<uint32_t>& numbers,
+                                                   const std::vector<std::string>& fields) {
+    if (numbers.size() != 2 + kRecordNumbers || fields.size() != 1 + kRecordStrings) {
+        INC_COUNTER("rpc_request_errors");
+        return encodeReply(request_id, ErrorCode::INVALID_PARAMETER, "Malformed append request");
+    }
+
+    TransactionRecord trans;
+    readRecordFields(numbers, 2, fields, 1, trans);
+    auto result = appendRecord(fields[0], trans);
+    if (result.isError()) {
+        INC_COUNTER("rpc_request_errors");
+        return encodeReply(request_id, result.getErrorCode(), result.getErrorMessage());
+    }
+    return encodeReply(request_id, ErrorCode::SUCCESS, "", {}, { trans.trans_id });
+}
+
+std::vector<uint8_t> BinaryRpcServer::handleAppendBatch(uint32_t request_id, const std::vector<uint32_t>& numbers,
+                                                        const std::vector<std::string>& fields,
+                                                        std::vector<TransactionRecord>& records) {
+    size_t count = records.size();
+    if (numbers.size() != 2 || fields.size() != 1) {
+        INC_COUNTER("rpc_request_errors");
+        return encodeReply(request_id, ErrorCode::INVALID_PARAMETER, "Malformed batch append request");
+    }
+
+    // 逐条写入，失败的记录不影响其余记录；响应带每条记录的错误码和交易ID
+    ErrorCode first_error = ErrorCode::SUCCESS;
+    std::string first_message;
+    std::vector<uint32_t> reply_numbers = { 0 };
+    std::vector<std::string> reply_fields;
+    reply_numbers.reserve(1 + count);
+    reply_fields.reserve(count);
+    uint32_t accepted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        TransactionRecord& trans = records[i];
+        auto result = appendRecord(fields[0], trans);
+        if (result.isSuccess()) {
+            accepted++;
+            reply_numbers.push_back(static_cast<uint32_t>(ErrorCode::SUCCESS));
+            reply_fields.push_back(trans.trans_id);
+        } else {
+            if (first_error == ErrorCode::SUCCESS) {
+                first_error = result.getErrorCode();
+                first_message = "Record " + std::to_string(i) + ": " + result.getErrorMessage();
+            }
+            reply_numbers.push_back(static_cast<uint32_t>(result.getErrorCode()));
+            reply_fields.push_back("");
+        }
+    }
+    reply_numbers[0] = accepted;
+    if (first_error != ErrorCode::SUCCESS) {
+        INC_COUNTER("rpc_request_errors");
+    }
+    return encodeReply(request_id, first_error, first_message, std::move(reply_numbers), std::move(reply_fields));
+}
+
+std::vector<uint8_t> BinaryRpcServer::handleQuery(uint32_t request_id, const std::vector<uint32_t>& numbers,
+                                                  const std::vector<std::string>& fields) {
+    if (numbers.size() != 5 || fields.size() != 1) {
+        INC_COUNTER("rpc_request_errors");
+        return encodeReply(request_id, ErrorCode::INVALID_PARAMETER, "Malformed query request");
+    }
+
+    const std::string& manager_id = fields[0];
+    uint64_t from = join64(numbers[2], numbers[3]);
+    size_t limit = std::min(numbers[4], kMaxQueryRecords);
+    uint64_t total = db_->getTransactionCount(manager_id);
+
+    // 响应为列式查询结果消息，信封：[0x80][请求ID][错误码][总数低/高][下一页起始位置低/高]
+    uint64_t next = std::max(from, total);
+    size_t returned = 0;
+    std::vector<TransactionRecord> records;
+    if (from < total && limit > 0) {
+        records = db_->getTransactionsFrom(manager_id, from, limit);
+        size_t end = records.size();
+        size_t string_bytes = 0;
+        for (; returned < end; ++returned) {
+            const TransactionRecord& trans = records[returned];
+            // 超过单帧大小时截断，调用方从 next 继续读取
+            string_bytes += trans.item_name.size() + trans.note.size() + trans.partner_name.size() + 256;
+            if (returned > 0 && string_bytes > kMaxQueryStringBytes) {
+                break;
+            }
+        }
+        next = from + returned;
+    }
+    std::vector<uint32_t> reply_numbers = { RPC_REPLY, request_id, static_cast<uint32_t>(ErrorCode::SUCCESS),
+                                            low32(total), high32(total), low32(next), high32(next) };
+    return BinaryProtocol::serializeTransactionResult(reply_numbers, { "" }, records.data(), returned);
+}
+
+// ========== 客户端 ==========
+
+struct BinaryRpcClient::Call {
+    bool done;
+    bool failed;
+    std::vector<uint32_t> numbers;
+    std::vector<std::string> fields;
+    std::vector<TransactionRecord> records;
+
+    Call() : done(false), failed(false) {}
+};
+
+BinaryRpcClient::BinaryRpcClient() : socket_(-1), connected_(false), next_request_id_(1) {}
+
+BinaryRpcClient::~BinaryRpcClient() {
+    close();
+}
+
+bool BinaryRpcClient::connect(const std::string& host, int port) {
+    close();
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+        LOG_ERROR("BinaryRpcClient", "connect", "Cannot resolve host: " + host);
+        return false;
+    }
+
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && ::connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd < 0) {
+        LOG_WARNING("BinaryRpcClient", "connect", "Server " + host + ":" + std::to_string(port) + " not reachable");
+        return false;
+    }
+
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    socket_ = fd;
+    connected_ = true;
+    reader_ = std::thread(&BinaryRpcClient::readLoop, this);
+    return true;
+}
+
+void BinaryRpcClient::close() {
+    int fd = socket_.exchange(-1);
+    if (fd >= 0) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void BinaryRpcClient::readLoop() {
+    int fd = socket_;
+    std::vector<uint32_t> numbers;
+    std::vector<std::string> fields;
+    std::vector<TransactionRecord> records;
+    while (readFrame(fd, numbers, fields, records)) {
+        if (numbers.size() < 3 || numbers[0] != RPC_REPLY || fields.empty()) {
+            break;
+        }
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        auto it = calls_.find(numbers[1]);
+        if (it != calls_.end()) {
+            it->second->numbers.swap(numbers);
+            it->second->fields.swap(fields);
+            it->second->records.swap(records);
+            it->second->done = true;
+            calls_.erase(it);
+            replied_.notify_all();
+        }
+    }
+
+    // 连接断开：所有等待中的调用失败
+    std::lock_guard<std::mutex> lock(calls_mutex_);
+    connected_ = false;
+    for (auto& pair : calls_) {
+        pair.second->failed = true;
+        pair.second->done = true;
+    }
+    calls_.clear();
+    replied_.notify_all();
+}
+
+bool BinaryRpcClient::call(std::vector<uint32_t> numbers, const std::vector<std::string>& fields,
+                           const std::vector<TransactionRecord>* records, Call& reply) {
+    uint32_t request_id = next_request_id_++;
+    numbers[1] = request_id;
+    auto pending = std::make_shared<Call>();
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        if (!connected_) {
+            return false;
+        }
+        calls_[request_id] = pending;
+    }
+
+    bool sent;
+    {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        sent = sendFully(socket_, records
+            ? BinaryProtocol::serializeTransactionBatch(numbers, fields, records->data(), records->size())
+            : BinaryProtocol::serializeMixedData(numbers, fields));
+    }
+
+    std::unique_lock<std::mutex> lock(calls_mutex_);
+    if (!sent) {
+        calls_.erase(request_id);
+        return false;
+    }
+    replied_.wait(lock, [&pending]() { return pending->done; });
+    if (pending->failed) {
+        return false;
+    }
+    reply = std::move(*pending);
+    return true;
+}
+
+Result<std::string> BinaryRpcClient::append(const std::string& manager_id, const TransactionRecord& trans) {
+    std::vector<uint32_t> numbers = { RPC_APPEND, 0 };
+    std::vector<std::string> fields = { manager_id };
+    appendRecordFields(trans, numbers, fields);
+
+    Call reply;
+    if (!call(std::move(numbers), fields, nullptr, reply)) {
+        return Result<std::string>::error(ErrorCode::NETWORK_DISCONNECTED, "Connection to RPC server lost");
+    }
+    const auto& reply_numbers = reply.numbers;
+    const auto& reply_fields = reply.fields;
+    ErrorCode code = static_cast<ErrorCode>(reply_numbers[2]);
+    if (code != ErrorCode::SUCCESS || reply_fields.size() != 2) {
+        return Result<std::string>::error(code, reply_fields[0]);
+    }
+    return Result<std::string>::success(reply_fields[1]);
+}
+
+Result<std::vector<std::string>> BinaryRpcClient::appendBatch(const std::string& manager_id,
+                                                              const std::vector<TransactionRecord>& records,
+                                                              std::vector<ErrorCode>* errors) {
+    Call reply;
+    if (!call({ RPC_APPEND_BATCH, 0 }, { manager_id }, &records, reply)) {
+        return Result<std::vector<std::string>>::error(ErrorCode::NETWORK_DISCONNECTED, "Connection to RPC server lost");
+    }
+    const auto& reply_numbers = reply.numbers;
+    const auto& reply_fields = reply.fields;
+    // 响应：[接受条数]{每条记录的错误码}，字段为每条记录的交易ID；整个请求被拒绝时没有逐条结果
+    ErrorCode code = static_cast<ErrorCode>(reply_numbers[2]);
+    if (reply_numbers.size() != 4 + records.size() || reply_fields.size() != 1 + records.size()) {
+        return Result<std::vector<std::string>>::error(code == ErrorCode::SUCCESS ? ErrorCode::DATA_CORRUPTION_DETECTED : code,
+                                                       reply_fields[0]);
+    }
+    if (errors) {
+        errors->clear();
+        for (size_t i = 0; i < records.size(); ++i) {
+            errors->push_back(static_cast<ErrorCode>(reply_numbers[4 + i]));
+        }
+    }
+    return Result<std::vector<std::string>>::success(
+        std::vector<std::string>(reply_fields.begin() + 1, reply_fields.end()));
+}
+
+Result<uint64_t> BinaryRpcClient::query(const std::string& manager_id, uint64_t from, uint32_t limit,
+                                        std::vector<TransactionRecord>& records) {
+    Call reply;
+    if (!call({ RPC_QUERY, 0, low32(from), high32(from), limit }, { manager_id }, nullptr, reply)) {
+        return Result<uint64_t>::error(ErrorCode::NETWORK_DISCONNECTED, "Connection to RPC server lost");
+    }
+    ErrorCode code = static_cast<ErrorCode>(reply.numbers[2]);
+    if (code != ErrorCode::SUCCESS) {
+        return Result<uint64_t>::error(code, reply.fields[0]);
+    }
+    if (reply.numbers.size() != 7) {
+        return Result<uint64_t>::error(ErrorCode::DATA_CORRUPTION_DETECTED, "Malformed query reply");
+    }
+    records.swap(reply.records);
+    for (auto& trans : records) {
+        trans.manager_id = manager_id;
+    }
+    return Result<uint64_t>::success(join64(reply.numbers[5], reply.numbers[6]));
+}
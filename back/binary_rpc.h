@@ -0,0 +1,121 @@
+#ifndef BINARY_RPC_H
+#define BINARY_RPC_H
+
+#include "memory_database.h"
+#include "worker_pool.h"
+#include "error_handling.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <cstdint>
+
+// 二进制RPC：基于 BinaryProtocol 帧的TCP接口，供扫描枪、ERP 对接等高频调用方使用
+//
+// 请求和响应的 uint32 部分以 [操作][请求ID] 开头，批量记录使用列式交易记录消息，其余为混合数据消息：
+//   APPEND        [1][请求ID][数量][单价位模式低/高]            字段：库管员ID + 一条记录（13 个字符串字段）
+//   APPEND_BATCH  [2][请求ID]                                   字段：库管员ID，记录：交易记录批量消息
+//   QUERY         [3][请求ID][起始位置低/高][最多条数]          字段：库管员ID
+//   REPLY         [0x80][请求ID][错误码]...                     字段：[错误信息]...，查询结果为交易记录查询结果消息
+// 记录字段顺序见 binary_rpc.cpp；错误码为 ErrorCode，0 表示成功
+// 同一连接上可以连续发送多个请求，由工作线程并发处理，响应按完成顺序返回，调用方按请求ID对应
+class BinaryRpcServer {
+public:
+    BinaryRpcServer(int port, std::shared_ptr<MemoryDatabase> db);
+    ~BinaryRpcServer();
+
+    // 工作线程数（0 表示每个CPU核心一个），需在 start() 之前调用
+    void setWorkerThreads(size_t count) { worker_threads_ = count; }
+
+    // 只读模式（复制从库）：拒绝写入请求
+    void setReadOnly(bool read_only) { read_only_ = read_only; }
+
+    // 开始监听
+    bool start();
+
+    // 停止监听，断开所有连接并等待处理中的请求完成
+    void stop();
+
+    bool isRunning() const { return running_; }
+    size_t getConnectionCount() const;
+
+private:
+    struct Connection;
+
+    int port_;
+    std::shared_ptr<MemoryDatabase> db_;
+    std::atomic<bool> running_;
+    std::atomic<bool> read_only_;
+    int server_fd_;
+    size_t worker_threads_;
+    std::thread accept_thread_;
+    std::unique_ptr<WorkerPool> workers_;
+    mutable std::mutex connections_mutex_;
+    std::vector<std::shared_ptr<Connection>> connections_;
+
+    void acceptLoop();
+    // 回收已结束的连接线程
+    void reapConnections();
+    // 连接的读取线程：读取请求帧交给工作线程，连接关闭后等待处理中的请求完成
+    void serveConnection(std::shared_ptr<Connection> conn);
+
+    // 执行一个请求，返回编码好的响应帧
+    std::vector<uint8_t> execute(const std::vector<uint32_t>& numbers, const std::vector<std::string>& fields,
+                                 std::vector<TransactionRecord>& records);
+    std::vector<uint8_t> handleAppend(uint32_t request_id, const std::vector<uint32_t>& numbers,
+                                      const std::vector<std::string>& fields);
+    std::vector<uint8_t> handleAppendBatch(uint32_t request_id, const std::vector<uint32_t>& numbers,
+                                           const std::vector<std::string>& fields,
+                                           std::vector<TransactionRecord>& records);
+    std::vector<uint8_t> handleQuery(uint32_t request_id, const std::vector<uint32_t>& numbers,
+                                     const std::vector<std::string>& fields);
+    // 补全缺省的交易ID和时间戳后写入
+    Result<void> appendRecord(const std::string& manager_id, TransactionRecord& trans);
+};
+
+// 二进制RPC客户端：一个连接可以被多个线程同时使用，请求按请求ID与响应对应
+class BinaryRpcClient {
+public:
+    BinaryRpcClient();
+    ~BinaryRpcClient();
+
+    bool connect(const std::string& host, int port);
+    void close();
+    bool isConnected() const { return connected_; }
+
+    // 写入一条记录，成功时返回交易ID（为空时由服务器生成）
+    Result<std::string> append(const std::string& manager_id, const TransactionRecord& trans);
+
+    // 批量写入，逐条执行：返回每条记录的交易ID，写入失败的记录对应空串，errors 非空时填入每条记录的错误码
+    // 只有整个请求被拒绝（格式错误、只读、连接断开）时返回错误
+    Result<std::vector<std::string>> appendBatch(const std::string& manager_id,
+                                                 const std::vector<TransactionRecord>& records,
+                                                 std::vector<ErrorCode>* errors = nullptr);
+
+    // 读取序列位置 from 起最多 limit 条记录，成功时返回下一页的起始位置
+    Result<uint64_t> query(const std::string& manager_id, uint64_t from, uint32_t limit,
+                           std::vector<TransactionRecord>& records);
+
+private:
+    struct Call;
+
+    std::atomic<int> socket_;
+    std::atomic<bool> connected_;
+    std::atomic<uint32_t> next_request_id_;
+    std::thread reader_;
+    std::mutex send_mutex_;
+    std::mutex calls_mutex_;
+    std::condition_variable replied_;
+    std::unordered_map<uint32_t, std::shared_ptr<Call>> calls_;
+
+    // 发送请求并等待对应的响应，连接断开时返回 false；records 非空时以交易记录批量消息发送
+    bool call(std::vector<uint32_t> numbers, const std::vector<std::string>& fields,
+              const std::vector<TransactionRecord>* records, Call& reply);
+    void readLoop();
+};
+
+#endif // BINARY_RPC_H
@@ -0,0 +1,960 @@
+#include "columnar_snapshot.h"
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+// ========== 字节编码辅助 ==========
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) return false;
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void putUint32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back((value >> 16) & 0xFF);
+    out.push_back((value >> 24) & 0xFF);
+}
+
+uint32_t getUint32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void putString(std::vector<uint8_t>& out, const std::string& str) {
+    putVarint(out, str.size());
+    out.insert(out.end(), str.begin(), str.end());
+}
+
+bool getString(const uint8_t*& p, const uint8_t* end, std::string& str) {
+    uint64_t length;
+    if (!getVarint(p, end, length) || length > static_cast<uint64_t>(end - p)) return false;
+    str.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+    p += length;
+    return true;
+}
+
+// 字典编码的字符串字段，按列ID顺序（COL_TRANS_ID .. COL_DOCUMENT_NO）
+typedef std::string TransactionRecord::*StringField;
+
+const StringField kStringFields[] = {
+    &TransactionRecord::trans_id,
+    &TransactionRecord::item_id,
+    &TransactionRecord::item_name,
+    &TransactionRecord::type,
+    &TransactionRecord::manager_id,
+    &TransactionRecord::note,
+    &TransactionRecord::category,
+    &TransactionRecord::model,
+    &TransactionRecord::unit,
+    &TransactionRecord::partner_id,
+    &TransactionRecord::partner_name,
+    &TransactionRecord::warehouse_id,
+    &TransactionRecord::document_no
+};
+
+const size_t kStringFieldCount = sizeof(kStringFields) / sizeof(kStringFields[0]);
+
+// 时间戳格式代码
+const uint8_t TS_FORMAT_MIXED = 0xFF;
+
+// 公历日期 <-> 1970-01-01 起的天数
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+bool parseDigits(const std::string& s, size_t pos, size_t count, int& value) {
+    value = 0;
+    for (size_t i = pos; i < pos + count; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        value = value * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+// LZ哈希表参数
+const int LZ_HASH_BITS = 14;
+const size_t LZ_MIN_MATCH = 4;
+const size_t LZ_MAX_OFFSET = 0xFFFF;
+const size_t LZ_TAIL_LITERALS = 5;      // 末尾保留为字面量的字节数
+
+uint32_t readRaw32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+void putLength(std::vector<uint8_t>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+bool getLength(const uint8_t*& p, const uint8_t* end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (p >= end) return false;
+        byte = *p++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// 序列格式：[token: 字面量长度<<4 | 匹配长度-4][扩展字面量长度][字面量][偏移:2字节][扩展匹配长度]
+void emitSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_length,
+                  size_t offset, size_t match_length) {
+    size_t match_code = match_length - LZ_MIN_MATCH;
+    uint8_t token = static_cast<uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4);
+    token |= static_cast<uint8_t>(match_code >= 15 ? 15 : match_code);
+    out.push_back(token);
+    if (literal_length >= 15) putLength(out, literal_length - 15);
+    out.insert(out.end(), literals, literals + literal_length);
+    out.push_back(offset & 0xFF);
+    out.push_back((offset >> 8) & 0xFF);
+    if (match_code >= 15) putLength(out, match_code - 15);
+}
+
+void emitLastLiterals(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_length) {
+    out.push_back(static_cast<uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4));
+    if (literal_length >= 15) putLength(out, literal_length - 15);
+    out.insert(out.end(), literals, literals + literal_length);
+}
+
+} // namespace
+
+const uint32_t ColumnarSnapshot::FILE_MAGIC;
+const uint32_t ColumnarSnapshot::BLOCK_MAGIC;
+const uint8_t ColumnarSnapshot::FORMAT_VERSION;
+const uint32_t ColumnarSnapshot::CHECKPOINT_MAGIC;
+
+// ========== BlockInfo ==========
+
+const ColumnarSnapshot::ColumnInfo* ColumnarSnapshot::BlockInfo::findColumn(uint8_t id) const {
+    for (const auto& column : columns) {
+        if (column.id == id) return &column;
+    }
+    return nullptr;
+}
+
+// ========== 编码 ==========
+
+std::vector<uint8_t> ColumnarSnapshot::encodeFileHeader(uint32_t block_count, uint64_t wal_segment,
+                                                        const std::string& created_at, bool compressed,
+                                                        bool delta, uint64_t base_segment) {
+    // 格式：[magic:4][version:1][flags:1][reserved:2][block_count:4][wal_segment][base_segment?][created_at][header_crc:4]
+    std::vector<uint8_t> header;
+    putUint32(header, FILE_MAGIC);
+    header.push_back(FORMAT_VERSION);
+    header.push_back((compressed ? FILE_COMPRESSED : 0) | (delta ? FILE_DELTA : 0));
+    header.push_back(0);
+    header.push_back(0);
+    putUint32(header, block_count);
+    putVarint(header, wal_segment);
+    if (delta) {
+        putVarint(header, base_segment);
+    }
+    putString(header, created_at);
+    putUint32(header, crc32(header.data(), header.size()));
+    return header;
+}
+
+std::vector<uint8_t> ColumnarSnapshot::encodeBlock(const std::string& manager_id, uint64_t base_count,
+                                                   const TransactionRecord* records, size_t count,
+                                                   bool compress) {
+    std::vector<std::vector<uint8_t>> raw(COL_COUNT);
+    std::vector<uint8_t> encodings(COL_COUNT, 0);
+
+    // 字符串列：整个块共享一个字典
+    std::unordered_map<std::string, uint32_t> dict_index;
+    std::vector<const std::string*> dict;
+    for (size_t f = 0; f < kStringFieldCount; ++f) {
+        auto& column = raw[COL_TRANS_ID + f];
+        encodings[COL_TRANS_ID + f] = ENC_DICT_IDS;
+        for (size_t i = 0; i < count; ++i) {
+            const std::string& value = records[i].*kStringFields[f];
+            auto it = dict_index.find(value);
+            if (it == dict_index.end()) {
+                it = dict_index.emplace(value, static_cast<uint32_t>(dict.size())).first;
+                dict.push_back(&it->first);
+            }
+            putVarint(column, it->second);
+        }
+    }
+
+    encodings[COL_DICTIONARY] = ENC_STRING_TABLE;
+    putVarint(raw[COL_DICTIONARY], dict.size());
+    for (const auto* str : dict) {
+        putString(raw[COL_DICTIONARY], *str);
+    }
+
+    // 时间戳列：可解析时按毫秒差分编码，否则退回字典编码
+    std::vector<int64_t> epoch_ms(count);
+    std::vector<uint8_t> formats(count);
+    bool timestamps_parsed = true;
+    bool mixed_formats = false;
+    for (size_t i = 0; i < count && timestamps_parsed; ++i) {
+        timestamps_parsed = parseTimestamp(records[i].timestamp, epoch_ms[i], formats[i]);
+        if (i > 0 && formats[i] != formats[0]) mixed_formats = true;
+    }
+
+    auto& ts_column = raw[COL_TIMESTAMP];
+    if (timestamps_parsed) {
+        encodings[COL_TIMESTAMP] = ENC_TIMESTAMP_DELTA;
+        if (mixed_formats) {
+            ts_column.push_back(TS_FORMAT_MIXED);
+            ts_column.insert(ts_column.end(), formats.begin(), formats.end());
+        } else {
+            ts_column.push_back(count > 0 ? formats[0] : 0);
+        }
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            putVarint(ts_column, zigzagEncode(epoch_ms[i] - previous));
+            previous = epoch_ms[i];
+        }
+    } else {
+        encodings[COL_TIMESTAMP] = ENC_STRING_TABLE;
+        putVarint(ts_column, count);
+        for (size_t i = 0; i < count; ++i) {
+            putString(ts_column, records[i].timestamp);
+        }
+    }
+
+    // 数量列：差分编码
+    encodings[COL_QUANTITY] = ENC_DELTA_VARINT;
+    int64_t previous_quantity = 0;
+    for (size_t i = 0; i < count; ++i) {
+        putVarint(raw[COL_QUANTITY], zigzagEncode(records[i].quantity - previous_quantity));
+        previous_quantity = records[i].quantity;
+    }
+
+    // 单价列：能精确表示为"分"时差分编码，否则保存原始double
+    bool prices_in_cents = true;
+    std::vector<int64_t> cents(count);
+    for (size_t i = 0; i < count && prices_in_cents; ++i) {
+        double price = records[i].unit_price;
+        if (!(std::fabs(price) < 1e13)) {
+            prices_in_cents = false;
+            break;
+        }
+        cents[i] = std::llround(price * 100.0);
+        prices_in_cents = static_cast<double>(cents[i]) / 100.0 == price;
+    }
+
+    auto& price_column = raw[COL_UNIT_PRICE];
+    if (prices_in_cents) {
+        encodings[COL_UNIT_PRICE] = ENC_PRICE_CENTS_DELTA;
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            putVarint(price_column, zigzagEncode(cents[i] - previous));
+            previous = cents[i];
+        }
+    } else {
+        encodings[COL_UNIT_PRICE] = ENC_RAW_DOUBLE;
+        price_column.resize(count * sizeof(double));
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t bits;
+            std::memcpy(&bits, &records[i].unit_price, sizeof(bits));
+            for (int b = 0; b < 8; ++b) {
+                price_column[i * 8 + b] = static_cast<uint8_t>(bits >> (8 * b));
+            }
+        }
+    }
+
+    // 可选压缩：只在确实变小时保留压缩结果
+    std::vector<std::vector<uint8_t>> stored(COL_COUNT);
+    std::vector<size_t> raw_sizes(COL_COUNT);
+    for (size_t c = 0; c < COL_COUNT; ++c) {
+        raw_sizes[c] = raw[c].size();
+        if (compress && raw[c].size() >= 64) {
+            auto compressed = lzCompress(raw[c].data(), raw[c].size());
+            if (compressed.size() < raw[c].size()) {
+                stored[c].swap(compressed);
+                encodings[c] |= ENC_LZ_FLAG;
+                continue;
+            }
+        }
+        stored[c].swap(raw[c]);
+    }
+
+    // 块头：[manager_id][base_count][record_count][column_count:1][列目录...][header_crc:4]
+    // 列目录项：[id:1][encoding:1][raw_size][stored_size][crc:4]
+    std::vector<uint8_t> header;
+    putString(header, manager_id);
+    putVarint(header, base_count);
+    putVarint(header, count);
+    header.push_back(COL_COUNT);
+    for (size_t c = 0; c < COL_COUNT; ++c) {
+        header.push_back(static_cast<uint8_t>(c));
+        header.push_back(encodings[c]);
+        putVarint(header, raw_sizes[c]);
+        putVarint(header, stored[c].size());
+        putUint32(header, crc32(stored[c].data(), stored[c].size()));
+    }
+    putUint32(header, crc32(header.data(), header.size()));
+
+    size_t body_size = header.size();
+    for (const auto& column : stored) body_size += column.size();
+
+    std::vector<uint8_t> block;
+    block.reserve(8 + body_size);
+    putUint32(block, BLOCK_MAGIC);
+    putUint32(block, static_cast<uint32_t>(body_size));
+    block.insert(block.end(), header.begin(), header.end());
+    for (const auto& column : stored) {
+        block.insert(block.end(), column.begin(), column.end());
+    }
+    return block;
+}
+
+// ========== 解码 ==========
+
+bool ColumnarSnapshot::parseFileHeader(const uint8_t* data, size_t size, FileHeader& header, size_t& header_size) {
+    if (size < 12 || getUint32(data) != FILE_MAGIC) {
+        return false;
+    }
+
+    header.version = data[4];
+    header.flags = data[5];
+    if (header.version != FORMAT_VERSION) {
+        return false;
+    }
+    header.block_count = getUint32(data + 8);
+
+    const uint8_t* p = data + 12;
+    const uint8_t* end = data + size;
+    if (!getVarint(p, end, header.wal_segment)) {
+        return false;
+    }
+    header.base_segment = 0;
+    if (header.isDelta() && !getVarint(p, end, header.base_segment)) {
+        return false;
+    }
+    if (!getString(p, end, header.created_at) || end - p < 4) {
+        return false;
+    }
+
+    size_t covered = static_cast<size_t>(p - data);
+    if (getUint32(p) != crc32(data, covered)) {
+        return false;
+    }
+
+    header_size = covered + 4;
+    return true;
+}
+
+bool ColumnarSnapshot::parseBlock(const uint8_t* data, size_t size, BlockInfo& info) {
+    if (size < 8 || getUint32(data) != BLOCK_MAGIC) {
+        return false;
+    }
+
+    uint32_t body_size = getUint32(data + 4);
+    if (body_size > size - 8) {
+        return false;
+    }
+
+    const uint8_t* body = data + 8;
+    const uint8_t* p = body;
+    const uint8_t* end = body + body_size;
+
+    uint64_t base_count, record_count;
+    if (!getString(p, end, info.manager_id) ||
+        !getVarint(p, end, base_count) ||
+        !getVarint(p, end, record_count) ||
+        p >= end) {
+        return false;
+    }
+    info.base_count = base_count;
+    info.record_count = static_cast<uint32_t>(record_count);
+
+    uint8_t column_count = *p++;
+    info.columns.clear();
+    info.columns.reserve(column_count);
+    for (uint8_t c = 0; c < column_count; ++c) {
+        ColumnInfo column;
+        uint64_t raw_size, stored_size;
+        if (end - p < 2) return false;
+        column.id = *p++;
+        column.encoding = *p++;
+        if (!getVarint(p, end, raw_size) || !getVarint(p, end, stored_size) || end - p < 4) {
+            return false;
+        }
+        column.raw_size = static_cast<uint32_t>(raw_size);
+        column.stored_size = static_cast<uint32_t>(stored_size);
+        column.checksum = getUint32(p);
+        p += 4;
+        info.columns.push_back(column);
+    }
+
+    if (end - p < 4 || getUint32(p) != crc32(body, static_cast<size_t>(p - body))) {
+        return false;
+    }
+    p += 4;
+
+    // 列数据按目录顺序紧随块头
+    for (auto& column : info.columns) {
+        if (column.stored_size > static_cast<size_t>(end - p)) {
+            return false;
+        }
+        column.data = p;
+        p += column.stored_size;
+    }
+
+    if (p != end) {
+        return false;
+    }
+
+    info.block_size = 8 + body_size;
+    return true;
+}
+
+bool ColumnarSnapshot::loadColumn(const ColumnInfo& column, std::vector<uint8_t>& raw) {
+    if (crc32(column.data, column.stored_size) != column.checksum) {
+        return false;
+    }
+
+    if (column.encoding & ENC_LZ_FLAG) {
+        return lzDecompress(column.data, column.stored_size, column.raw_size, raw);
+    }
+
+    raw.assign(column.data, column.data + column.stored_size);
+    return true;
+}
+
+bool ColumnarSnapshot::decodeBlockFrom(const BlockInfo& info, uint64_t from_position,
+                                       std::vector<TransactionRecord>& records) {
+    if (from_position <= info.base_count) {
+        return decodeBlock(info, records);
+    }
+    if (from_position >= info.base_count + info.record_count) {
+        return true;
+    }
+
+    std::vector<TransactionRecord> block_records;
+    if (!decodeBlock(info, block_records)) {
+        return false;
+    }
+    records.insert(records.end(),
+                   std::make_move_iterator(block_records.begin() + (from_position - info.base_count)),
+                   std::make_move_iterator(block_records.end()));
+    return true;
+}
+
+bool ColumnarSnapshot::verifyBlock(const BlockInfo& info) {
+    for (const auto& column : info.columns) {
+        if (crc32(column.data, column.stored_size) != column.checksum) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ColumnarSnapshot::decodeBlock(const BlockInfo& info, std::vector<TransactionRecord>& records) {
+    const size_t count = info.record_count;
+    std::vector<uint8_t> raw;
+
+    // 字典
+    const ColumnInfo* dict_column = info.findColumn(COL_DICTIONARY);
+    if (!dict_column || !loadColumn(*dict_column, raw)) {
+        return false;
+    }
+
+    std::vector<std::string> dict;
+    {
+        const uint8_t* p = raw.data();
+        const uint8_t* end = p + raw.size();
+        uint64_t dict_size;
+        if (!getVarint(p, end, dict_size) || dict_size > raw.size()) {
+            return false;
+        }
+        dict.resize(static_cast<size_t>(dict_size));
+        for (auto& str : dict) {
+            if (!getString(p, end, str)) return false;
+        }
+    }
+
+    const size_t first = records.size();
+    records.resize(first + count);
+    TransactionRecord* out = records.data() + first;
+
+    // 字符串列
+    for (size_t f = 0; f < kStringFieldCount; ++f) {
+        const ColumnInfo* column = info.findColumn(static_cast<uint8_t>(COL_TRANS_ID + f));
+        if (!column || (column->encoding & ~ENC_LZ_FLAG) != ENC_DICT_IDS || !loadColumn(*column, raw)) {
+            records.resize(first);
+            return false;
+        }
+
+        const uint8_t* p = raw.data();
+        const uint8_t* end = p + raw.size();
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t id;
+            if (!getVarint(p, end, id) || id >= dict.size()) {
+                records.resize(first);
+                return false;
+            }
+            out[i].*kStringFields[f] = dict[static_cast<size_t>(id)];
+        }
+    }
+
+    // 时间戳列
+    const ColumnInfo* ts_column = info.findColumn(COL_TIMESTAMP);
+    if (!ts_column || !loadColumn(*ts_column, raw)) {
+        records.resize(first);
+        return false;
+    }
+    {
+        const uint8_t* p = raw.data();
+        const uint8_t* end = p + raw.size();
+        uint8_t encoding = ts_column->encoding & ~ENC_LZ_FLAG;
+        bool ok = true;
+
+        if (encoding == ENC_TIMESTAMP_DELTA) {
+            const uint8_t* formats = nullptr;
+            uint8_t format = 0;
+            if (p >= end) ok = false;
+            else format = *p++;
+            if (ok && format == TS_FORMAT_MIXED) {
+                if (static_cast<size_t>(end - p) < count) ok = false;
+                else {
+                    formats = p;
+                    p += count;
+                }
+            }
+
+            int64_t previous = 0;
+            for (size_t i = 0; i < count && ok; ++i) {
+                uint64_t delta;
+                ok = getVarint(p, end, delta);
+                previous += zigzagDecode(delta);
+                out[i].timestamp = formatTimestamp(previous, formats ? formats[i] : format);
+            }
+        } else if (encoding == ENC_STRING_TABLE) {
+            uint64_t stored_count;
+            ok = getVarint(p, end, stored_count) && stored_count == count;
+            for (size_t i = 0; i < count && ok; ++i) {
+                ok = getString(p, end, out[i].timestamp);
+            }
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            records.resize(first);
+            return false;
+        }
+    }
+
+    // 数量列
+    const ColumnInfo* quantity_column = info.findColumn(COL_QUANTITY);
+    if (!quantity_column || !loadColumn(*quantity_column, raw)) {
+        records.resize(first);
+        return false;
+    }
+    {
+        const uint8_t* p = raw.data();
+        const uint8_t* end = p + raw.size();
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t delta;
+            if (!getVarint(p, end, delta)) {
+                records.resize(first);
+                return false;
+            }
+            previous += zigzagDecode(delta);
+            out[i].quantity = static_cast<int>(previous);
+        }
+    }
+
+    // 单价列
+    const ColumnInfo* price_column = info.findColumn(COL_UNIT_PRICE);
+    if (!price_column || !loadColumn(*price_column, raw)) {
+        records.resize(first);
+        return false;
+    }
+    {
+        uint8_t encoding = price_column->encoding & ~ENC_LZ_FLAG;
+        if (encoding == ENC_PRICE_CENTS_DELTA) {
+            const uint8_t* p = raw.data();
+            const uint8_t* end = p + raw.size();
+            int64_t previous = 0;
+            for (size_t i = 0; i < count; ++i) {
+                uint64_t delta;
+                if (!getVarint(p, end, delta)) {
+                    records.resize(first);
+                    return false;
+                }
+                previous += zigzagDecode(delta);
+                out[i].unit_price = static_cast<double>(previous) / 100.0;
+            }
+        } else if (encoding == ENC_RAW_DOUBLE && raw.size() == count * sizeof(double)) {
+            for (size_t i = 0; i < count; ++i) {
+                uint64_t bits = 0;
+                for (int b = 0; b < 8; ++b) {
+                    bits |= static_cast<uint64_t>(raw[i * 8 + b]) << (8 * b);
+                }
+                std::memcpy(&out[i].unit_price, &bits, sizeof(bits));
+            }
+        } else {
+            records.resize(first);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ========== 库存检查点 ==========
+
+std::vector<uint8_t> ColumnarSnapshot::encodeCheckpoint(const std::string& manager_id,
+                                                        const InventoryCheckpoint& checkpoint) {
+    std::vector<uint8_t> payload;
+    putString(payload, manager_id);
+    putVarint(payload, checkpoint.position);
+    putString(payload, checkpoint.last_trans_id);
+    putString(payload, checkpoint.max_timestamp);
+    putVarint(payload, checkpoint.balances.size());
+    for (const auto& balance : checkpoint.balances) {
+        putString(payload, balance.first.first);
+        putString(payload, balance.first.second);
+        putVarint(payload, zigzagEncode(balance.second.quantity));
+        uint64_t price_bits;
+        std::memcpy(&price_bits, &balance.second.avg_price, sizeof(price_bits));
+        putUint32(payload, static_cast<uint32_t>(price_bits));
+        putUint32(payload, static_cast<uint32_t>(price_bits >> 32));
+    }
+
+    std::vector<uint8_t> record;
+    record.reserve(payload.size() + 12);
+    putUint32(record, CHECKPOINT_MAGIC);
+    putUint32(record, static_cast<uint32_t>(payload.size()));
+    putUint32(record, crc32(payload.data(), payload.size()));
+    record.insert(record.end(), payload.begin(), payload.end());
+    return record;
+}
+
+size_t ColumnarSnapshot::decodeCheckpoint(const uint8_t* data, size_t size,
+                                          std::string& manager_id, InventoryCheckpoint& checkpoint) {
+    if (size < 12 || getUint32(data) != CHECKPOINT_MAGIC) {
+        return 0;
+    }
+    uint32_t payload_size = getUint32(data + 4);
+    if (payload_size > size - 12 || getUint32(data + 8) != crc32(data + 12, payload_size)) {
+        return 0;
+    }
+
+    const uint8_t* p = data + 12;
+    const uint8_t* end = p + payload_size;
+    uint64_t entry_count;
+    if (!getString(p, end, manager_id) ||
+        !getVarint(p, end, checkpoint.position) ||
+        !getString(p, end, checkpoint.last_trans_id) ||
+        !getString(p, end, checkpoint.max_timestamp) ||
+        !getVarint(p, end, entry_count)) {
+        return 0;
+    }
+
+    checkpoint.balances.clear();
+    for (uint64_t i = 0; i < entry_count; ++i) {
+        std::string warehouse_id, item_id;
+        uint64_t quantity;
+        if (!getString(p, end, warehouse_id) || !getString(p, end, item_id) ||
+            !getVarint(p, end, quantity) || end - p < 8) {
+            return 0;
+        }
+        uint64_t price_bits = getUint32(p) | (static_cast<uint64_t>(getUint32(p + 4)) << 32);
+        p += 8;
+
+        InventoryRecord& record = checkpoint.balances[std::make_pair(warehouse_id, item_id)];
+        record.warehouse_id = warehouse_id;
+        record.item_id = item_id;
+        record.quantity = static_cast<int>(zigzagDecode(quantity));
+        std::memcpy(&record.avg_price, &price_bits, sizeof(price_bits));
+    }
+
+    return 12 + payload_size;
+}
+
+// ========== 工具方法 ==========
+
+uint32_t ColumnarSnapshot::crc32(const uint8_t* data, size_t size) {
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    } table;
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+std::vector<uint8_t> ColumnarSnapshot::lzCompress(const uint8_t* data, size_t size) {
+    std::vector<uint8_t> out;
+    out.reserve(size / 2 + 16);
+
+    size_t anchor = 0;
+    if (size > LZ_MIN_MATCH + LZ_TAIL_LITERALS) {
+        // 哈希表保存"位置+1"，0表示空
+        std::vector<uint32_t> table(1u << LZ_HASH_BITS, 0);
+        const size_t match_limit = size - LZ_TAIL_LITERALS;
+        size_t i = 0;
+
+        while (i + LZ_MIN_MATCH <= match_limit) {
+            uint32_t sequence = readRaw32(data + i);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+            size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(i + 1);
+
+            if (candidate != 0 && i - (candidate - 1) <= LZ_MAX_OFFSET &&
+                readRaw32(data + candidate - 1) == sequence) {
+                size_t match = candidate - 1;
+                size_t length = LZ_MIN_MATCH;
+                while (i + length < match_limit && data[match + length] == data[i + length]) {
+                    ++length;
+                }
+
+                emitSequence(out, data + anchor, i - anchor, i - match, length);
+                i += length;
+                anchor = i;
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    emitLastLiterals(out, data + anchor, size - anchor);
+    return out;
+}
+
+bool ColumnarSnapshot::lzDecompress(const uint8_t* data, size_t size, size_t raw_size, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(raw_size);
+
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+
+    while (p < end) {
+        uint8_t token = *p++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !getLength(p, end, literal_length)) return false;
+        if (literal_length > static_cast<size_t>(end - p) || out.size() + literal_length > raw_size) {
+            return false;
+        }
+        out.insert(out.end(), p, p + literal_length);
+        p += literal_length;
+
+        if (p == end) break;  // 最后一个序列只有字面量
+
+        if (end - p < 2) return false;
+        size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+        p += 2;
+        if (offset == 0 || offset > out.size()) return false;
+
+        size_t match_length = token & 0x0F;
+        if (match_length == 15 && !getLength(p, end, match_length)) return false;
+        match_length += LZ_MIN_MATCH;
+        if (out.size() + match_length > raw_size) return false;
+
+        // 允许重叠拷贝（重复模式）
+        size_t from = out.size() - offset;
+        for (size_t k = 0; k < match_length; ++k) {
+            out.push_back(out[from + k]);
+        }
+    }
+
+    return out.size() == raw_size;
+}
+
+bool ColumnarSnapshot::parseTimestamp(const std::string& timestamp, int64_t& epoch_ms, uint8_t& format) {
+    // 支持的格式：
+    //   1: YYYY-MM-DDTHH:MM:SS
+    //   2: YYYY-MM-DDTHH:MM:SSZ
+    //   3: YYYY-MM-DDTHH:MM:SS.mmmZ
+    //   4: YYYY-MM-DDTHH:MM:SS.mmm
+    switch (timestamp.size()) {
+        case 19: format = 1; break;
+        case 20: format = 2; break;
+        case 24: format = 3; break;
+        case 23: format = 4; break;
+        default: return false;
+    }
+
+    int year, month, day, hour, minute, second, millis = 0;
+    if (timestamp[4] != '-' || timestamp[7] != '-' || timestamp[10] != 'T' ||
+        timestamp[13] != ':' || timestamp[16] != ':' ||
+        !parseDigits(timestamp, 0, 4, year) || !parseDigits(timestamp, 5, 2, month) ||
+        !parseDigits(timestamp, 8, 2, day) || !parseDigits(timestamp, 11, 2, hour) ||
+        !parseDigits(timestamp, 14, 2, minute) || !parseDigits(timestamp, 17, 2, second)) {
+        return false;
+    }
+
+    if (format == 2 && timestamp[19] != 'Z') return false;
+    if (format == 3 || format == 4) {
+        if (timestamp[19] != '.' || !parseDigits(timestamp, 20, 3, millis)) return false;
+        if (format == 3 && timestamp[23] != 'Z') return false;
+    }
+
+    int64_t days = daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day));
+    epoch_ms = ((days * 24 + hour) * 60 + minute) * 60 + second;
+    epoch_ms = epoch_ms * 1000 + millis;
+
+    // 非法日期（如13月）无法无损还原，交给字典编码处理
+    return formatTimestamp(epoch_ms, format) == timestamp;
+}
+
+std::string ColumnarSnapshot::formatTimestamp(int64_t epoch_ms, uint8_t format) {
+    int64_t seconds = epoch_ms >= 0 ? epoch_ms / 1000 : (epoch_ms - 999) / 1000;
+    int millis = static_cast<int>(epoch_ms - seconds * 1000);
+    int64_t days = seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+    int64_t second_of_day = seconds - days * 86400;
+
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02uT%02d:%02d:%02d",
+                               static_cast<long long>(year), month, day,
+                               static_cast<int>(second_of_day / 3600),
+                               static_cast<int>(second_of_day / 60 % 60),
+                               static_cast<int>(second_of_day % 60));
+    std::string result(buffer, length > 0 ? static_cast<size_t>(length) : 0);
+
+    if (format == 3 || format == 4) {
+        std::snprintf(buffer, sizeof(buffer), ".%03d", millis);
+        result += buffer;
+    }
+    if (format == 2 || format == 3) {
+        result += 'Z';
+    }
+    return result;
+}
+
+// ========== MappedSnapshot 实现 ==========
+
+MappedSnapshot::~MappedSnapshot() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    if (fd_ != -1) {
+        close(fd_);
+    }
+}
+
+std::shared_ptr<MappedSnapshot> MappedSnapshot::open(const std::string& path, std::string& error) {
+    std::shared_ptr<MappedSnapshot> snapshot(new MappedSnapshot());
+    snapshot->path_ = path;
+
+    snapshot->fd_ = ::open(path.c_str(), O_RDONLY);
+    if (snapshot->fd_ == -1) {
+        error = "Cannot open snapshot file: " + path;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(snapshot->fd_, &st) != 0 || st.st_size == 0) {
+        error = "Empty or unreadable snapshot file: " + path;
+        return nullptr;
+    }
+    snapshot->size_ = static_cast<size_t>(st.st_size);
+
+    void* addr = mmap(nullptr, snapshot->size_, PROT_READ, MAP_PRIVATE, snapshot->fd_, 0);
+    if (addr == MAP_FAILED) {
+        error = "Failed to mmap snapshot file: " + path;
+        return nullptr;
+    }
+    snapshot->data_ = static_cast<const uint8_t*>(addr);
+
+    // 映射建立后不再需要文件描述符，库管员很多时避免耗尽描述符
+    close(snapshot->fd_);
+    snapshot->fd_ = -1;
+
+    size_t offset = 0;
+    if (!ColumnarSnapshot::parseFileHeader(snapshot->data_, snapshot->size_, snapshot->header_, offset)) {
+        error = "Invalid snapshot header: " + path;
+        return nullptr;
+    }
+
+    // 只遍历块头，列数据保持未触碰，由内核按需换入
+    snapshot->blocks_.resize(snapshot->header_.block_count);
+    for (uint32_t i = 0; i < snapshot->header_.block_count; ++i) {
+        auto& block = snapshot->blocks_[i];
+        if (!ColumnarSnapshot::parseBlock(snapshot->data_ + offset, snapshot->size_ - offset, block)) {
+            error = "Corrupted block #" + std::to_string(i) + " in " + path;
+            return nullptr;
+        }
+        offset += block.block_size;
+    }
+
+    return snapshot;
+}
+
+bool MappedSnapshot::verify() const {
+    for (const auto& block : blocks_) {
+        if (!ColumnarSnapshot::verifyBlock(block)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,191 @@
+#ifndef COLUMNAR_SNAPSHOT_H
+#define COLUMNAR_SNAPSHOT_H
+
+#include "transaction.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// 列式快照格式：紧凑、可快速加载的快照文件
+// 字符串字典编码，时间戳/数量差分编码，每列独立校验和，可选内置LZ压缩
+class ColumnarSnapshot {
+public:
+    // ========== 格式常量 ==========
+
+    static const uint32_t FILE_MAGIC = 0x53534D57;     // "WMSS"（小端）
+    static const uint32_t BLOCK_MAGIC = 0x42534D57;    // "WMSB"（小端）
+    static const uint8_t FORMAT_VERSION = 1;
+
+    // 文件标志位
+    enum FileFlags : uint8_t {
+        FILE_COMPRESSED = 0x01,         // 块内列数据使用LZ压缩
+        FILE_DELTA = 0x02               // 增量快照：只含上一个快照之后追加的记录
+    };
+
+    // 列ID
+    enum ColumnId : uint8_t {
+        COL_DICTIONARY = 0,             // 字符串字典
+        COL_TRANS_ID = 1,
+        COL_ITEM_ID = 2,
+        COL_ITEM_NAME = 3,
+        COL_TYPE = 4,
+        COL_MANAGER_ID = 5,
+        COL_NOTE = 6,
+        COL_CATEGORY = 7,
+        COL_MODEL = 8,
+        COL_UNIT = 9,
+        COL_PARTNER_ID = 10,
+        COL_PARTNER_NAME = 11,
+        COL_WAREHOUSE_ID = 12,
+        COL_DOCUMENT_NO = 13,
+        COL_TIMESTAMP = 14,
+        COL_QUANTITY = 15,
+        COL_UNIT_PRICE = 16,
+        COL_COUNT = 17
+    };
+
+    // 列编码方式（最高位表示LZ压缩）
+    enum ColumnEncoding : uint8_t {
+        ENC_STRING_TABLE = 0x01,        // 长度前缀字符串表
+        ENC_DICT_IDS = 0x02,            // 字典ID（varint）
+        ENC_DELTA_VARINT = 0x03,        // zigzag差分varint
+        ENC_TIMESTAMP_DELTA = 0x04,     // 时间格式 + 毫秒差分
+        ENC_PRICE_CENTS_DELTA = 0x05,   // 以分为单位的差分varint
+        ENC_RAW_DOUBLE = 0x06,          // 原始8字节double
+        ENC_LZ_FLAG = 0x80
+    };
+
+    // ========== 结构定义 ==========
+
+    // 文件头
+    struct FileHeader {
+        uint8_t version;
+        uint8_t flags;
+        uint32_t block_count;
+        uint64_t wal_segment;           // 快照已包含的最后一个WAL段序号
+        uint64_t base_segment;          // 增量快照所基于的快照的WAL段序号（仅FILE_DELTA）
+        std::string created_at;
+
+        FileHeader() : version(FORMAT_VERSION), flags(0), block_count(0), wal_segment(0), base_segment(0) {}
+
+        bool isDelta() const { return (flags & FILE_DELTA) != 0; }
+    };
+
+    // 列描述（指向原始缓冲区，不拷贝数据）
+    struct ColumnInfo {
+        uint8_t id;
+        uint8_t encoding;
+        uint32_t raw_size;              // 解压后大小
+        uint32_t stored_size;           // 存储大小
+        uint32_t checksum;              // 存储数据的CRC32
+        const uint8_t* data;
+
+        ColumnInfo() : id(0), encoding(0), raw_size(0), stored_size(0), checksum(0), data(nullptr) {}
+    };
+
+    // 库管员数据块描述（解析块头即可获得，无需解码记录）
+    struct BlockInfo {
+        std::string manager_id;
+        uint64_t base_count;            // 块内第一条记录在该库管员序列中的位置
+        uint32_t record_count;
+        std::vector<ColumnInfo> columns;
+        size_t block_size;              // 整个块占用的字节数
+
+        BlockInfo() : base_count(0), record_count(0), block_size(0) {}
+
+        const ColumnInfo* findColumn(uint8_t id) const;
+    };
+
+    // ========== 编码 ==========
+
+    // 编码文件头（delta 为真时写入 base_segment，块的 base_count 可以非零）
+    static std::vector<uint8_t> encodeFileHeader(uint32_t block_count, uint64_t wal_segment,
+                                                 const std::string& created_at, bool compressed,
+                                                 bool delta = false, uint64_t base_segment = 0);
+
+    // 编码一个库管员的数据块：records[0..count) 对应序列位置 [base_count, base_count + count)
+    static std::vector<uint8_t> encodeBlock(const std::string& manager_id, uint64_t base_count,
+                                            const TransactionRecord* records, size_t count,
+                                            bool compress);
+
+    // ========== 解码 ==========
+
+    // 解析文件头
+    static bool parseFileHeader(const uint8_t* data, size_t size, FileHeader& header, size_t& header_size);
+
+    // 解析块头（只校验块头，列数据在解码时校验）
+    static bool parseBlock(const uint8_t* data, size_t size, BlockInfo& info);
+
+    // 解码整个块，追加到 records
+    static bool decodeBlock(const BlockInfo& info, std::vector<TransactionRecord>& records);
+
+    // 解码块内序列位置不小于 from_position 的记录，追加到 records（跳过已由其他文件覆盖的前缀）
+    static bool decodeBlockFrom(const BlockInfo& info, uint64_t from_position, std::vector<TransactionRecord>& records);
+
+    // 只校验块内所有列的校验和，不解码
+    static bool verifyBlock(const BlockInfo& info);
+
+    // ========== 库存检查点 ==========
+
+    static const uint32_t CHECKPOINT_MAGIC = 0x4B434D57;   // "WMCK"（小端）
+
+    // 编码一条检查点记录：[magic:4][payload_size:4][crc:4][payload]，可连续追加到同一文件
+    static std::vector<uint8_t> encodeCheckpoint(const std::string& manager_id, const InventoryCheckpoint& checkpoint);
+
+    // 解析一条检查点记录，返回占用的字节数；数据不完整或校验失败时返回0
+    static size_t decodeCheckpoint(const uint8_t* data, size_t size,
+                                   std::string& manager_id, InventoryCheckpoint& checkpoint);
+
+    // ========== 工具方法 ==========
+
+    // CRC32（IEEE 802.3）
+    static uint32_t crc32(const uint8_t* data, size_t size);
+
+    // 内置LZ压缩（LZ77变体，64KB窗口）
+    static std::vector<uint8_t> lzCompress(const uint8_t* data, size_t size);
+    static bool lzDecompress(const uint8_t* data, size_t size, size_t raw_size, std::vector<uint8_t>& out);
+
+    // ISO 8601时间戳与毫秒时间的互转（用于时间戳差分编码）
+    static bool parseTimestamp(const std::string& timestamp, int64_t& epoch_ms, uint8_t& format);
+    static std::string formatTimestamp(int64_t epoch_ms, uint8_t format);
+
+private:
+    // 读取某列并完成校验、解压
+    static bool loadColumn(const ColumnInfo& column, std::vector<uint8_t>& raw);
+};
+
+// ========== 内存映射快照 ==========
+
+// 只读映射的快照文件：打开时只解析文件头和块头，记录在需要时才解码
+class MappedSnapshot {
+public:
+    ~MappedSnapshot();
+
+    // 映射并校验快照文件，失败时返回空指针并填写 error
+    static std::shared_ptr<MappedSnapshot> open(const std::string& path, std::string& error);
+
+    const std::string& getPath() const { return path_; }
+    const ColumnarSnapshot::FileHeader& getHeader() const { return header_; }
+    const std::vector<ColumnarSnapshot::BlockInfo>& getBlocks() const { return blocks_; }
+    size_t getMappedSize() const { return size_; }
+
+    // 校验所有块的列数据（会读入整个文件）
+    bool verify() const;
+
+private:
+    MappedSnapshot() : fd_(-1), data_(nullptr), size_(0) {}
+
+    // 禁用拷贝
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    std::string path_;
+    int fd_;
+    const uint8_t* data_;
+    size_t size_;
+    ColumnarSnapshot::FileHeader header_;
+    std::vector<ColumnarSnapshot::BlockInfo> blocks_;
+};
+
+#endif // COLUMNAR_SNAPSHOT_H
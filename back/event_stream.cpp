@@ -0,0 +1,143 @@
+#include "event_stream.h"
+#include "monitoring.h"
+#include <algorithm>
+
+// ========== EventSubscription ==========
+
+EventSubscription::EventSubscription(const std::string& manager_id, size_t from, size_t max_pending)
+    : manager_id_(manager_id), max_pending_(max_pending), next_position_(from),
+      notified_(false), overflowed_(false) {}
+
+void EventSubscription::publish(size_t position, const std::shared_ptr<const std::string>& event) {
+    Notifier notifier;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (position < next_position_ || overflowed_) {
+            return;
+        }
+        next_position_ = position + 1;
+        if (pending_.size() >= max_pending_) {
+            // 不再积压，等待事件循环断开连接
+            overflowed_ = true;
+            pending_.clear();
+        } else {
+            pending_.push_back(event);
+        }
+        if (notifier_ && !notified_) {
+            notified_ = true;
+            notifier = notifier_;
+        }
+    }
+    if (notifier) {
+        notifier();
+    }
+}
+
+void EventSubscription::advanceTo(size_t position) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (position <= next_position_ - pending_.size()) {
+        return;
+    }
+    // 队列中的事件位置连续，丢弃位于 position 之前的部分
+    size_t first = next_position_ - pending_.size();
+    size_t drop = std::min(position - first, pending_.size());
+    pending_.erase(pending_.begin(), pending_.begin() + drop);
+    next_position_ = std::max(next_position_, position);
+}
+
+void EventSubscription::attach(Notifier notifier) {
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        notifier_ = notifier;
+        notify = !pending_.empty() || overflowed_;
+        notified_ = notify;
+    }
+    if (notify) {
+        notifier();
+    }
+}
+
+bool EventSubscription::drain(std::string& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notified_ = false;
+    if (overflowed_) {
+        return false;
+    }
+    for (const auto& event : pending_) {
+        out += *event;
+    }
+    pending_.clear();
+    return true;
+}
+
+// ========== EventStreamHub ==========
+
+EventStreamHub::EventStreamHub(Serializer serializer, size_t max_pending)
+    : serializer_(std::move(serializer)), max_pending_(max_pending), subscriber_count_(0) {}
+
+std::shared_ptr<EventSubscription> EventStreamHub::subscribe(const std::string& manager_id, size_t from) {
+    auto subscription = std::make_shared<EventSubscription>(manager_id, from, max_pending_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_[manager_id].push_back(subscription);
+    SET_GAUGE("sse_subscribers", ++subscriber_count_);
+    return subscription;
+}
+
+void EventStreamHub::unsubscribe(const std::shared_ptr<EventSubscription>& subscription) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscribers_.find(subscription->getManagerId());
+    if (it == subscribers_.end()) {
+        return;
+    }
+    auto& list = it->second;
+    auto found = std::find(list.begin(), list.end(), subscription);
+    if (found == list.end()) {
+        return;
+    }
+    list.erase(found);
+    if (list.empty()) {
+        subscribers_.erase(it);
+    }
+    SET_GAUGE("sse_subscribers", --subscriber_count_);
+}
+
+void EventStreamHub::closeAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_.clear();
+    subscriber_count_ = 0;
+    SET_GAUGE("sse_subscribers", 0);
+}
+
+void EventStreamHub::publish(const std::string& manager_id, const TransactionRecord& trans, size_t position) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscribers_.find(manager_id);
+    if (it == subscribers_.end()) {
+        return;
+    }
+
+    auto event = std::make_shared<std::string>();
+    appendEvent(publish_writer_, trans, position, *event);
+    std::shared_ptr<const std::string> shared = std::move(event);
+    for (const auto& subscription : it->second) {
+        subscription->publish(position, shared);
+    }
+    INC_COUNTER_BY("sse_events_published", it->second.size());
+}
+
+void EventStreamHub::appendEvent(JsonWriter& json, const TransactionRecord& trans, size_t position,
+                                 std::string& out) const {
+    json.clear();
+    serializer_(json, trans);
+    // 转义后的JSON不含换行，整条记录放在一行 data 中
+    out += "id: ";
+    out += std::to_string(position + 1);
+    out += "\nevent: transaction\ndata: ";
+    out += json.str();
+    out += "\n\n";
+}
+
+size_t EventStreamHub::getSubscriberCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscriber_count_;
+}
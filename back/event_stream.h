@@ -0,0 +1,79 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include "transaction.h"
+#include "json_writer.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <functional>
+
+// 新交易记录的推送订阅（Server-Sent Events），每个 SSE 连接一个
+// 追加监听把事件放入队列后通知连接所在的事件循环，事件循环一次取走全部积压事件合并发送
+class EventSubscription {
+public:
+    typedef std::function<void()> Notifier;
+
+    EventSubscription(const std::string& manager_id, size_t from, size_t max_pending);
+
+    const std::string& getManagerId() const { return manager_id_; }
+
+    // 追加监听中调用：序列位置小于起点的事件已随积压记录发出，直接丢弃
+    void publish(size_t position, const std::shared_ptr<const std::string>& event);
+
+    // 积压记录已发送到 position 之前，丢弃更早的事件
+    void advanceTo(size_t position);
+
+    // 事件循环接管订阅：此后有新事件时调用 notifier（取走之前只通知一次），已有积压时立即通知
+    void attach(Notifier notifier);
+
+    // 把积压事件追加到 out；积压超过上限（客户端跟不上）时返回 false，连接应关闭并由客户端续传
+    bool drain(std::string& out);
+
+private:
+    std::string manager_id_;
+    size_t max_pending_;
+    std::mutex mutex_;
+    size_t next_position_;
+    std::deque<std::shared_ptr<const std::string>> pending_;
+    Notifier notifier_;
+    bool notified_;
+    bool overflowed_;
+};
+
+// 按库管员分发新记录事件：每条记录只编码一次，由该库管员的所有订阅共享
+// 事件 id 为下一条记录的序列位置，与交易列表的 next_cursor 相同，可直接作为 Last-Event-ID 续传
+class EventStreamHub {
+public:
+    typedef std::function<void(JsonWriter& json, const TransactionRecord& trans)> Serializer;
+
+    EventStreamHub(Serializer serializer, size_t max_pending);
+
+    // 订阅序列位置 from 及之后的记录
+    std::shared_ptr<EventSubscription> subscribe(const std::string& manager_id, size_t from);
+    void unsubscribe(const std::shared_ptr<EventSubscription>& subscription);
+
+    // 服务器停止时调用，之后不再通知任何订阅
+    void closeAll();
+
+    // 作为 MemoryDatabase 的追加监听调用（写锁内，按写入顺序）
+    void publish(const std::string& manager_id, const TransactionRecord& trans, size_t position);
+
+    // 把位于 position 的记录编码为一个事件追加到 out
+    void appendEvent(JsonWriter& json, const TransactionRecord& trans, size_t position, std::string& out) const;
+
+    size_t getSubscriberCount() const;
+
+private:
+    Serializer serializer_;
+    size_t max_pending_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<EventSubscription>>> subscribers_;
+    size_t subscriber_count_;
+    JsonWriter publish_writer_;     // 只在 publish 中使用，受 mutex_ 保护
+};
+
+#endif // EVENT_STREAM_H
@@ -0,0 +1,114 @@
+#include "http_compression.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+// 每次交给 zlib 的输入和输出的块大小（z_stream 的长度字段是 32 位）
+const size_t kChunkBytes = 256 * 1024;
+
+std::string trimLower(const std::string& value, size_t start, size_t end) {
+    while (start < end && (value[start] == ' ' || value[start] == '\t')) {
+        ++start;
+    }
+    while (end > start && (value[end - 1] == ' ' || value[end - 1] == '\t')) {
+        --end;
+    }
+    std::string result = value.substr(start, end - start);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+} // namespace
+
+HttpCompression::Encoding HttpCompression::negotiate(const std::string& accept_encoding) {
+    // 未出现的编码 q 值为 -1，"*" 适用于未单独列出的编码
+    double gzip = -1, deflate = -1, any = -1;
+    size_t start = 0;
+    while (start <= accept_encoding.size()) {
+        size_t end = accept_encoding.find(',', start);
+        if (end == std::string::npos) {
+            end = accept_encoding.size();
+        }
+        size_t semicolon = accept_encoding.find(';', start);
+        size_t token_end = semicolon < end ? semicolon : end;
+        std::string coding = trimLower(accept_encoding, start, token_end);
+
+        double q = 1.0;
+        if (semicolon < end) {
+            std::string param = trimLower(accept_encoding, semicolon + 1, end);
+            if (param.compare(0, 2, "q=") == 0) {
+                q = std::strtod(param.c_str() + 2, nullptr);
+            }
+        }
+
+        if (coding == "gzip" || coding == "x-gzip") {
+            gzip = q;
+        } else if (coding == "deflate") {
+            deflate = q;
+        } else if (coding == "*") {
+            any = q;
+        }
+        start = end + 1;
+    }
+
+    if (gzip < 0) gzip = any;
+    if (deflate < 0) deflate = any;
+    if (gzip <= 0 && deflate <= 0) {
+        return Encoding::IDENTITY;
+    }
+    return gzip >= deflate ? Encoding::GZIP : Encoding::DEFLATE;
+}
+
+const char* HttpCompression::name(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::GZIP: return "gzip";
+        case Encoding::DEFLATE: return "deflate";
+        default: return "identity";
+    }
+}
+
+bool HttpCompression::compress(const std::string& input, Encoding encoding, int level, std::string& output) {
+    if (encoding == Encoding::IDENTITY) {
+        return false;
+    }
+
+    // windowBits 加 16 输出 gzip 头部和尾部，否则输出 zlib 格式
+    z_stream stream{};
+    int window_bits = encoding == Encoding::GZIP ? 15 + 16 : 15;
+    if (deflateInit2(&stream, std::clamp(level, 1, 9), Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    // 分块输入、分块扩展输出，大响应不需要按最坏情况一次分配
+    output.clear();
+    size_t consumed = 0;
+    int result = Z_OK;
+    while (result != Z_STREAM_END) {
+        if (stream.avail_in == 0 && consumed < input.size()) {
+            size_t take = std::min(kChunkBytes, input.size() - consumed);
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data() + consumed));
+            stream.avail_in = static_cast<uInt>(take);
+            consumed += take;
+        }
+        int flush = consumed == input.size() ? Z_FINISH : Z_NO_FLUSH;
+
+        size_t written = output.size();
+        output.resize(written + kChunkBytes);
+        stream.next_out = reinterpret_cast<Bytef*>(&output[written]);
+        stream.avail_out = static_cast<uInt>(kChunkBytes);
+        result = deflate(&stream, flush);
+        output.resize(written + kChunkBytes - stream.avail_out);
+
+        if (result == Z_STREAM_ERROR) {
+            deflateEnd(&stream);
+            return false;
+        }
+    }
+
+    deflateEnd(&stream);
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef HTTP_COMPRESSION_H
+#define HTTP_COMPRESSION_H
+
+#include <string>
+#include <cstddef>
+
+// 响应压缩：按 Accept-Encoding 协商 gzip / deflate，使用 zlib 分块压缩
+class HttpCompression {
+public:
+    enum class Encoding {
+        IDENTITY,
+        GZIP,
+        DEFLATE         // HTTP 中的 deflate 指 zlib 格式（RFC 1950）
+    };
+
+    // 从 Accept-Encoding 中选出客户端接受的编码（q 值最高者，相同时优先 gzip）
+    // 没有头部、q=0 或只接受未知编码时返回 IDENTITY
+    static Encoding negotiate(const std::string& accept_encoding);
+
+    // Content-Encoding 头部的值
+    static const char* name(Encoding encoding);
+
+    // 按 level（1-9）压缩 input 写入 output，失败时返回 false
+    static bool compress(const std::string& input, Encoding encoding, int level, std::string& output);
+};
+
+#endif // HTTP_COMPRESSION_H
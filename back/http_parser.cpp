@@ -0,0 +1,305 @@
+#include "http_parser.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+const std::string kEmptyHeader;
+
+std::string toLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+// 去掉首尾的空格和制表符
+std::string trim(const std::string& value) {
+    size_t start = value.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(start, end - start + 1);
+}
+
+// RFC 9110 token 字符（方法名和头部字段名）
+bool isTokenChar(unsigned char c) {
+    return std::isalnum(c) || std::strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+}
+
+bool isToken(const std::string& value) {
+    return !value.empty() && std::all_of(value.begin(), value.end(),
+                                         [](unsigned char c) { return isTokenChar(c); });
+}
+
+} // namespace
+
+// ========== HttpRequest ==========
+
+const std::string& HttpRequest::getHeader(const std::string& lower_name) const {
+    for (const auto& header : headers) {
+        if (header.first == lower_name) {
+            return header.second;
+        }
+    }
+    return kEmptyHeader;
+}
+
+bool HttpRequest::wantsKeepAlive() const {
+    std::string connection = toLower(getHeader("connection"));
+    if (version == "HTTP/1.1") {
+        return connection != "close";
+    }
+    return connection == "keep-alive";
+}
+
+// ========== HttpRequestParser ==========
+
+HttpRequestParser::HttpRequestParser(size_t max_header_bytes, size_t max_body_bytes)
+    : max_header_bytes_(max_header_bytes), max_body_bytes_(max_body_bytes),
+      offset_(0), cursor_(0), state_(State::REQUEST_LINE), body_remaining_(0), error_status_(0) {}
+
+void HttpRequestParser::feed(const char* data, size_t size) {
+    // 丢弃已取出的请求，只在请求边界移动一次数据
+    if (offset_ > 0) {
+        buffer_.erase(0, offset_);
+        cursor_ -= offset_;
+        offset_ = 0;
+    }
+    buffer_.append(data, size);
+}
+
+HttpRequestParser::Status HttpRequestParser::parse(HttpRequest& request) {
+    std::string line;
+    while (true) {
+        switch (state_) {
+            case State::REQUEST_LINE:
+                if (!nextLine(line)) {
+                    return state_ == State::FAILED ? Status::FAILED : Status::NEED_MORE;
+                }
+                if (line.empty()) {
+                    // 请求之间多余的空行忽略
+                    offset_ = cursor_;
+                    break;
+                }
+                if (!parseRequestLine(line)) {
+                    return Status::FAILED;
+                }
+                state_ = State::HEADERS;
+                break;
+
+            case State::HEADERS:
+                if (!nextLine(line)) {
+                    return state_ == State::FAILED ? Status::FAILED : Status::NEED_MORE;
+                }
+                if (line.empty()) {
+                    if (!beginBody()) {
+                        return Status::FAILED;
+                    }
+                } else if (!parseHeaderLine(line)) {
+                    return Status::FAILED;
+                }
+                break;
+
+            case State::BODY:
+                if (buffer_.size() - cursor_ < body_remaining_) {
+                    return Status::NEED_MORE;
+                }
+                current_.body.assign(buffer_, cursor_, body_remaining_);
+                cursor_ += body_remaining_;
+                finishRequest(request);
+                return Status::COMPLETE;
+
+            case State::CHUNK_SIZE:
+                if (!nextLine(line)) {
+                    return state_ == State::FAILED ? Status::FAILED : Status::NEED_MORE;
+                }
+                if (!parseChunkSize(line)) {
+                    return Status::FAILED;
+                }
+                break;
+
+            case State::CHUNK_DATA: {
+                // 块数据后紧跟 CRLF
+                size_t available = buffer_.size() - cursor_;
+                if (available < body_remaining_ + 1) {
+                    return Status::NEED_MORE;
+                }
+                size_t terminator = 1;
+                if (buffer_[cursor_ + body_remaining_] == '\r') {
+                    if (available < body_remaining_ + 2) {
+                        return Status::NEED_MORE;
+                    }
+                    terminator = 2;
+                }
+                if (buffer_[cursor_ + body_remaining_ + terminator - 1] != '\n') {
+                    fail(400, "Malformed chunk terminator");
+                    return Status::FAILED;
+                }
+                current_.body.append(buffer_, cursor_, body_remaining_);
+                cursor_ += body_remaining_ + terminator;
+                state_ = State::CHUNK_SIZE;
+                break;
+            }
+
+            case State::TRAILERS:
+                // 尾部字段不使用，读到空行为止
+                if (!nextLine(line)) {
+                    return state_ == State::FAILED ? Status::FAILED : Status::NEED_MORE;
+                }
+                if (line.empty()) {
+                    finishRequest(request);
+                    return Status::COMPLETE;
+                }
+                break;
+
+            case State::FAILED:
+                return Status::FAILED;
+        }
+    }
+}
+
+bool HttpRequestParser::nextLine(std::string& line) {
+    const char* start = buffer_.data() + cursor_;
+    const char* newline = static_cast<const char*>(std::memchr(start, '\n', buffer_.size() - cursor_));
+    size_t length = newline ? static_cast<size_t>(newline - start) : buffer_.size() - cursor_;
+
+    // 请求行和头部按整个头部区域计算，块大小行和尾部字段按单行计算
+    bool header_section = state_ == State::REQUEST_LINE || state_ == State::HEADERS;
+    size_t used = header_section ? cursor_ + length - offset_ : length;
+    if (used > max_header_bytes_) {
+        fail(431, "Request header fields too large");
+        return false;
+    }
+    if (!newline) {
+        return false;
+    }
+
+    line.assign(start, length);
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    cursor_ += length + 1;
+    return true;
+}
+
+bool HttpRequestParser::parseRequestLine(const std::string& line) {
+    size_t first_space = line.find(' ');
+    size_t second_space = first_space == std::string::npos ? std::string::npos : line.find(' ', first_space + 1);
+    if (second_space == std::string::npos || line.find(' ', second_space + 1) != std::string::npos) {
+        return fail(400, "Malformed request line");
+    }
+
+    current_.method = line.substr(0, first_space);
+    current_.path = line.substr(first_space + 1, second_space - first_space - 1);
+    current_.version = line.substr(second_space + 1);
+
+    if (!isToken(current_.method) || current_.path.empty()) {
+        return fail(400, "Malformed request line");
+    }
+    if (current_.version != "HTTP/1.1" && current_.version != "HTTP/1.0") {
+        if (current_.version.compare(0, 5, "HTTP/") == 0) {
+            return fail(505, "HTTP version not supported");
+        }
+        return fail(400, "Malformed request line");
+    }
+    return true;
+}
+
+bool HttpRequestParser::parseHeaderLine(const std::string& line) {
+    // 续行（obs-fold）已被废弃，按格式错误处理
+    if (line[0] == ' ' || line[0] == '\t') {
+        return fail(400, "Obsolete header line folding");
+    }
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+        return fail(400, "Malformed header line");
+    }
+    std::string name = line.substr(0, colon);
+    if (!isToken(name)) {
+        return fail(400, "Malformed header name");
+    }
+    current_.headers.emplace_back(toLower(name), trim(line.substr(colon + 1)));
+    return true;
+}
+
+bool HttpRequestParser::beginBody() {
+    std::string transfer_encoding;
+    std::string content_length;
+    bool has_content_length = false;
+    for (const auto& header : current_.headers) {
+        if (header.first == "transfer-encoding") {
+            transfer_encoding += transfer_encoding.empty() ? header.second : "," + header.second;
+        } else if (header.first == "content-length") {
+            // 多个 Content-Length 必须一致，否则无法确定请求边界
+            if (has_content_length && header.second != content_length) {
+                return fail(400, "Conflicting Content-Length headers");
+            }
+            content_length = header.second;
+            has_content_length = true;
+        }
+    }
+
+    if (!transfer_encoding.empty()) {
+        // 同时出现两种长度时拒绝，避免与前置代理对请求边界理解不一致
+        if (has_content_length) {
+            return fail(400, "Both Transfer-Encoding and Content-Length present");
+        }
+        if (toLower(trim(transfer_encoding)) != "chunked") {
+            return fail(501, "Unsupported transfer encoding");
+        }
+        state_ = State::CHUNK_SIZE;
+        return true;
+    }
+
+    body_remaining_ = 0;
+    if (has_content_length) {
+        if (content_length.empty() || content_length.size() > 18 ||
+            !std::all_of(content_length.begin(), content_length.end(), ::isdigit)) {
+            return fail(400, "Invalid Content-Length");
+        }
+        body_remaining_ = std::stoull(content_length);
+        if (body_remaining_ > max_body_bytes_) {
+            return fail(413, "Request body too large");
+        }
+        // 大请求体一次性分配，避免追加过程中反复扩容
+        buffer_.reserve(cursor_ + body_remaining_);
+    }
+    state_ = State::BODY;
+    return true;
+}
+
+bool HttpRequestParser::parseChunkSize(const std::string& line) {
+    // 块扩展（;name=value）忽略
+    std::string size_text = trim(line.substr(0, line.find(';')));
+    if (size_text.empty() || size_text.size() > 15 ||
+        !std::all_of(size_text.begin(), size_text.end(), ::isxdigit)) {
+        return fail(400, "Invalid chunk size");
+    }
+    size_t size = std::stoull(size_text, nullptr, 16);
+    if (size == 0) {
+        state_ = State::TRAILERS;
+        return true;
+    }
+    if (current_.body.size() + size > max_body_bytes_) {
+        return fail(413, "Request body too large");
+    }
+    body_remaining_ = size;
+    state_ = State::CHUNK_DATA;
+    return true;
+}
+
+bool HttpRequestParser::fail(int status, const std::string& reason) {
+    state_ = State::FAILED;
+    error_status_ = status;
+    error_ = reason;
+    return false;
+}
+
+void HttpRequestParser::finishRequest(HttpRequest& request) {
+    request = std::move(current_);
+    current_ = HttpRequest();
+    state_ = State::REQUEST_LINE;
+    offset_ = cursor_;
+}
@@ -0,0 +1,84 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// 解析完成的HTTP请求
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::string version;
+    std::vector<std::pair<std::string, std::string>> headers;   // 字段名已转为小写，按出现顺序
+    std::string body;
+
+    // 按小写字段名查找，没有时返回空串
+    const std::string& getHeader(const std::string& lower_name) const;
+
+    // HTTP/1.1 默认保持连接，HTTP/1.0 需要 Connection: keep-alive
+    bool wantsKeepAlive() const;
+};
+
+// 增量HTTP请求解析器：数据可以按任意大小分块到达，缓冲区按需增长
+// 解析状态在两次 feed 之间保留，已扫描过的内容不会重复扫描
+// 支持 Content-Length 和 chunked 请求体，头部和请求体大小有独立的上限
+class HttpRequestParser {
+public:
+    enum class Status {
+        NEED_MORE,      // 请求不完整，等待更多数据
+        COMPLETE,       // 取出了一个完整请求
+        FAILED          // 请求格式错误或超出限制，连接应在返回错误后关闭
+    };
+
+    HttpRequestParser(size_t max_header_bytes, size_t max_body_bytes);
+
+    // 追加收到的数据
+    void feed(const char* data, size_t size);
+
+    // 从缓冲区取出下一个完整请求（流水线请求依次取出）
+    Status parse(HttpRequest& request);
+
+    // 缓冲区中尚未取出的字节数
+    size_t getBufferedBytes() const { return buffer_.size() - offset_; }
+
+    // 失败时建议返回的状态码（400/413/431/501/505）和原因
+    int getErrorStatus() const { return error_status_; }
+    const std::string& getError() const { return error_; }
+
+private:
+    enum class State {
+        REQUEST_LINE,
+        HEADERS,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        TRAILERS,
+        FAILED
+    };
+
+    size_t max_header_bytes_;
+    size_t max_body_bytes_;
+
+    std::string buffer_;
+    size_t offset_;             // 当前请求在缓冲区中的起始位置
+    size_t cursor_;             // 已解析到的位置
+    State state_;
+    HttpRequest current_;
+    size_t body_remaining_;     // BODY：剩余字节数；CHUNK_DATA：当前块剩余字节数
+
+    int error_status_;
+    std::string error_;
+
+    // 取出下一行（不含行尾），行不完整时返回 false；头部超过上限时转为失败状态
+    bool nextLine(std::string& line);
+    bool parseRequestLine(const std::string& line);
+    bool parseHeaderLine(const std::string& line);
+    bool beginBody();           // 头部结束后根据 Transfer-Encoding / Content-Length 确定请求体格式
+    bool parseChunkSize(const std::string& line);
+    bool fail(int status, const std::string& reason);
+    void finishRequest(HttpRequest& request);
+};
+
+#endif // HTTP_PARSER_H
@@ -0,0 +1,116 @@
+#include "http_router.h"
+#include <stdexcept>
+
+namespace {
+
+const std::string kEmptyParam;
+
+} // namespace
+
+const std::string& RouteMatch::getParam(const std::string& name) const {
+    for (const auto& param : params) {
+        if (param.first == name) {
+            return param.second;
+        }
+    }
+    return kEmptyParam;
+}
+
+HttpRouter::HttpRouter() : root_(new Node()) {}
+
+HttpRouter::~HttpRouter() = default;
+
+void HttpRouter::addRoute(const std::string& method, const std::string& pattern, Handler handler) {
+    Node* node = root_.get();
+    for (const std::string& segment : splitPath(pattern)) {
+        if (segment[0] == ':') {
+            if (!node->param_child) {
+                node->param_child.reset(new Node());
+                node->param_child->param_name = segment.substr(1);
+            } else if (node->param_child->param_name != segment.substr(1)) {
+                throw std::invalid_argument("Conflicting parameter names in route " + pattern);
+            }
+            node = node->param_child.get();
+        } else {
+            auto& child = node->children[segment];
+            if (!child) {
+                child.reset(new Node());
+            }
+            node = child.get();
+        }
+    }
+
+    for (const auto& existing : node->handlers) {
+        if (existing.first == method) {
+            throw std::invalid_argument("Duplicate route " + method + " " + pattern);
+        }
+    }
+    node->handlers.emplace_back(method, std::move(handler));
+}
+
+HttpRouter::MatchResult HttpRouter::match(const std::string& method, const std::string& path, RouteMatch& result,
+                                          const Handler*& handler, std::string& allowed) const {
+    size_t query_pos = path.find('?');
+    result.query = query_pos == std::string::npos ? "" : path.substr(query_pos + 1);
+    result.params.clear();
+
+    const Node* node = find(root_.get(), splitPath(path.substr(0, query_pos)), 0, result.params);
+    if (!node || node->handlers.empty()) {
+        return MatchResult::NOT_FOUND;
+    }
+
+    for (const auto& entry : node->handlers) {
+        if (entry.first == method) {
+            handler = &entry.second;
+            return MatchResult::FOUND;
+        }
+    }
+
+    allowed.clear();
+    for (const auto& entry : node->handlers) {
+        allowed += allowed.empty() ? entry.first : ", " + entry.first;
+    }
+    return MatchResult::METHOD_NOT_ALLOWED;
+}
+
+std::vector<std::string> HttpRouter::splitPath(const std::string& path) {
+    std::vector<std::string> segments;
+    size_t pos = 0;
+    while (pos < path.size()) {
+        size_t end = path.find('/', pos);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        if (end > pos) {
+            segments.emplace_back(path, pos, end - pos);
+        }
+        pos = end + 1;
+    }
+    return segments;
+}
+
+const HttpRouter::Node* HttpRouter::find(const Node* node, const std::vector<std::string>& segments, size_t index,
+                                         std::vector<std::pair<std::string, std::string>>& params) {
+    if (index == segments.size()) {
+        return node;
+    }
+
+    // 固定分段优先，匹配失败时再尝试参数分段
+    auto it = node->children.find(segments[index]);
+    if (it != node->children.end()) {
+        const Node* found = find(it->second.get(), segments, index + 1, params);
+        if (found && !found->handlers.empty()) {
+            return found;
+        }
+    }
+
+    if (node->param_child) {
+        params.emplace_back(node->param_child->param_name, segments[index]);
+        const Node* found = find(node->param_child.get(), segments, index + 1, params);
+        if (found && !found->handlers.empty()) {
+            return found;
+        }
+        params.pop_back();
+    }
+    return nullptr;
+}
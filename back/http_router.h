@@ -0,0 +1,72 @@
+#ifndef HTTP_ROUTER_H
+#define HTTP_ROUTER_H
+
+#include "http_parser.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+class EventSubscription;
+
+// 处理器返回的结构化响应，状态码由处理器明确给出
+struct HttpResponse {
+    int status_code;
+    std::string content_type;
+    std::string body;
+    std::string headers;        // 额外的头部，每行以 \r\n 结尾
+    std::shared_ptr<EventSubscription> stream;  // 非空时为事件流：发送响应后连接保持打开，继续推送订阅的事件
+
+    HttpResponse(int status = 200, std::string content = "", std::string type = "application/json")
+        : status_code(status), content_type(std::move(type)), body(std::move(content)) {}
+};
+
+// 路由匹配结果：路径参数和查询字符串
+struct RouteMatch {
+    std::vector<std::pair<std::string, std::string>> params;
+    std::string query;
+
+    // 按名称取路径参数，没有时返回空串
+    const std::string& getParam(const std::string& name) const;
+};
+
+// 路由表：按路径分段组织的前缀树，启动时注册一次，之后只读（多个工作线程并发匹配无需加锁）
+// 模式中以 ':' 开头的分段为参数，例如 /api/managers/:manager_id/transactions
+// 同一位置上固定分段优先于参数分段
+class HttpRouter {
+public:
+    typedef std::function<HttpResponse(const RouteMatch& match, const HttpRequest& request)> Handler;
+
+    enum class MatchResult {
+        FOUND,
+        NOT_FOUND,              // 没有匹配的路径
+        METHOD_NOT_ALLOWED      // 路径存在但不支持该方法
+    };
+
+    HttpRouter();
+    ~HttpRouter();
+
+    void addRoute(const std::string& method, const std::string& pattern, Handler handler);
+
+    // 匹配请求路径（可带查询字符串）；FOUND 时设置 handler，METHOD_NOT_ALLOWED 时 allowed 为支持的方法列表
+    MatchResult match(const std::string& method, const std::string& path, RouteMatch& result,
+                      const Handler*& handler, std::string& allowed) const;
+
+private:
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> param_child;
+        std::string param_name;
+        std::vector<std::pair<std::string, Handler>> handlers;     // 方法 -> 处理器
+    };
+
+    std::unique_ptr<Node> root_;
+
+    static std::vector<std::string> splitPath(const std::string& path);
+    static const Node* find(const Node* node, const std::vector<std::string>& segments, size_t index,
+                            std::vector<std::pair<std::string, std::string>>& params);
+};
+
+#endif // HTTP_ROUTER_H
@@ -1,26 +1,325 @@
 #include "http_server.h"
+#include "http_parser.h"
+#include "json_sax_parser.h"
+#include "json_writer.h"
+#include "http_compression.h"
 #include "logger.h"
 #include "error_handling.h"
 #include "monitoring.h"
 #include <iostream>
-#include <sstream>
 #include <thread>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
 #include <netinet/in.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <cstring>
+#include <cctype>
 #include <algorithm>
-#include <regex>
+#include <charconv>
 #include <iomanip>
+#include <unordered_map>
+#include <mutex>
+
+namespace {
+
+const int kMaxEvents = 256;
+
+// 事件循环检查空闲连接的间隔
+const int kIdleCheckIntervalMs = 1000;
+
+// 过载时建议客户端重试的间隔（秒）
+const int kRetryAfterSeconds = 1;
+
+// 交易记录分页的单页上限
+const size_t kMaxPageSize = 10000;
+
+// 按时间过滤时每次读取的记录数，命中 limit 条后即停止读取
+const size_t kSinceScanChunk = 1024;
+
+// 事件流：每个订阅最多积压的事件数、连接最多积压的未发送字节数，超过时断开由客户端续传
+const size_t kMaxStreamPendingEvents = 10000;
+const size_t kMaxStreamBacklogBytes = 8 * 1024 * 1024;
+
+// 事件流没有新事件时发送注释行的间隔，让代理保持连接并及时发现断开的客户端
+const int kStreamHeartbeatSeconds = 15;
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+// 把顶层对象的字段直接填入 TransactionRecord，未知字段和嵌套内容忽略
+// 数值字段也接受字符串形式（"quantity":"5"），字符串字段也接受数字
+class TransactionJsonHandler : public JsonSaxParser::Handler {
+public:
+    explicit TransactionJsonHandler(TransactionRecord& trans)
+        : trans_(trans), depth_(0), string_field_(nullptr), numeric_field_(NumericField::NONE) {}
+    
+    const std::string& getError() const { return error_; }
+    
+    bool onObjectStart() override { ++depth_; clearField(); return true; }
+    bool onObjectEnd() override { --depth_; return true; }
+    bool onArrayStart() override {
+        if (depth_ == 0) {
+            return reject("Expected a JSON object");
+        }
+        ++depth_;
+        clearField();
+        return true;
+    }
+    bool onArrayEnd() override { --depth_; return true; }
+    
+    bool onKey(std::string_view key) override {
+        // key 指向解析器的临时缓冲区，只在这里解析出目标字段
+        clearField();
+        if (depth_ != 1) {
+            return true;
+        }
+        if (key == "quantity") {
+            numeric_field_ = NumericField::QUANTITY;
+        } else if (key == "unit_price") {
+            numeric_field_ = NumericField::UNIT_PRICE;
+        } else {
+            string_field_ = findStringField(key);
+        }
+        return true;
+    }
+    
+    bool onString(std::string_view value) override { return onScalar(value); }
+    bool onNumber(std::string_view text) override { return onScalar(text); }
+    bool onBool(bool) override {
+        if (depth_ == 0) {
+            return reject("Expected a JSON object");
+        }
+        if (string_field_ || numeric_field_ != NumericField::NONE) {
+            return reject("Unexpected boolean value");
+        }
+        return true;
+    }
+    bool onNull() override {
+        // null 保留默认值
+        if (depth_ == 0) {
+            return reject("Expected a JSON object");
+        }
+        clearField();
+        return true;
+    }
+    
+private:
+    enum class NumericField { NONE, QUANTITY, UNIT_PRICE };
+    
+    TransactionRecord& trans_;
+    int depth_;
+    std::string* string_field_;
+    NumericField numeric_field_;
+    std::string error_;
+    
+    std::string* findStringField(std::string_view key) {
+        if (key == "trans_id") return &trans_.trans_id;
+        if (key == "item_id") return &trans_.item_id;
+        if (key == "item_name") return &trans_.item_name;
+        if (key == "type") return &trans_.type;
+        if (key == "category") return &trans_.category;
+        if (key == "model") return &trans_.model;
+        if (key == "unit") return &trans_.unit;
+        if (key == "partner_id") return &trans_.partner_id;
+        if (key == "partner_name") return &trans_.partner_name;
+        if (key == "warehouse_id") return &trans_.warehouse_id;
+        if (key == "document_no") return &trans_.document_no;
+        if (key == "timestamp") return &trans_.timestamp;
+        if (key == "note") return &trans_.note;
+        return nullptr;
+    }
+    
+    void clearField() {
+        string_field_ = nullptr;
+        numeric_field_ = NumericField::NONE;
+    }
+    
+    bool onScalar(std::string_view value) {
+        if (depth_ == 0) {
+            return reject("Expected a JSON object");
+        }
+        if (string_field_) {
+            string_field_->assign(value.data(), value.size());
+        } else if (numeric_field_ == NumericField::QUANTITY) {
+            if (!parseWhole(value, trans_.quantity)) {
+                return reject("Invalid quantity");
+            }
+        } else if (numeric_field_ == NumericField::UNIT_PRICE) {
+            if (!parseWhole(value, trans_.unit_price)) {
+                return reject("Invalid unit_price");
+            }
+        }
+        clearField();
+        return true;
+    }
+    
+    template <typename T>
+    static bool parseWhole(std::string_view text, T& out) {
+        T value;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+    
+    bool reject(const std::string& reason) {
+        error_ = reason;
+        return false;
+    }
+};
+
+// 解析非负整数查询参数，格式错误时返回 false
+bool parseCount(const std::string& text, size_t& value) {
+    if (text.empty()) {
+        return false;
+    }
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// If-None-Match 是否包含 etag（弱比较：忽略 W/ 前缀）
+bool etagMatches(const std::string& if_none_match, const std::string& etag) {
+    if (if_none_match.empty()) {
+        return false;
+    }
+    auto opaque = [](std::string tag) {
+        size_t start = tag.find_first_not_of(" \t");
+        size_t end = tag.find_last_not_of(" \t");
+        tag = start == std::string::npos ? "" : tag.substr(start, end - start + 1);
+        return tag.compare(0, 2, "W/") == 0 ? tag.substr(2) : tag;
+    };
+    std::string target = opaque(etag);
+    size_t pos = 0;
+    while (pos <= if_none_match.size()) {
+        size_t comma = if_none_match.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = if_none_match.size();
+        }
+        std::string candidate = opaque(if_none_match.substr(pos, comma - pos));
+        if (candidate == "*" || candidate == target) {
+            return true;
+        }
+        pos = comma + 1;
+    }
+    return false;
+}
+
+// 工作线程复用的响应写入器，大响应序列化时不再反复扩容
+JsonWriter& threadJsonWriter() {
+    thread_local JsonWriter writer;
+    writer.clear();
+    return writer;
+}
+
+}  // namespace
+
+// 每个连接的状态：输入由增量解析器缓冲（可能有多个流水线请求），输出在 socket 可写时继续发送
+// 同一时刻最多一个请求在工作线程中处理，保证响应顺序与请求顺序一致
+struct HttpServer::Connection {
+    int fd;
+    uint64_t id;            // 循环内唯一，描述符被复用时用来丢弃发给旧连接的响应
+    HttpRequestParser parser;
+    std::string output;
+    size_t output_offset;
+    size_t requests;        // 已派发的请求数
+    bool in_flight;         // 请求正在工作线程中处理
+    bool close_after_output;    // 当前响应发送完后关闭，不再读取后续请求
+    bool peer_closed;       // 对端已关闭写方向
+    std::chrono::steady_clock::time_point last_activity;
+    std::shared_ptr<EventSubscription> stream;  // 事件流连接的订阅，之后不再处理请求
+    
+    Connection(int socket, uint64_t connection_id, size_t max_header_bytes, size_t max_body_bytes)
+        : fd(socket), id(connection_id), parser(max_header_bytes, max_body_bytes), output_offset(0), requests(0), in_flight(false),
+          close_after_output(false), peer_closed(false), last_activity(std::chrono::steady_clock::now()) {}
+    
+    // 没有正在处理的请求，响应也已全部发送
+    bool idle() const { return !in_flight && output_offset == output.size(); }
+};
 
 HttpServer::HttpServer(int port, std::shared_ptr<MemoryDatabase> db)
-    : port_(port), running_(false), db_(db) {
+    : port_(port), running_(false), read_only_(false), db_(db),
+      server_fd_(-1), spare_fd_(-1), loop_threads_(0), active_connections_(0),
+      worker_threads_(0), max_queued_requests_(1024), queue_deadline_ms_(2000),
+      keep_alive_timeout_(5), max_requests_per_connection_(1000),
+      max_header_bytes_(16 * 1024), max_body_bytes_(16 * 1024 * 1024),
+      compression_level_(6), compression_threshold_(1024),
+      json_cache_(128 * 1024 * 1024, [this](JsonWriter& json, const TransactionRecord& trans) { transactionToJson(json, trans); }),
+      response_cache_(64 * 1024 * 1024),
+      streams_(std::make_shared<EventStreamHub>(
+          [this](JsonWriter& json, const TransactionRecord& trans) { transactionToJson(json, trans); },
+          kMaxStreamPendingEvents)) {
+    // 监听持有 streams_ 的共享指针，服务器停止后清空订阅，不再访问事件循环
+    std::shared_ptr<EventStreamHub> streams = streams_;
+    db_->addAppendListener([streams](const std::string& manager_id, const TransactionRecord& trans, size_t position) {
+        streams->publish(manager_id, trans, position);
+    });
+    registerRoutes();
     LOG_INFO("HttpServer", "constructor", "HTTP Server initialized on port " + std::to_string(port));
 }
 
+// 每个事件循环线程独占一个 epoll 实例和它接受的连接
+struct HttpServer::EventLoop {
+    int epoll_fd;
+    int wake_fd;        // eventfd，stop() 或工作线程写入以唤醒 epoll_wait
+    std::thread thread;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    uint64_t next_connection_id;
+    
+    // 工作线程完成的响应，由事件循环线程取走发送
+    struct Completion {
+        int fd;
+        uint64_t connection_id;
+        std::string response;
+        std::shared_ptr<EventSubscription> stream;
+    };
+    std::mutex completion_mutex;
+    std::vector<Completion> completions;
+    // 有新事件待发送的事件流连接 (fd, 连接ID)
+    std::vector<std::pair<int, uint64_t>> stream_wakeups;
+    
+    EventLoop() : epoll_fd(-1), wake_fd(-1), next_connection_id(0) {}
+    ~EventLoop();   // 关闭剩余连接和描述符（线程已退出）
+};
+
+HttpServer::EventLoop::~EventLoop() {
+    for (auto& pair : connections) {
+        close(pair.first);
+    }
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+    if (wake_fd != -1) {
+        close(wake_fd);
+    }
+}
+
 HttpServer::~HttpServer() {
-    if (running_) {
-        stop();
+    stop();
+    
+    // 先让工作线程处理完已排队的请求（响应会交给仍然存在的事件循环），再回收事件循环
+    if (workers_) {
+        workers_->shutdown();
+    }
+    
+    // 等待事件循环退出后再释放连接和描述符
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+    loops_.clear();
+    if (server_fd_ != -1) {
+        close(server_fd_);
+    }
+    if (spare_fd_ != -1) {
+        close(spare_fd_);
     }
 }
 
@@ -29,117 +328,108 @@ bool HttpServer::start() {
         LOG_WARNING("HttpServer", "start", "Server is already running");
         return false;
     }
+    if (!loops_.empty()) {
+        LOG_WARNING("HttpServer", "start", "Server cannot be restarted after stop");
+        return false;
+    }
     
     LOG_INFO("HttpServer", "start", "Starting HTTP server on port " + std::to_string(port_));
     
-    int server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd == -1) {
+    // 大量并发连接需要足够的文件描述符，把软限制提高到硬限制
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    
+    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd_ == -1) {
         LOG_ERROR("HttpServer", "start", "Failed to create socket: " + std::string(strerror(errno)));
         return false;
     }
     
     // 设置socket选项，允许地址重用
     int opt = 1;
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    if (setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
         LOG_WARNING("HttpServer", "start", "Failed to set SO_REUSEADDR: " + std::string(strerror(errno)));
     }
     
     struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = INADDR_ANY;
     address.sin_port = htons(port_);
     
-    if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+    if (bind(server_fd_, (struct sockaddr*)&address, sizeof(address)) < 0) {
         LOG_ERROR("HttpServer", "start", "Failed to bind socket: " + std::string(strerror(errno)));
-        close(server_fd);
+        close(server_fd_);
+        server_fd_ = -1;
         return false;
     }
     
-    if (listen(server_fd, 10) < 0) {
+    if (listen(server_fd_, SOMAXCONN) < 0 || !setNonBlocking(server_fd_)) {
         LOG_ERROR("HttpServer", "start", "Failed to listen on socket: " + std::string(strerror(errno)));
-        close(server_fd);
+        close(server_fd_);
+        server_fd_ = -1;
         return false;
     }
     
-    running_ = true;
-    LOG_INFO("HttpServer", "start", "HTTP server started successfully");
+    spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
     
-    // 服务器主循环
-    std::thread server_thread([this, server_fd]() {
-        while (running_) {
-            struct sockaddr_in client_address;
-            socklen_t client_len = sizeof(client_address);
-            
-            int client_socket = accept(server_fd, (struct sockaddr*)&client_address, &client_len);
-            if (client_socket < 0) {
-                if (running_) {
-                    LOG_ERROR("HttpServer", "accept", "Failed to accept connection: " + std::string(strerror(errno)));
-                }
-                continue;
-            }
-            
-            // 处理客户端请求（在新线程中）
-            std::thread client_thread([this, client_socket]() {
-                TIMER("http_request_duration");
-                
-                char buffer[4096] = {0};
-                ssize_t bytes_read = read(client_socket, buffer, 4095);
-                
-                if (bytes_read > 0) {
-                    std::string request(buffer, bytes_read);
-                    
-                    // 解析HTTP请求
-                    std::istringstream request_stream(request);
-                    std::string method, path, version;
-                    request_stream >> method >> path >> version;
-                    
-                    LOG_DEBUG("HttpServer", "handleRequest", method + " " + path);
-                    
-                    // 提取请求体
-                    std::string body;
-                    size_t body_start = request.find("\r\n\r\n");
-                    if (body_start != std::string::npos) {
-                        body = request.substr(body_start + 4);
-                    }
-                    
-                    auto start_time = std::chrono::high_resolution_clock::now();
-                    
-                    // 处理请求
-                    std::string response = handleRequest(method, path, body);
-                    
-                    auto end_time = std::chrono::high_resolution_clock::now();
-                    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-                    double duration_ms = duration.count() / 1000.0;
-                    
-                    // 记录HTTP请求指标
-                    int status_code = 200;  // 简化：从response中提取真实状态码
-                    if (response.find("400") != std::string::npos) status_code = 400;
-                    else if (response.find("404") != std::string::npos) status_code = 404;
-                    else if (response.find("500") != std::string::npos) status_code = 500;
-                    
-                    RECORD_HTTP_REQUEST(method, path, status_code, duration_ms);
-                    
-                    // 发送响应
-                    send(client_socket, response.c_str(), response.length(), 0);
-                    
-                    LOG_DEBUG("HttpServer", "response", "Sent response (" + std::to_string(response.length()) + " bytes)");
-                }
-                
-                close(client_socket);
-            });
-            client_thread.detach();
-        }
+    size_t loop_count = loop_threads_ > 0 ? loop_threads_ : std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < loop_count; ++i) {
+        std::unique_ptr<EventLoop> loop(new EventLoop());
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
         
-        close(server_fd);
-    });
-    server_thread.detach();
+        // 监听 socket 加入每个循环，EPOLLEXCLUSIVE 保证一个新连接只唤醒一个循环
+        struct epoll_event listen_event;
+        listen_event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        listen_event.data.fd = server_fd_;
+        struct epoll_event wake_event;
+        wake_event.events = EPOLLIN;
+        wake_event.data.fd = loop->wake_fd;
+        
+        if (loop->epoll_fd == -1 || loop->wake_fd == -1 ||
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, server_fd_, &listen_event) < 0 ||
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &wake_event) < 0) {
+            LOG_ERROR("HttpServer", "start", "Failed to create event loop: " + std::string(strerror(errno)));
+            break;
+        }
+        loops_.push_back(std::move(loop));
+    }
+    
+    if (loops_.size() != loop_count) {
+        loops_.clear();
+        close(server_fd_);
+        server_fd_ = -1;
+        return false;
+    }
     
+    size_t worker_count = worker_threads_ > 0 ? worker_threads_ : 2 * std::max(1u, std::thread::hardware_concurrency());
+    workers_.reset(new WorkerPool(worker_count, max_queued_requests_, std::chrono::milliseconds(queue_deadline_ms_)));
+    
+    running_ = true;
+    for (auto& loop : loops_) {
+        EventLoop* raw = loop.get();
+        loop->thread = std::thread([this, raw]() { runEventLoop(*raw); });
+    }
+    
+    LOG_INFO("HttpServer", "start", "HTTP server started successfully with " + std::to_string(loop_count) + " event loops");
     return true;
 }
 
 void HttpServer::stop() {
     if (running_) {
         running_ = false;
+        streams_->closeAll();
+        
+        // 唤醒所有事件循环，线程在析构时回收
+        uint64_t one = 1;
+        for (auto& loop : loops_) {
+            ssize_t ignored = write(loop->wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
         LOG_INFO("HttpServer", "stop", "HTTP server stopped");
     }
 }
@@ -148,81 +438,594 @@ bool HttpServer::isRunning() const {
     return running_;
 }
 
-std::string HttpServer::handleRequest(const std::string& method, const std::string& path, const std::string& body) {
-    try {
-        // CORS 头部
-        std::string cors_headers = 
-            "Access-Control-Allow-Origin: *\r\n"
-            "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
-            "Access-Control-Allow-Headers: Content-Type, Authorization\r\n";
+// ========== 事件循环 ==========
+
+void HttpServer::runEventLoop(EventLoop& loop) {
+    struct epoll_event events[kMaxEvents];
+    auto last_idle_check = std::chrono::steady_clock::now();
+    
+    while (running_) {
+        int ready = epoll_wait(loop.epoll_fd, events, kMaxEvents, kIdleCheckIntervalMs);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("HttpServer", "eventLoop", "epoll_wait failed: " + std::string(strerror(errno)));
+            break;
+        }
         
-        // 处理 OPTIONS 请求（CORS 预检）
-        if (method == "OPTIONS") {
-            return "HTTP/1.1 200 OK\r\n" + cors_headers + "\r\n";
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == server_fd_) {
+                acceptConnections(loop);
+                continue;
+            }
+            if (fd == loop.wake_fd) {
+                drainCompletions(loop);
+                continue;
+            }
+            
+            auto it = loop.connections.find(fd);
+            if (it == loop.connections.end()) {
+                continue;
+            }
+            Connection& conn = *it->second;
+            
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(loop, fd);
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                onReadable(loop, conn);
+            } else {
+                updateConnection(loop, conn);
+            }
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_idle_check >= std::chrono::milliseconds(kIdleCheckIntervalMs)) {
+            closeIdleConnections(loop);
+            last_idle_check = now;
+        }
+    }
+}
+
+void HttpServer::acceptConnections(EventLoop& loop) {
+    while (running_) {
+        int client_socket = accept4(server_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && spare_fd_ != -1) {
+                // 描述符耗尽：用预留的描述符接受并立即关闭，避免监听 socket 一直可读导致空转
+                LOG_WARNING("HttpServer", "accept", "File descriptors exhausted, rejecting connection");
+                close(spare_fd_);
+                int rejected = accept(server_fd_, nullptr, nullptr);
+                if (rejected >= 0) {
+                    close(rejected);
+                }
+                spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("HttpServer", "accept", "Failed to accept connection: " + std::string(strerror(errno)));
+            }
+            return;
         }
         
-        // API路由解析
-        std::regex api_pattern(R"(/api/managers/([^/]+)/([^/\?]+))");
-        std::regex system_pattern(R"(/api/system/([^/\?]+))");
-        std::smatch matches;
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = client_socket;
+        if (epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, client_socket, &event) < 0) {
+            LOG_ERROR("HttpServer", "accept", "Failed to register connection: " + std::string(strerror(errno)));
+            close(client_socket);
+            continue;
+        }
         
-        if (std::regex_match(path, matches, api_pattern)) {
-            std::string manager_id = urlDecode(matches[1].str());
-            std::string endpoint = matches[2].str();
-            
-            if (method == "GET") {
-                if (endpoint == "transactions") {
-                    return createHttpResponse(handleGetTransactions(manager_id), "application/json", 200, cors_headers);
-                } else if (endpoint == "inventory") {
-                    return createHttpResponse(handleGetInventory(manager_id), "application/json", 200, cors_headers);
-                } else if (endpoint == "items") {
-                    return createHttpResponse(handleGetItems(manager_id), "application/json", 200, cors_headers);
-                } else if (endpoint == "documents") {
-                    return createHttpResponse(handleGetDocuments(manager_id), "application/json", 200, cors_headers);
-                } else if (endpoint == "statistics") {
-                    return createHttpResponse(handleGetStatistics(manager_id), "application/json", 200, cors_headers);
+        loop.connections[client_socket].reset(new Connection(client_socket, ++loop.next_connection_id,
+                                                           max_header_bytes_, max_body_bytes_));
+        SET_GAUGE("http_active_connections", ++active_connections_);
+    }
+}
+
+void HttpServer::onReadable(EventLoop& loop, Connection& conn) {
+    // 边沿触发：一次读到 EAGAIN 为止
+    char buffer[16384];
+    while (true) {
+        ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.last_activity = std::chrono::steady_clock::now();
+            if (!conn.close_after_output && !conn.stream) {
+                conn.parser.feed(buffer, n);
+                // 解析器只限制当前请求；前一个请求处理期间积压的流水线数据在这里限制
+                if (conn.parser.getBufferedBytes() > max_header_bytes_ + max_body_bytes_) {
+                    LOG_WARNING("HttpServer", "read", "Buffered requests exceed size limit, closing connection");
+                    closeConnection(loop, conn.fd);
+                    return;
                 }
-            } else if (method == "POST" && endpoint == "transactions") {
-                return createHttpResponse(handlePostTransaction(manager_id, body), "application/json", 201, cors_headers);
             }
-        } else if (std::regex_match(path, matches, system_pattern)) {
-            std::string endpoint = matches[1].str();
-            
-            if (method == "GET" && endpoint == "status") {
-                auto status = db_->getSystemStatus();
-                std::string json = "{\"status\":\"healthy\",\"managers\":" + std::to_string(status.total_managers) +
-                                 ",\"transactions\":" + std::to_string(status.total_transactions) +
-                                 ",\"memory_kb\":" + std::to_string(status.memory_usage_kb) +
-                                 ",\"timestamp\":\"" + getCurrentTimestamp() + "\"}";
-                return createHttpResponse(json, "application/json", 200, cors_headers);
+            continue;
+        }
+        if (n == 0) {
+            conn.peer_closed = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        closeConnection(loop, conn.fd);
+        return;
+    }
+    
+    updateConnection(loop, conn);
+}
+
+void HttpServer::updateConnection(EventLoop& loop, Connection& conn) {
+    // 上一个请求完成后才派发下一个，流水线请求按顺序处理
+    while (!conn.in_flight && !conn.close_after_output && dispatchRequest(loop, conn)) {
+    }
+    
+    if (!flushOutput(conn)) {
+        closeConnection(loop, conn.fd);
+        return;
+    }
+    
+    // 需要关闭且响应已发送完，或对端已关闭且没有待处理的请求
+    // （只关闭写方向的客户端仍会收到已派发请求的响应）；事件流在对端关闭时结束
+    if ((conn.idle() && (conn.close_after_output || conn.peer_closed)) || (conn.stream && conn.peer_closed)) {
+        closeConnection(loop, conn.fd);
+    }
+}
+
+bool HttpServer::flushOutput(Connection& conn) {
+    while (conn.output_offset < conn.output.size()) {
+        ssize_t n = send(conn.fd, conn.output.data() + conn.output_offset,
+                         conn.output.size() - conn.output_offset, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.output_offset += n;
+            conn.last_activity = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        // EAGAIN：等待下一次 EPOLLOUT
+        return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+    
+    // 已全部发送，释放缓冲区供下一个响应使用
+    conn.output.clear();
+    conn.output_offset = 0;
+    return true;
+}
+
+void HttpServer::closeConnection(EventLoop& loop, int fd) {
+    auto it = loop.connections.find(fd);
+    if (it != loop.connections.end() && it->second->stream) {
+        streams_->unsubscribe(it->second->stream);
+    }
+    // 关闭描述符会自动从 epoll 中移除
+    close(fd);
+    if (loop.connections.erase(fd) > 0) {
+        SET_GAUGE("http_active_connections", --active_connections_);
+    }
+}
+
+void HttpServer::closeIdleConnections(EventLoop& loop) {
+    // 正在处理请求的连接不算空闲；未发完的响应和未收完的请求在超时内没有进展也会被关闭
+    auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(keep_alive_timeout_);
+    // 事件流一直处于处理中，长时间没有发送时补一个注释行，发送失败说明客户端已断开
+    auto heartbeat_deadline = std::chrono::steady_clock::now() - std::chrono::seconds(kStreamHeartbeatSeconds);
+    std::vector<int> expired;
+    for (const auto& pair : loop.connections) {
+        Connection& conn = *pair.second;
+        if (conn.stream) {
+            if (conn.last_activity < heartbeat_deadline) {
+                conn.output += ": keep-alive\n\n";
+                if (!flushOutput(conn)) {
+                    expired.push_back(pair.first);
+                }
             }
+        } else if (!conn.in_flight && conn.last_activity < deadline) {
+            expired.push_back(pair.first);
+        }
+    }
+    for (int fd : expired) {
+        closeConnection(loop, fd);
+    }
+    if (!expired.empty()) {
+        INC_COUNTER_BY("http_idle_connections_closed", expired.size());
+    }
+}
+
+bool HttpServer::dispatchRequest(EventLoop& loop, Connection& conn) {
+    HttpRequest request;
+    HttpRequestParser::Status status = conn.parser.parse(request);
+    if (status == HttpRequestParser::Status::NEED_MORE) {
+        return false;
+    }
+    if (status == HttpRequestParser::Status::FAILED) {
+        // 请求边界已无法确定，返回错误后关闭连接
+        LOG_WARNING("HttpServer", "dispatch", "Rejecting malformed request: " + conn.parser.getError());
+        conn.output += finalizeResponse(createErrorResponse(conn.parser.getError(), conn.parser.getErrorStatus()), false);
+        conn.close_after_output = true;
+        return true;
+    }
+    
+    // 达到单连接请求上限或服务器停止时关闭
+    bool keep_alive = request.wantsKeepAlive();
+    conn.requests++;
+    if (conn.requests >= max_requests_per_connection_ || !running_) {
+        keep_alive = false;
+    }
+    if (!keep_alive) {
+        conn.close_after_output = true;
+    }
+    
+    // 交给工作线程；队列已满时立即拒绝并关闭连接，不占用更多内存和线程
+    EventLoop* owner = &loop;
+    int fd = conn.fd;
+    uint64_t connection_id = conn.id;
+    std::string description = request.method + " " + request.path;
+    bool queued = workers_->submit([this, owner, fd, connection_id, request = std::move(request), keep_alive](bool expired) {
+        // 排队超过期限：客户端很可能已经超时，不再执行业务逻辑
+        if (expired) {
+            completeRequest(*owner, fd, connection_id, finalizeResponse(createOverloadResponse(), false));
+            return;
+        }
+        // 事件流的正文以关闭连接结束，不能复用连接
+        std::shared_ptr<EventSubscription> stream;
+        std::string response = executeRequest(request, stream);
+        response = finalizeResponse(response, keep_alive && !stream);
+        completeRequest(*owner, fd, connection_id, std::move(response), std::move(stream));
+    });
+    if (!queued) {
+        LOG_WARNING("HttpServer", "dispatch", "Request queue full, shedding " + description);
+        conn.output += finalizeResponse(createOverloadResponse(), false);
+        conn.close_after_output = true;
+        return true;
+    }
+    
+    conn.in_flight = true;
+    return true;
+}
+
+std::string HttpServer::finalizeResponse(const std::string& response, bool keep_alive) {
+    size_t status_end = response.find("\r\n");
+    if (status_end == std::string::npos) {
+        return response;
+    }
+    std::string header = keep_alive
+        ? "Connection: keep-alive\r\nKeep-Alive: timeout=" + std::to_string(keep_alive_timeout_) + "\r\n"
+        : "Connection: close\r\n";
+    std::string result;
+    result.reserve(response.size() + header.size());
+    result.append(response, 0, status_end + 2);
+    result += header;
+    result.append(response, status_end + 2, std::string::npos);
+    return result;
+}
+
+void HttpServer::completeRequest(EventLoop& loop, int fd, uint64_t connection_id, std::string response,
+                                 std::shared_ptr<EventSubscription> stream) {
+    {
+        std::lock_guard<std::mutex> lock(loop.completion_mutex);
+        loop.completions.push_back(EventLoop::Completion{fd, connection_id, std::move(response), std::move(stream)});
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(loop.wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void HttpServer::drainCompletions(EventLoop& loop) {
+    uint64_t value;
+    ssize_t ignored = read(loop.wake_fd, &value, sizeof(value));
+    (void)ignored;
+    
+    std::vector<EventLoop::Completion> completions;
+    std::vector<std::pair<int, uint64_t>> stream_wakeups;
+    {
+        std::lock_guard<std::mutex> lock(loop.completion_mutex);
+        completions.swap(loop.completions);
+        stream_wakeups.swap(loop.stream_wakeups);
+    }
+    
+    for (auto& completion : completions) {
+        auto it = loop.connections.find(completion.fd);
+        if (it == loop.connections.end() || it->second->id != completion.connection_id) {
+            // 连接已关闭
+            if (completion.stream) {
+                streams_->unsubscribe(completion.stream);
+            }
+            continue;
         }
         
-        // 404 Not Found
-        return createErrorResponse("Endpoint not found", 404, cors_headers);
+        Connection& conn = *it->second;
+        conn.output += completion.response;
+        conn.last_activity = std::chrono::steady_clock::now();
+        if (completion.stream) {
+            attachStream(loop, conn, std::move(completion.stream));
+        } else {
+            conn.in_flight = false;
+        }
+        updateConnection(loop, conn);
+    }
+    
+    // 同一连接的多次通知在这里合并，积压的事件一次发送
+    for (const auto& wakeup : stream_wakeups) {
+        auto it = loop.connections.find(wakeup.first);
+        if (it != loop.connections.end() && it->second->id == wakeup.second && it->second->stream) {
+            flushStream(loop, *it->second);
+        }
+    }
+}
+
+void HttpServer::attachStream(EventLoop& loop, Connection& conn, std::shared_ptr<EventSubscription> stream) {
+    // 连接不再处理后续请求，保持处理中状态以免被当作空闲连接关闭
+    conn.stream = std::move(stream);
+    conn.close_after_output = false;
+    EventLoop* owner = &loop;
+    int fd = conn.fd;
+    uint64_t connection_id = conn.id;
+    conn.stream->attach([owner, fd, connection_id]() {
+        {
+            std::lock_guard<std::mutex> lock(owner->completion_mutex);
+            owner->stream_wakeups.emplace_back(fd, connection_id);
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(owner->wake_fd, &one, sizeof(one));
+        (void)ignored;
+    });
+}
+
+void HttpServer::flushStream(EventLoop& loop, Connection& conn) {
+    // 订阅积压过多或发送缓冲区积压过多：客户端跟不上，断开后由它用 Last-Event-ID 续传
+    if (!conn.stream->drain(conn.output) || conn.output.size() - conn.output_offset > kMaxStreamBacklogBytes) {
+        LOG_WARNING("HttpServer", "stream", "Event stream client fell too far behind, disconnecting");
+        INC_COUNTER("sse_subscribers_dropped");
+        closeConnection(loop, conn.fd);
+        return;
+    }
+    updateConnection(loop, conn);
+}
+
+std::string HttpServer::executeRequest(const HttpRequest& request, std::shared_ptr<EventSubscription>& stream) {
+    TIMER("http_request_duration");
+    
+    LOG_DEBUG("HttpServer", "handleRequest", request.method + " " + request.path);
+    
+    auto start_time = std::chrono::high_resolution_clock::now();
+    
+    // 处理请求
+    HttpResponse response = handleRequest(request);
+    
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    double duration_ms = duration.count() / 1000.0;
+    
+    // 记录HTTP请求指标
+    RECORD_HTTP_REQUEST(request.method, request.path, response.status_code, duration_ms);
+    
+    // 压缩也在工作线程中完成，不占用事件循环
+    std::string serialized = serializeResponse(response, request.getHeader("accept-encoding"));
+    stream = std::move(response.stream);
+    LOG_DEBUG("HttpServer", "response", "Sending response (" + std::to_string(serialized.length()) + " bytes)");
+    return serialized;
+}
+
+std::string HttpServer::createOverloadResponse() {
+    INC_COUNTER("http_requests_shed");
+    return createErrorResponse("Server overloaded, retry later", 503,
+                               "Retry-After: " + std::to_string(kRetryAfterSeconds) + "\r\n");
+}
+
+// ========== 路由 ==========
+
+void HttpServer::registerRoutes() {
+    auto json = [](std::string content) { return HttpResponse(200, std::move(content)); };
+    
+    // 库管员的只读接口：内容只随该库管员的记录数变化，支持 ETag 条件请求
+    // 需要重新计算的派生接口同时缓存响应；交易列表已有逐条记录的片段缓存
+    auto versioned = [this](HttpRouter::Handler handler, bool cache_response) -> HttpRouter::Handler {
+        return [this, handler, cache_response](const RouteMatch& match, const HttpRequest& request) {
+            return handleVersioned(match, request, handler, cache_response);
+        };
+    };
+    
+    router_.addRoute("GET", "/api/managers/:manager_id/transactions", versioned([this](const RouteMatch& match, const HttpRequest&) {
+        return handleGetTransactions(match.getParam("manager_id"), match.query);
+    }, false));
+    router_.addRoute("POST", "/api/managers/:manager_id/transactions", [this](const RouteMatch& match, const HttpRequest& request) {
+        return handlePostTransaction(match.getParam("manager_id"), request.body);
+    });
+    router_.addRoute("GET", "/api/managers/:manager_id/inventory", versioned([this, json](const RouteMatch& match, const HttpRequest&) {
+        return json(handleGetInventory(match.getParam("manager_id"), getQueryParameter(match.query, "as_of")));
+    }, true));
+    router_.addRoute("GET", "/api/managers/:manager_id/items", versioned([this, json](const RouteMatch& match, const HttpRequest&) {
+        return json(handleGetItems(match.getParam("manager_id")));
+    }, true));
+    router_.addRoute("GET", "/api/managers/:manager_id/documents", versioned([this, json](const RouteMatch& match, const HttpRequest&) {
+        return json(handleGetDocuments(match.getParam("manager_id")));
+    }, true));
+    router_.addRoute("GET", "/api/managers/:manager_id/statistics", versioned([this, json](const RouteMatch& match, const HttpRequest&) {
+        return json(handleGetStatistics(match.getParam("manager_id")));
+    }, true));
+    router_.addRoute("GET", "/api/managers/:manager_id/stream", [this](const RouteMatch& match, const HttpRequest& request) {
+        return handleEventStream(match.getParam("manager_id"), request, match.query);
+    });
+    router_.addRoute("GET", "/api/system/status", [this, json](const RouteMatch&, const HttpRequest&) {
+        auto status = db_->getSystemStatus();
+        return json("{\"status\":\"healthy\",\"managers\":" + std::to_string(status.total_managers) +
+                    ",\"transactions\":" + std::to_string(status.total_transactions) +
+                    ",\"memory_kb\":" + std::to_string(status.memory_usage_kb) +
+                    ",\"timestamp\":\"" + getCurrentTimestamp() + "\"}");
+    });
+}
+
+HttpResponse HttpServer::handleVersioned(const RouteMatch& match, const HttpRequest& request,
+                                         const HttpRouter::Handler& handler, bool cache_response) {
+    // 记录数只增不减，在生成内容之前读取：内容只可能比 ETag 更新，不会把旧内容当作最新
+    // 统计接口带有生成时间，因此使用弱校验
+    size_t version = db_->getTransactionCount(match.getParam("manager_id"));
+    std::string etag = "W/\"" + std::to_string(version) + "\"";
+    std::string cache_headers = "ETag: " + etag + "\r\nCache-Control: no-cache\r\n";
+    
+    if (etagMatches(request.getHeader("if-none-match"), etag)) {
+        INC_COUNTER("http_not_modified");
+        HttpResponse response(304, "", "");
+        response.headers = cache_headers;
+        return response;
+    }
+    
+    // 路径包含库管员、接口和查询参数
+    HttpResponse response = cache_response
+        ? response_cache_.getOrCompute(request.path, version, [&handler, &match, &request]() { return handler(match, request); })
+        : handler(match, request);
+    if (response.status_code == 200) {
+        response.headers += cache_headers;
+    }
+    return response;
+}
+
+HttpResponse HttpServer::handleRequest(const HttpRequest& request) {
+    const std::string& method = request.method;
+    // CORS 头部
+    const std::string cors_headers = 
+        "Access-Control-Allow-Origin: *\r\n"
+        "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
+        "Access-Control-Allow-Headers: Content-Type, Authorization, If-None-Match, Last-Event-ID\r\n"
+        "Access-Control-Expose-Headers: ETag\r\n";
+    
+    HttpResponse response;
+    try {
+        RouteMatch match;
+        const HttpRouter::Handler* handler = nullptr;
+        std::string allowed;
         
+        if (method == "OPTIONS") {
+            // 处理 OPTIONS 请求（CORS 预检）
+            response = HttpResponse(200, "", "text/plain");
+        } else if (read_only_ && method != "GET") {
+            // 复制从库的数据只来自主库
+            response = makeErrorResponse("Read-only replica, send writes to the primary", 403);
+        } else {
+            switch (router_.match(method, request.path, match, handler, allowed)) {
+                case HttpRouter::MatchResult::FOUND:
+                    for (auto& param : match.params) {
+                        param.second = urlDecode(param.second);
+                    }
+                    response = (*handler)(match, request);
+                    break;
+                case HttpRouter::MatchResult::METHOD_NOT_ALLOWED:
+                    response = makeErrorResponse("Method not allowed", 405);
+                    response.headers += "Allow: " + allowed + "\r\n";
+                    break;
+                case HttpRouter::MatchResult::NOT_FOUND:
+                    response = makeErrorResponse("Endpoint not found", 404);
+                    break;
+            }
+        }
     } catch (const std::exception& e) {
         LOG_ERROR("HttpServer", "handleRequest", "Exception: " + std::string(e.what()));
-        return createErrorResponse("Internal server error", 500);
+        response = makeErrorResponse("Internal server error", 500);
     }
+    
+    response.headers += cors_headers;
+    return response;
 }
 
-std::string HttpServer::handleGetTransactions(const std::string& manager_id) {
-    auto transactions = db_->getTransactions(manager_id);
+HttpResponse HttpServer::handleGetTransactions(const std::string& manager_id, const std::string& query) {
+    // 以读取时的记录数为准，之后追加的记录留给下一次请求
+    size_t total = db_->getTransactionCount(manager_id);
+    
+    // 不带参数时返回全部记录
+    size_t limit = total;
+    size_t after = 0;
+    std::string limit_param = getQueryParameter(query, "limit");
+    std::string after_param = getQueryParameter(query, "after");
+    std::string since = getQueryParameter(query, "since");
+    if (!limit_param.empty() && (!parseCount(limit_param, limit) || limit == 0)) {
+        return makeErrorResponse("limit must be a positive integer", 400);
+    }
+    if (!after_param.empty() && !parseCount(after_param, after)) {
+        return makeErrorResponse("after must be a non-negative integer", 400);
+    }
+    if (!limit_param.empty()) {
+        limit = std::min(limit, kMaxPageSize);
+    }
+    
+    auto loader = [this, &manager_id](size_t from, size_t count) {
+        return db_->getTransactionsFrom(manager_id, from, count);
+    };
     
-    std::ostringstream json;
-    json << "{\"manager_id\":\"" << escapeJson(manager_id) << "\",\"transactions\":[";
+    // 记录部分由缓存的片段直接拼接
+    std::string response;
+    response += "{\"manager_id\":\"";
+    JsonWriter::appendEscaped(response, manager_id);
+    response += "\",\"transactions\":[";
     
-    for (size_t i = 0; i < transactions.size(); ++i) {
-        if (i > 0) json << ",";
-        json << transactionToJson(transactions[i]);
+    size_t returned = 0;
+    size_t next_cursor = std::max(after, total);    // 游标超出当前记录数时（如从库落后）保持不变
+    if (after < total && since.empty()) {
+        // 序列位置就是游标，直接取缓存中的区间
+        size_t end = after + std::min(limit, total - after);
+        response.reserve(response.size() + (end - after) * 256 + 64);
+        json_cache_.append(manager_id, after, end, loader, response);
+        returned = end - after;
+        next_cursor = end;
+    } else if (after < total) {
+        // 时间游标：记录按追加顺序存放，时间戳不保证有序，从 after 起分块逐条过滤
+        // 连续命中的记录合并为一个区间从缓存中取出
+        size_t run_start = after;
+        size_t run_end = after;
+        auto flush = [&]() {
+            if (run_end > run_start) {
+                if (returned > run_end - run_start) {
+                    response += ',';
+                }
+                json_cache_.append(manager_id, run_start, run_end, loader, response);
+            }
+        };
+        size_t position = after;
+        while (position < total && returned < limit) {
+            auto records = db_->getTransactionsFrom(manager_id, position, std::min(kSinceScanChunk, total - position));
+            if (records.empty()) {
+                break;
+            }
+            for (const auto& trans : records) {
+                if (returned == limit) {
+                    break;
+                }
+                if (trans.timestamp >= since) {
+                    if (position != run_end) {
+                        flush();
+                        run_start = position;
+                    }
+                    run_end = position + 1;
+                    ++returned;
+                }
+                ++position;
+            }
+        }
+        next_cursor = position;
+        flush();
     }
     
-    json << "],\"count\":" << transactions.size() << "}";
-    return json.str();
+    response += "],\"count\":";
+    response += std::to_string(returned);
+    response += ",\"next_cursor\":";
+    response += std::to_string(next_cursor);
+    response += ",\"has_more\":";
+    response += next_cursor < total ? "true" : "false";
+    response += '}';
+    return HttpResponse(200, std::move(response));
 }
 
-std::string HttpServer::handlePostTransaction(const std::string& manager_id, const std::string& body) {
+HttpResponse HttpServer::handlePostTransaction(const std::string& manager_id, const std::string& body) {
     try {
         TransactionRecord trans = jsonToTransaction(body);
         trans.manager_id = manager_id;
@@ -241,18 +1044,22 @@ std::string HttpServer::handlePostTransaction(const std::string& manager_id, con
         
         if (result.isSuccess()) {
             std::string json = "{\"success\":true,\"transaction_id\":\"" + escapeJson(trans.trans_id) + "\"}";
-            return json;
+            return HttpResponse(201, json);
         } else {
-            return "{\"success\":false,\"error\":\"" + escapeJson(result.getErrorMessage()) + "\"}";
+            int status = result.getErrorCode() == ErrorCode::DUPLICATE_TRANSACTION_ID ? 409 : 400;
+            return HttpResponse(status, "{\"success\":false,\"error\":\"" + escapeJson(result.getErrorMessage()) + "\"}");
         }
         
     } catch (const std::exception& e) {
         LOG_ERROR("HttpServer", "handlePostTransaction", "Exception: " + std::string(e.what()));
-        return "{\"success\":false,\"error\":\"Invalid JSON format\"}";
+        return HttpResponse(400, "{\"success\":false,\"error\":\"Invalid JSON format: " + escapeJson(e.what()) + "\"}");
     }
 }
 
-std::string HttpServer::handleGetInventory(const std::string& manager_id) {
+std::string HttpServer::handleGetInventory(const std::string& manager_id, const std::string& as_of) {
+    if (!as_of.empty()) {
+        return inventoryToJson(db_->calculateInventoryAsOf(manager_id, as_of));
+    }
     auto inventory = db_->calculateInventory(manager_id);
     return inventoryToJson(inventory);
 }
@@ -267,110 +1074,144 @@ std::string HttpServer::handleGetDocuments(const std::string& manager_id) {
     return documentsToJson(documents);
 }
 
+HttpResponse HttpServer::handleEventStream(const std::string& manager_id, const HttpRequest& request,
+                                           const std::string& query) {
+    // 事件 id 即下一条记录的序列位置；没有续传游标时只推送之后的新记录
+    const std::string& last_event_id = request.getHeader("last-event-id");
+    std::string cursor = last_event_id.empty() ? getQueryParameter(query, "after") : last_event_id;
+    size_t total = db_->getTransactionCount(manager_id);
+    size_t from = total;
+    if (!cursor.empty() && !parseCount(cursor, from)) {
+        return makeErrorResponse("Event cursor must be a non-negative integer", 400);
+    }
+    
+    // 积压超过一页时只补发一页且不订阅：这个有限的事件流结束后，EventSource 立即用最后的事件 id 重连，
+    // 逐页追上后才开始实时推送，不会把整个历史一次读入内存和正文
+    bool catching_up = from < total && total - from > kMaxPageSize;
+    
+    // 先订阅再读取积压记录：期间追加的记录两边都会收到，订阅按序列位置丢弃已补发的部分
+    std::shared_ptr<EventSubscription> subscription;
+    std::vector<TransactionRecord> records;
+    if (catching_up) {
+        records = db_->getTransactionsFrom(manager_id, from, kMaxPageSize);
+        INC_COUNTER("sse_catchup_pages");
+    } else {
+        subscription = streams_->subscribe(manager_id, from);
+        records = db_->getTransactionsFrom(manager_id, from);
+    }
+    
+    HttpResponse response(200, "", "text/event-stream");
+    response.headers = "Cache-Control: no-cache\r\nX-Accel-Buffering: no\r\n";
+    response.body.reserve(records.size() * 320 + 16);
+    response.body = catching_up ? "retry: 0\n\n" : "retry: 3000\n\n";
+    JsonWriter& json = threadJsonWriter();
+    for (size_t i = 0; i < records.size(); ++i) {
+        streams_->appendEvent(json, records[i], from + i, response.body);
+    }
+    if (subscription) {
+        subscription->advanceTo(from + records.size());
+        response.stream = std::move(subscription);
+    }
+    return response;
+}
+
 std::string HttpServer::handleGetStatistics(const std::string& manager_id) {
     return statisticsToJson(manager_id);
 }
 
 // ========== JSON 序列化方法 ==========
 
-std::string HttpServer::transactionToJson(const TransactionRecord& trans) {
-    std::ostringstream json;
-    json << "{";
-    json << "\"trans_id\":\"" << escapeJson(trans.trans_id) << "\",";
-    json << "\"item_id\":\"" << escapeJson(trans.item_id) << "\",";
-    json << "\"item_name\":\"" << escapeJson(trans.item_name) << "\",";
-    json << "\"type\":\"" << escapeJson(trans.type) << "\",";
-    json << "\"quantity\":" << trans.quantity << ",";
-    json << "\"unit_price\":" << trans.unit_price << ",";
-    json << "\"category\":\"" << escapeJson(trans.category) << "\",";
-    json << "\"model\":\"" << escapeJson(trans.model) << "\",";
-    json << "\"unit\":\"" << escapeJson(trans.unit) << "\",";
-    json << "\"partner_id\":\"" << escapeJson(trans.partner_id) << "\",";
-    json << "\"partner_name\":\"" << escapeJson(trans.partner_name) << "\",";
-    json << "\"warehouse_id\":\"" << escapeJson(trans.warehouse_id) << "\",";
-    json << "\"document_no\":\"" << escapeJson(trans.document_no) << "\",";
-    json << "\"timestamp\":\"" << escapeJson(trans.timestamp) << "\",";
-    json << "\"note\":\"" << escapeJson(trans.note) << "\",";
-    json << "\"manager_id\":\"" << escapeJson(trans.manager_id) << "\"";
-    json << "}";
-    return json.str();
+void HttpServer::transactionToJson(JsonWriter& json, const TransactionRecord& trans) {
+    json.beginObject();
+    json.field("trans_id", trans.trans_id);
+    json.field("item_id", trans.item_id);
+    json.field("item_name", trans.item_name);
+    json.field("type", trans.type);
+    json.field("quantity", trans.quantity);
+    json.field("unit_price", trans.unit_price);
+    json.field("category", trans.category);
+    json.field("model", trans.model);
+    json.field("unit", trans.unit);
+    json.field("partner_id", trans.partner_id);
+    json.field("partner_name", trans.partner_name);
+    json.field("warehouse_id", trans.warehouse_id);
+    json.field("document_no", trans.document_no);
+    json.field("timestamp", trans.timestamp);
+    json.field("note", trans.note);
+    json.field("manager_id", trans.manager_id);
+    json.endObject();
 }
 
 std::string HttpServer::inventoryToJson(const std::map<std::string, std::vector<InventoryRecord>>& inventory) {
-    std::ostringstream json;
-    json << "{\"warehouses\":[";
+    JsonWriter& json = threadJsonWriter();
+    json.beginObject();
+    json.key("warehouses").beginArray();
     
-    bool first_warehouse = true;
     for (const auto& warehouse_pair : inventory) {
-        if (!first_warehouse) json << ",";
-        first_warehouse = false;
-        
-        json << "{\"warehouse_id\":\"" << escapeJson(warehouse_pair.first) << "\",\"items\":[";
-        
-        bool first_item = true;
+        json.beginObject();
+        json.field("warehouse_id", warehouse_pair.first);
+        json.key("items").beginArray();
         for (const auto& item : warehouse_pair.second) {
-            if (!first_item) json << ",";
-            first_item = false;
-            
-            json << "{";
-            json << "\"item_id\":\"" << escapeJson(item.item_id) << "\",";
-            json << "\"quantity\":" << item.quantity << ",";
-            json << "\"avg_price\":" << item.avg_price;
-            json << "}";
+            json.beginObject();
+            json.field("item_id", item.item_id);
+            json.field("quantity", item.quantity);
+            json.field("avg_price", item.avg_price);
+            json.endObject();
         }
-        
-        json << "]}";
+        json.endArray();
+        json.endObject();
     }
     
-    json << "]}";
+    json.endArray();
+    json.endObject();
     return json.str();
 }
 
 std::string HttpServer::itemsToJson(const std::vector<ItemSummary>& items) {
-    std::ostringstream json;
-    json << "{\"items\":[";
+    JsonWriter& json = threadJsonWriter();
+    json.beginObject();
+    json.key("items").beginArray();
     
-    for (size_t i = 0; i < items.size(); ++i) {
-        if (i > 0) json << ",";
-        const auto& item = items[i];
-        
-        json << "{";
-        json << "\"item_id\":\"" << escapeJson(item.item_id) << "\",";
-        json << "\"item_name\":\"" << escapeJson(item.item_name) << "\",";
-        json << "\"category\":\"" << escapeJson(item.category) << "\",";
-        json << "\"model\":\"" << escapeJson(item.model) << "\",";
-        json << "\"unit\":\"" << escapeJson(item.unit) << "\",";
-        json << "\"total_quantity\":" << item.total_quantity << ",";
-        json << "\"latest_price\":" << item.latest_price << ",";
-        json << "\"last_updated\":\"" << escapeJson(item.last_updated) << "\"";
-        json << "}";
-    }
-    
-    json << "],\"count\":" << items.size() << "}";
+    for (const auto& item : items) {
+        json.beginObject();
+        json.field("item_id", item.item_id);
+        json.field("item_name", item.item_name);
+        json.field("category", item.category);
+        json.field("model", item.model);
+        json.field("unit", item.unit);
+        json.field("total_quantity", item.total_quantity);
+        json.field("latest_price", item.latest_price);
+        json.field("last_updated", item.last_updated);
+        json.endObject();
+    }
+    
+    json.endArray();
+    json.field("count", items.size());
+    json.endObject();
     return json.str();
 }
 
 std::string HttpServer::documentsToJson(const std::vector<DocumentSummary>& documents) {
-    std::ostringstream json;
-    json << "{\"documents\":[";
+    JsonWriter& json = threadJsonWriter();
+    json.beginObject();
+    json.key("documents").beginArray();
     
-    for (size_t i = 0; i < documents.size(); ++i) {
-        if (i > 0) json << ",";
-        const auto& doc = documents[i];
-        
-        json << "{";
-        json << "\"document_no\":\"" << escapeJson(doc.document_no) << "\",";
-        json << "\"type\":\"" << escapeJson(doc.type) << "\",";
-        json << "\"partner_id\":\"" << escapeJson(doc.partner_id) << "\",";
-        json << "\"partner_name\":\"" << escapeJson(doc.partner_name) << "\",";
-        json << "\"manager_id\":\"" << escapeJson(doc.manager_id) << "\",";
-        json << "\"timestamp\":\"" << escapeJson(doc.timestamp) << "\",";
-        json << "\"total_amount\":" << doc.total_amount << ",";
-        json << "\"item_count\":" << doc.item_count;
-        json << "}";
-    }
-    
-    json << "],\"count\":" << documents.size() << "}";
+    for (const auto& doc : documents) {
+        json.beginObject();
+        json.field("document_no", doc.document_no);
+        json.field("type", doc.type);
+        json.field("partner_id", doc.partner_id);
+        json.field("partner_name", doc.partner_name);
+        json.field("manager_id", doc.manager_id);
+        json.field("timestamp", doc.timestamp);
+        json.field("total_amount", doc.total_amount);
+        json.field("item_count", doc.item_count);
+        json.endObject();
+    }
+    
+    json.endArray();
+    json.field("count", documents.size());
+    json.endObject();
     return json.str();
 }
 
@@ -379,24 +1220,18 @@ std::string HttpServer::statisticsToJson(const std::string& manager_id) {
     auto item_types = db_->getItemTypeCount(manager_id);
     auto inventory_by_category = db_->getInventoryByCategory(manager_id);
     
-    std::ostringstream json;
-    json << "{";
-    json << "\"manager_id\":\"" << escapeJson(manager_id) << "\",";
-    json << "\"total_transactions\":" << total_transactions << ",";
-    json << "\"item_types\":" << item_types << ",";
-    json << "\"inventory_by_category\":{";
-    
-    bool first = true;
+    JsonWriter& json = threadJsonWriter();
+    json.beginObject();
+    json.field("manager_id", manager_id);
+    json.field("total_transactions", total_transactions);
+    json.field("item_types", item_types);
+    json.key("inventory_by_category").beginObject();
     for (const auto& pair : inventory_by_category) {
-        if (!first) json << ",";
-        first = false;
-        json << "\"" << escapeJson(pair.first) << "\":" << pair.second;
+        json.field(pair.first, pair.second);
     }
-    
-    json << "},";
-    json << "\"timestamp\":\"" << getCurrentTimestamp() << "\"";
-    json << "}";
-    
+    json.endObject();
+    json.field("timestamp", getCurrentTimestamp());
+    json.endObject();
     return json.str();
 }
 
@@ -404,50 +1239,46 @@ std::string HttpServer::statisticsToJson(const std::string& manager_id) {
 
 TransactionRecord HttpServer::jsonToTransaction(const std::string& json) {
     TransactionRecord trans;
+    TransactionJsonHandler handler(trans);
     
-    // 简化的JSON解析（生产环境应使用专业JSON库）
-    auto getValue = [&json](const std::string& key) -> std::string {
-        std::regex pattern("\"" + key + "\"\\s*:\\s*\"([^\"]*)\"|\"" + key + "\"\\s*:\\s*([^,}\\s]+)");
-        std::smatch match;
-        if (std::regex_search(json, match, pattern)) {
-            return match[1].matched ? match[1].str() : match[2].str();
-        }
-        return "";
-    };
-    
-    trans.trans_id = getValue("trans_id");
-    trans.item_id = getValue("item_id");
-    trans.item_name = getValue("item_name");
-    trans.type = getValue("type");
-    trans.category = getValue("category");
-    trans.model = getValue("model");
-    trans.unit = getValue("unit");
-    trans.partner_id = getValue("partner_id");
-    trans.partner_name = getValue("partner_name");
-    trans.warehouse_id = getValue("warehouse_id");
-    trans.document_no = getValue("document_no");
-    trans.timestamp = getValue("timestamp");
-    trans.note = getValue("note");
-    
-    std::string quantity_str = getValue("quantity");
-    if (!quantity_str.empty()) {
-        trans.quantity = std::stoi(quantity_str);
+    // 每个工作线程复用一个解析器，转义字符串的解码缓冲区不必重复分配
+    thread_local JsonSaxParser parser;
+    if (!parser.parse(json, handler)) {
+        std::string reason = handler.getError().empty()
+            ? parser.getError() + " at offset " + std::to_string(parser.getErrorOffset())
+            : handler.getError();
+        throw std::invalid_argument(reason);
     }
-    
-    std::string price_str = getValue("unit_price");
-    if (!price_str.empty()) {
-        trans.unit_price = std::stod(price_str);
-    }
-    
     return trans;
 }
 
 // ========== 工具方法 ==========
 
+std::string HttpServer::getQueryParameter(const std::string& query, const std::string& name) {
+    size_t pos = 0;
+    while (pos <= query.length()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) {
+            end = query.length();
+        }
+        
+        std::string pair = query.substr(pos, end - pos);
+        size_t eq = pair.find('=');
+        if (urlDecode(pair.substr(0, eq)) == name) {
+            return eq == std::string::npos ? "" : urlDecode(pair.substr(eq + 1));
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
 std::string HttpServer::urlDecode(const std::string& str) {
     std::string result;
     for (size_t i = 0; i < str.length(); ++i) {
-        if (str[i] == '%' && i + 2 < str.length()) {
+        // 不是两位十六进制数的 '%' 原样保留
+        if (str[i] == '%' && i + 2 < str.length() &&
+            std::isxdigit(static_cast<unsigned char>(str[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(str[i + 2]))) {
             std::string hex = str.substr(i + 1, 2);
             char c = static_cast<char>(std::stoi(hex, nullptr, 16));
             result += c;
@@ -464,56 +1295,102 @@ std::string HttpServer::urlDecode(const std::string& str) {
 std::string HttpServer::createHttpResponse(const std::string& content, 
                                           const std::string& content_type,
                                           int status_code,
-                                          const std::string& additional_headers) {
+                                          const std::string& additional_headers,
+                                          const std::string& accept_encoding,
+                                          bool streaming) {
     std::string status_text;
     switch (status_code) {
         case 200: status_text = "OK"; break;
         case 201: status_text = "Created"; break;
+        case 304: status_text = "Not Modified"; break;
         case 400: status_text = "Bad Request"; break;
+        case 403: status_text = "Forbidden"; break;
         case 404: status_text = "Not Found"; break;
+        case 405: status_text = "Method Not Allowed"; break;
+        case 409: status_text = "Conflict"; break;
+        case 413: status_text = "Payload Too Large"; break;
+        case 431: status_text = "Request Header Fields Too Large"; break;
         case 500: status_text = "Internal Server Error"; break;
+        case 501: status_text = "Not Implemented"; break;
+        case 503: status_text = "Service Unavailable"; break;
+        case 505: status_text = "HTTP Version Not Supported"; break;
         default: status_text = "Unknown"; break;
     }
     
-    std::ostringstream response;
-    response << "HTTP/1.1 " << status_code << " " << status_text << "\r\n";
-    response << "Content-Type: " << content_type << "\r\n";
-    response << "Content-Length: " << content.length() << "\r\n";
-    response << "Connection: close\r\n";
-    if (!additional_headers.empty()) {
-        response << additional_headers;
+    // 足够大的正文按客户端接受的编码压缩；压缩后没有变小时按原样发送
+    const std::string* body = &content;
+    std::string compressed;
+    const char* content_encoding = nullptr;
+    // 持续推送的事件流以关闭连接结束，既不压缩也没有 Content-Length；
+    // 追赶中的有限事件流按普通正文发送
+    bool event_stream = streaming;
+    bool compressible = status_code != 304 && !event_stream && compression_level_ > 0 &&
+                        content.size() >= compression_threshold_;
+    if (compressible) {
+        HttpCompression::Encoding encoding = HttpCompression::negotiate(accept_encoding);
+        if (encoding != HttpCompression::Encoding::IDENTITY &&
+            HttpCompression::compress(content, encoding, compression_level_, compressed) &&
+            compressed.size() < content.size()) {
+            body = &compressed;
+            content_encoding = HttpCompression::name(encoding);
+            INC_COUNTER("http_responses_compressed");
+            INC_COUNTER_BY("http_compression_saved_bytes", content.size() - compressed.size());
+        }
     }
-    response << "\r\n";
-    response << content;
     
-    return response.str();
+    // 头部和正文一次分配写入
+    std::string response;
+    response.reserve(body->size() + additional_headers.size() + content_type.size() + 128);
+    response += "HTTP/1.1 ";
+    response += std::to_string(status_code);
+    response += ' ';
+    response += status_text;
+    response += "\r\n";
+    // 304 没有正文，不带正文相关的头部
+    if (status_code != 304) {
+        response += "Content-Type: ";
+        response += content_type;
+        response += "\r\n";
+        if (!event_stream) {
+            response += "Content-Length: ";
+            response += std::to_string(body->size());
+            response += "\r\n";
+        }
+    }
+    if (content_encoding) {
+        response += "Content-Encoding: ";
+        response += content_encoding;
+        response += "\r\n";
+    }
+    // 是否压缩取决于 Accept-Encoding，告知中间缓存按该头部区分
+    if (compressible) {
+        response += "Vary: Accept-Encoding\r\n";
+    }
+    response += additional_headers;
+    response += "\r\n";
+    response += *body;
+    return response;
 }
 
 std::string HttpServer::createErrorResponse(const std::string& error, int status_code, const std::string& additional_headers) {
-    std::string json = "{\"error\":\"" + escapeJson(error) + "\",\"status\":" + std::to_string(status_code) + "}";
-    return createHttpResponse(json, "application/json", status_code, additional_headers);
+    HttpResponse response = makeErrorResponse(error, status_code);
+    response.headers = additional_headers;
+    return serializeResponse(response);
+}
+
+HttpResponse HttpServer::makeErrorResponse(const std::string& error, int status_code) {
+    return HttpResponse(status_code, "{\"error\":\"" + escapeJson(error) + "\",\"status\":" + std::to_string(status_code) + "}");
+}
+
+std::string HttpServer::serializeResponse(const HttpResponse& response, const std::string& accept_encoding) {
+    return createHttpResponse(response.body, response.content_type, response.status_code, response.headers, accept_encoding,
+                              response.stream != nullptr);
 }
 
 std::string HttpServer::escapeJson(const std::string& str) {
     std::string result;
-    for (char c : str) {
-        switch (c) {
-            case '"': result += "\\\""; break;
-            case '\\': result += "\\\\"; break;
-            case '\b': result += "\\b"; break;
-            case '\f': result += "\\f"; break;
-            case '\n': result += "\\n"; break;
-            case '\r': result += "\\r"; break;
-            case '\t': result += "\\t"; break;
-            default:
-                if (c < 0x20) {
-                    result += "\\u00" + std::to_string(c / 16) + std::to_string(c % 16);
-                } else {
-                    result += c;
-                }
-                break;
-        }
-    }
+    result.reserve(str.size());
+    JsonWriter::appendEscaped(result, str);
     return result;
 }
 
@@ -2,10 +2,22 @@
 #define HTTP_SERVER_H
 
 #include "memory_database.h"
+#include "worker_pool.h"
+#include "http_router.h"
+#include "json_writer.h"
+#include "json_fragment_cache.h"
+#include "response_cache.h"
+#include "event_stream.h"
 #include <string>
 #include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
 
 // 简单的HTTP服务器，提供REST API接口
+// 固定数量的事件循环线程（默认每个CPU核心一个），每个循环用边沿触发的 epoll 管理自己的非阻塞连接
+// 事件循环只负责收发，请求交给有界的工作线程池处理；过载时直接返回 503 而不是无限排队
+// 支持 HTTP/1.1 持久连接：同一连接上的多个请求（包括流水线请求）按顺序逐个处理
 class HttpServer {
 public:
     HttpServer(int port, std::shared_ptr<MemoryDatabase> db);
@@ -19,27 +31,134 @@ public:
     
     // 检查是否运行中
     bool isRunning() const;
+    
+    // 只读模式（复制从库）：只处理 GET 请求，写请求返回 403
+    void setReadOnly(bool read_only) { read_only_ = read_only; }
+    
+    // 设置事件循环线程数（0 表示每个CPU核心一个），需在 start() 之前调用
+    void setEventLoopThreads(size_t count) { loop_threads_ = count; }
+    
+    // 工作线程池配置，需在 start() 之前调用
+    // 线程数（0 表示每个CPU核心两个）、排队请求上限、排队超过多少毫秒后放弃处理并返回 503
+    void setWorkerThreads(size_t count) { worker_threads_ = count; }
+    void setMaxQueuedRequests(size_t count) { max_queued_requests_ = count; }
+    void setQueueDeadline(int milliseconds) { queue_deadline_ms_ = milliseconds; }
+    
+    // 持久连接：空闲超过 seconds 秒的连接被关闭；每个连接最多处理 count 个请求后关闭
+    void setKeepAliveTimeout(int seconds) { keep_alive_timeout_ = seconds < 1 ? 1 : seconds; }
+    void setMaxRequestsPerConnection(size_t count) { max_requests_per_connection_ = count < 1 ? 1 : count; }
+    
+    // 请求行加头部、请求体的大小上限，超出时返回 431/413 并关闭连接
+    void setMaxHeaderBytes(size_t bytes) { max_header_bytes_ = bytes; }
+    void setMaxBodyBytes(size_t bytes) { max_body_bytes_ = bytes; }
+    
+    // 交易记录JSON片段缓存的内存上限（字节，0 表示关闭缓存）
+    void setJsonCacheLimit(size_t bytes) { json_cache_.setMaxBytes(bytes); }
+    
+    // 派生接口（库存、物品、单据、统计）响应缓存的内存上限（字节，0 表示关闭缓存）
+    void setResponseCacheLimit(size_t bytes) { response_cache_.setMaxBytes(bytes); }
+    
+    // 响应压缩：正文不小于 min_bytes 且客户端接受 gzip/deflate 时压缩
+    // level 为 zlib 压缩级别 1-9，0 表示关闭压缩
+    void setCompressionLevel(int level) { compression_level_ = level < 0 ? 0 : (level > 9 ? 9 : level); }
+    void setCompressionThreshold(size_t min_bytes) { compression_threshold_ = min_bytes; }
 
 private:
     int port_;
-    bool running_;
+    std::atomic<bool> running_;
+    bool read_only_;
     std::shared_ptr<MemoryDatabase> db_;
     
+    // ========== 事件循环 ==========
+    
+    struct Connection;
+    struct EventLoop;
+    
+    int server_fd_;
+    int spare_fd_;          // 预留的文件描述符，耗尽时用来接受并立即关闭新连接
+    size_t loop_threads_;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::atomic<size_t> active_connections_;
+    
+    // 工作线程池
+    size_t worker_threads_;
+    size_t max_queued_requests_;
+    int queue_deadline_ms_;
+    std::unique_ptr<WorkerPool> workers_;
+    
+    // 持久连接
+    int keep_alive_timeout_;
+    size_t max_requests_per_connection_;
+    
+    // 请求大小限制
+    size_t max_header_bytes_;
+    size_t max_body_bytes_;
+    
+    // 响应压缩
+    int compression_level_;
+    size_t compression_threshold_;
+    
+    // 路由表，构造时注册
+    HttpRouter router_;
+    
+    // 交易记录的JSON片段缓存
+    JsonFragmentCache json_cache_;
+    
+    // 派生接口的响应缓存
+    ResponseCache response_cache_;
+    
+    // 新记录推送（SSE）的订阅，同时被数据库的追加监听持有
+    std::shared_ptr<EventStreamHub> streams_;
+    
+    void runEventLoop(EventLoop& loop);
+    void acceptConnections(EventLoop& loop);
+    void onReadable(EventLoop& loop, Connection& conn);
+    bool flushOutput(Connection& conn);     // 发送缓冲区中的响应，出错时返回 false
+    void closeConnection(EventLoop& loop, int fd);
+    void closeIdleConnections(EventLoop& loop);
+    // 读写或请求完成后推进连接：依次派发缓冲区中的请求、发送响应，空闲且需要关闭时关闭连接
+    void updateConnection(EventLoop& loop, Connection& conn);
+    // 从输入缓冲区取出一个完整请求交给工作线程（或立即拒绝），没有完整请求时返回 false
+    bool dispatchRequest(EventLoop& loop, Connection& conn);
+    // 按是否保持连接补上 Connection 头部
+    std::string finalizeResponse(const std::string& response, bool keep_alive);
+    // 工作线程处理完成后把响应交回连接所属的事件循环；stream 非空时连接随后转为事件流
+    void completeRequest(EventLoop& loop, int fd, uint64_t connection_id, std::string response,
+                         std::shared_ptr<EventSubscription> stream = nullptr);
+    void drainCompletions(EventLoop& loop);
+    // 事件流连接：接管订阅，有新事件时唤醒事件循环发送
+    void attachStream(EventLoop& loop, Connection& conn, std::shared_ptr<EventSubscription> stream);
+    void flushStream(EventLoop& loop, Connection& conn);
+    // 在工作线程中执行请求并记录指标；响应为事件流时通过 stream 返回订阅
+    std::string executeRequest(const HttpRequest& request, std::shared_ptr<EventSubscription>& stream);
+    std::string createOverloadResponse();
+    
+    // 注册所有API路由
+    void registerRoutes();
+    
     // 处理HTTP请求的核心方法
-    std::string handleRequest(const std::string& method, 
-                             const std::string& path, 
-                             const std::string& body);
+    HttpResponse handleRequest(const HttpRequest& request);
+    
+    // 按库管员记录数做条件请求：If-None-Match 与当前版本一致时直接返回 304，否则调用 handler 并附上 ETag
+    // cache_response 为 true 时结果按 (路径, 记录数) 缓存
+    HttpResponse handleVersioned(const RouteMatch& match, const HttpRequest& request,
+                                 const HttpRouter::Handler& handler, bool cache_response);
     
     // API端点处理方法
-    std::string handleGetTransactions(const std::string& manager_id);
-    std::string handlePostTransaction(const std::string& manager_id, const std::string& body);
-    std::string handleGetInventory(const std::string& manager_id);
+    // 分页参数：limit 每页条数，after 上一页返回的 next_cursor（序列位置），since 只返回不早于该时间的记录
+    HttpResponse handleGetTransactions(const std::string& manager_id, const std::string& query);
+    HttpResponse handlePostTransaction(const std::string& manager_id, const std::string& body);
+    // as_of 非空时返回该时间点的库存
+    std::string handleGetInventory(const std::string& manager_id, const std::string& as_of = "");
     std::string handleGetItems(const std::string& manager_id);
     std::string handleGetDocuments(const std::string& manager_id);
     std::string handleGetStatistics(const std::string& manager_id);
+    // 新记录推送：Last-Event-ID（或首次连接的 after 参数）之后的记录先补发，之后实时推送
+    // 积压超过一页时只补发一页后结束，客户端用最后的事件 id 重连续传
+    HttpResponse handleEventStream(const std::string& manager_id, const HttpRequest& request, const std::string& query);
     
     // JSON序列化方法
-    std::string transactionToJson(const TransactionRecord& trans);
+    void transactionToJson(JsonWriter& json, const TransactionRecord& trans);
     std::string inventoryToJson(const std::map<std::string, std::vector<InventoryRecord>>& inventory);
     std::string itemsToJson(const std::vector<ItemSummary>& items);
     std::string documentsToJson(const std::vector<DocumentSummary>& documents);
@@ -50,14 +169,22 @@ private:
     
     // 工具方法
     std::string urlDecode(const std::string& str);
+    // 从查询字符串中取出参数值（已解码），不存在时返回空串
+    std::string getQueryParameter(const std::string& query, const std::string& name);
+    // accept_encoding 为请求的 Accept-Encoding，达到压缩阈值时据此压缩正文
+    // streaming 为持续推送的事件流：正文以关闭连接结束，不压缩也不带 Content-Length
     std::string createHttpResponse(const std::string& content, 
                                   const std::string& content_type = "application/json",
                                   int status_code = 200,
-                                  const std::string& additional_headers = "");
+                                  const std::string& additional_headers = "",
+                                  const std::string& accept_encoding = "",
+                                  bool streaming = false);
     std::string createErrorResponse(const std::string& error, int status_code = 400, 
                                    const std::string& additional_headers = "");
+    HttpResponse makeErrorResponse(const std::string& error, int status_code);
+    std::string serializeResponse(const HttpResponse& response, const std::string& accept_encoding = "");
     
-    // 简化的JSON转义
+    // JSON字符串转义（不含引号）
     std::string escapeJson(const std::string& str);
     std::string getCurrentTimestamp();
 };
@@ -0,0 +1,159 @@
+#include "json_fragment_cache.h"
+#include "monitoring.h"
+#include <algorithm>
+
+namespace {
+
+// 补齐片段时每次读取的记录数
+const size_t kLoadBatchRecords = 4096;
+
+// 还没有缓存任何片段时估算的单条记录片段大小（字节）
+const size_t kEstimatedFragmentBytes = 256;
+
+} // namespace
+
+JsonFragmentCache::JsonFragmentCache(size_t max_bytes, Serializer serializer)
+    : serializer_(std::move(serializer)), max_bytes_(max_bytes), cached_bytes_(0), clock_(0) {}
+
+void JsonFragmentCache::append(const std::string& manager_id, size_t from, size_t to,
+                               const Loader& loader, std::string& out) {
+    if (from >= to) {
+        return;
+    }
+
+    std::shared_ptr<Entry> entry = getEntry(manager_id, to);
+    if (!entry) {
+        // 缓存已关闭或放不下：只序列化请求的区间
+        JsonWriter json;
+        auto records = loader(from, to - from);
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            json.clear();
+            serializer_(json, records[i]);
+            out += json.str();
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(entry->mutex);
+
+    // 补齐缺少的片段（同一库管员的并发请求在这里排队，只序列化一次）
+    size_t cached = entry->offsets.size();
+    if (cached < to) {
+        size_t before = entry->arena.size();
+        JsonWriter json;
+        while (entry->offsets.size() < to) {
+            auto records = loader(entry->offsets.size(), std::min(to - entry->offsets.size(), kLoadBatchRecords));
+            if (records.empty()) {
+                break;
+            }
+            for (const auto& record : records) {
+                if (!entry->offsets.empty()) {
+                    entry->arena += ',';
+                }
+                entry->offsets.push_back(entry->arena.size());
+                json.clear();
+                serializer_(json, record);
+                entry->arena += json.str();
+            }
+        }
+        size_t added = entry->offsets.size() - cached;
+        INC_COUNTER_BY("json_cache_misses", added);
+        account(manager_id, entry, entry->arena.size() - before + added * sizeof(size_t), added);
+    }
+
+    size_t count = entry->offsets.size();
+    to = std::min(to, count);
+    if (from >= to) {
+        return;
+    }
+    size_t begin = entry->offsets[from];
+    size_t end = to < count ? entry->offsets[to] - 1 : entry->arena.size();    // 去掉分隔的逗号
+    out.append(entry->arena, begin, end - begin);
+    INC_COUNTER_BY("json_cache_hits", std::min(to, cached) > from ? std::min(to, cached) - from : 0);
+}
+
+void JsonFragmentCache::setMaxBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_bytes_ = bytes;
+    oversized_.clear();
+    if (bytes == 0) {
+        entries_.clear();
+        cached_bytes_ = 0;
+        SET_GAUGE("json_cache_bytes", 0);
+    }
+}
+
+size_t JsonFragmentCache::getMaxBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_bytes_;
+}
+
+size_t JsonFragmentCache::getCachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+}
+
+std::shared_ptr<JsonFragmentCache::Entry> JsonFragmentCache::getEntry(const std::string& manager_id, size_t to) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (max_bytes_ == 0) {
+        return nullptr;
+    }
+    
+    // 已知放不下的区间不再缓存，否则每次请求都会重新序列化整个前缀后又被丢弃
+    auto oversized = oversized_.find(manager_id);
+    if (oversized != oversized_.end() && to >= oversized->second) {
+        return nullptr;
+    }
+    
+    // 片段从位置 0 起连续存放，按已缓存片段的平均大小估算前 to 条记录的大小
+    auto existing = entries_.find(manager_id);
+    size_t fragment_bytes = kEstimatedFragmentBytes;
+    if (existing != entries_.end() && existing->second->accounted_records > 0) {
+        fragment_bytes = existing->second->accounted_bytes / existing->second->accounted_records;
+    }
+    if (to > max_bytes_ / std::max<size_t>(fragment_bytes, 1)) {
+        return nullptr;
+    }
+    
+    auto& entry = entries_[manager_id];
+    if (!entry) {
+        entry = std::make_shared<Entry>();
+    }
+    entry->last_used = ++clock_;
+    return entry;
+}
+
+void JsonFragmentCache::account(const std::string& manager_id, const std::shared_ptr<Entry>& entry,
+                                size_t added, size_t records) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // 条目在补齐期间已被丢弃时不再记账，其内存随最后一个引用释放
+    auto current = entries_.find(manager_id);
+    if (current == entries_.end() || current->second != entry) {
+        return;
+    }
+    entry->accounted_bytes += added;
+    entry->accounted_records += records;
+    cached_bytes_ += added;
+
+    // 被丢弃的条目若正被其他请求使用，由其持有的引用保证安全
+    while (cached_bytes_ > max_bytes_ && !entries_.empty()) {
+        auto victim = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->second != entry && (victim == entries_.end() || it->second->last_used < victim->second->last_used)) {
+                victim = it;
+            }
+        }
+        if (victim == entries_.end()) {
+            // 只剩当前库管员仍超出上限：不再缓存它
+            victim = current;
+            oversized_[manager_id] = entry->accounted_records;
+        }
+        cached_bytes_ -= victim->second->accounted_bytes;
+        entries_.erase(victim);
+    }
+    SET_GAUGE("json_cache_bytes", cached_bytes_);
+}
@@ -0,0 +1,58 @@
+#ifndef JSON_FRAGMENT_CACHE_H
+#define JSON_FRAGMENT_CACHE_H
+
+#include "transaction.h"
+#include "json_writer.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+// 交易记录的JSON片段缓存：记录追加后不再改变，每条记录只序列化一次
+// 每个库管员的片段按序列位置以逗号连接存放在一块连续内存中，
+// 返回 [from, to) 区间只需一次内存复制；新追加的记录在下次读取时补齐
+// 总大小超过上限时按最近最少使用的顺序丢弃整个库管员的缓存；
+// 单个库管员的记录就放不进缓存时不再缓存它，请求的区间直接序列化
+class JsonFragmentCache {
+public:
+    // 读取序列位置 from 起最多 limit 条记录
+    typedef std::function<std::vector<TransactionRecord>(size_t from, size_t limit)> Loader;
+    typedef std::function<void(JsonWriter& json, const TransactionRecord& trans)> Serializer;
+
+    JsonFragmentCache(size_t max_bytes, Serializer serializer);
+
+    // 把记录 [from, to) 的片段以逗号分隔追加到 out（不含方括号）
+    void append(const std::string& manager_id, size_t from, size_t to, const Loader& loader, std::string& out);
+
+    void setMaxBytes(size_t bytes);
+    size_t getMaxBytes() const;
+    size_t getCachedBytes() const;
+
+private:
+    struct Entry {
+        std::mutex mutex;
+        std::string arena;              // 片段以逗号连接
+        std::vector<size_t> offsets;    // 每条记录片段在 arena 中的起点
+        uint64_t last_used = 0;         // 以下三项由缓存的 mutex_ 保护
+        size_t accounted_bytes = 0;
+        size_t accounted_records = 0;
+    };
+
+    Serializer serializer_;
+    mutable std::mutex mutex_;      // 保护以下成员
+    std::unordered_map<std::string, std::shared_ptr<Entry>> entries_;
+    std::unordered_map<std::string, size_t> oversized_;    // 库管员 -> 单独超出上限时的记录数
+    size_t max_bytes_;
+    size_t cached_bytes_;
+    uint64_t clock_;
+
+    // 前 to 条记录预计放不进缓存时返回空，调用方直接序列化
+    std::shared_ptr<Entry> getEntry(const std::string& manager_id, size_t to);
+    // 记账并在超出上限时丢弃最久未用的库管员，最后才丢弃 entry 自己
+    void account(const std::string& manager_id, const std::shared_ptr<Entry>& entry, size_t added, size_t records);
+};
+
+#endif // JSON_FRAGMENT_CACHE_H
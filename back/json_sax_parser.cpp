@@ -0,0 +1,339 @@
+#include "json_sax_parser.h"
+#include <cstring>
+
+namespace {
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+void appendUtf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+} // namespace
+
+bool JsonSaxParser::parse(std::string_view json, Handler& handler) {
+    input_ = json;
+    pos_ = 0;
+    error_.clear();
+    error_offset_ = 0;
+
+    skipWhitespace();
+    if (!parseValue(handler, 0)) {
+        return false;
+    }
+    skipWhitespace();
+    if (pos_ != input_.size()) {
+        return fail("Unexpected trailing characters");
+    }
+    return true;
+}
+
+bool JsonSaxParser::parseValue(Handler& handler, size_t depth) {
+    if (pos_ >= input_.size()) {
+        return fail("Unexpected end of input");
+    }
+
+    std::string_view text;
+    switch (input_[pos_]) {
+        case '{':
+            return parseObject(handler, depth + 1);
+        case '[':
+            return parseArray(handler, depth + 1);
+        case '"':
+            if (!parseString(text)) return false;
+            return handler.onString(text) || aborted();
+        case 't':
+            if (!parseLiteral("true")) return false;
+            return handler.onBool(true) || aborted();
+        case 'f':
+            if (!parseLiteral("false")) return false;
+            return handler.onBool(false) || aborted();
+        case 'n':
+            if (!parseLiteral("null")) return false;
+            return handler.onNull() || aborted();
+        default:
+            if (!parseNumber(text)) return false;
+            return handler.onNumber(text) || aborted();
+    }
+}
+
+bool JsonSaxParser::parseObject(Handler& handler, size_t depth) {
+    if (depth > max_depth_) {
+        return fail("Nesting too deep");
+    }
+    ++pos_;     // '{'
+    if (!handler.onObjectStart()) {
+        return aborted();
+    }
+
+    skipWhitespace();
+    if (pos_ < input_.size() && input_[pos_] == '}') {
+        ++pos_;
+        return handler.onObjectEnd() || aborted();
+    }
+
+    while (true) {
+        skipWhitespace();
+        if (pos_ >= input_.size() || input_[pos_] != '"') {
+            return fail("Expected object key");
+        }
+        std::string_view key;
+        if (!parseString(key)) {
+            return false;
+        }
+        if (!handler.onKey(key)) {
+            return aborted();
+        }
+
+        skipWhitespace();
+        if (pos_ >= input_.size() || input_[pos_] != ':') {
+            return fail("Expected ':' after object key");
+        }
+        ++pos_;
+        skipWhitespace();
+        if (!parseValue(handler, depth)) {
+            return false;
+        }
+
+        skipWhitespace();
+        if (pos_ >= input_.size()) {
+            return fail("Unterminated object");
+        }
+        if (input_[pos_] == ',') {
+            ++pos_;
+            continue;
+        }
+        if (input_[pos_] == '}') {
+            ++pos_;
+            return handler.onObjectEnd() || aborted();
+        }
+        return fail("Expected ',' or '}' in object");
+    }
+}
+
+bool JsonSaxParser::parseArray(Handler& handler, size_t depth) {
+    if (depth > max_depth_) {
+        return fail("Nesting too deep");
+    }
+    ++pos_;     // '['
+    if (!handler.onArrayStart()) {
+        return aborted();
+    }
+
+    skipWhitespace();
+    if (pos_ < input_.size() && input_[pos_] == ']') {
+        ++pos_;
+        return handler.onArrayEnd() || aborted();
+    }
+
+    while (true) {
+        skipWhitespace();
+        if (!parseValue(handler, depth)) {
+            return false;
+        }
+
+        skipWhitespace();
+        if (pos_ >= input_.size()) {
+            return fail("Unterminated array");
+        }
+        if (input_[pos_] == ',') {
+            ++pos_;
+            continue;
+        }
+        if (input_[pos_] == ']') {
+            ++pos_;
+            return handler.onArrayEnd() || aborted();
+        }
+        return fail("Expected ',' or ']' in array");
+    }
+}
+
+bool JsonSaxParser::parseString(std::string_view& value) {
+    size_t start = ++pos_;      // 跳过开头的引号
+
+    // 快速路径：没有转义时直接引用输入
+    while (pos_ < input_.size()) {
+        char c = input_[pos_];
+        if (c == '"') {
+            value = input_.substr(start, pos_ - start);
+            ++pos_;
+            return true;
+        }
+        if (c == '\\') {
+            break;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            return fail("Control character in string");
+        }
+        ++pos_;
+    }
+    if (pos_ >= input_.size()) {
+        return fail("Unterminated string");
+    }
+
+    // 含转义：从转义处开始解码到复用缓冲区
+    scratch_.assign(input_.data() + start, pos_ - start);
+    while (pos_ < input_.size()) {
+        char c = input_[pos_];
+        if (c == '"') {
+            value = scratch_;
+            ++pos_;
+            return true;
+        }
+        if (c == '\\') {
+            if (!appendEscape()) {
+                return false;
+            }
+            continue;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            return fail("Control character in string");
+        }
+        scratch_ += c;
+        ++pos_;
+    }
+    return fail("Unterminated string");
+}
+
+bool JsonSaxParser::appendEscape() {
+    if (pos_ + 1 >= input_.size()) {
+        return fail("Unterminated escape sequence");
+    }
+    char c = input_[pos_ + 1];
+    pos_ += 2;
+    switch (c) {
+        case '"': scratch_ += '"'; return true;
+        case '\\': scratch_ += '\\'; return true;
+        case '/': scratch_ += '/'; return true;
+        case 'b': scratch_ += '\b'; return true;
+        case 'f': scratch_ += '\f'; return true;
+        case 'n': scratch_ += '\n'; return true;
+        case 'r': scratch_ += '\r'; return true;
+        case 't': scratch_ += '\t'; return true;
+        case 'u': break;
+        default: return fail("Invalid escape sequence");
+    }
+
+    auto readHex4 = [this](uint32_t& out) {
+        if (pos_ + 4 > input_.size()) {
+            return false;
+        }
+        out = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            int digit = hexValue(input_[pos_ + i]);
+            if (digit < 0) {
+                return false;
+            }
+            out = (out << 4) | static_cast<uint32_t>(digit);
+        }
+        pos_ += 4;
+        return true;
+    };
+
+    uint32_t code_point;
+    if (!readHex4(code_point)) {
+        return fail("Invalid \\u escape");
+    }
+    // UTF-16 代理对
+    if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+        uint32_t low;
+        if (pos_ + 2 > input_.size() || input_[pos_] != '\\' || input_[pos_ + 1] != 'u') {
+            return fail("Unpaired surrogate in \\u escape");
+        }
+        pos_ += 2;
+        if (!readHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+            return fail("Invalid surrogate pair in \\u escape");
+        }
+        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+    } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+        return fail("Unpaired surrogate in \\u escape");
+    }
+    appendUtf8(scratch_, code_point);
+    return true;
+}
+
+bool JsonSaxParser::parseNumber(std::string_view& text) {
+    size_t start = pos_;
+    if (pos_ < input_.size() && input_[pos_] == '-') {
+        ++pos_;
+    }
+    if (pos_ >= input_.size() || !isDigit(input_[pos_])) {
+        return fail("Invalid value");
+    }
+    // 整数部分不允许前导零
+    if (input_[pos_] == '0') {
+        ++pos_;
+    } else {
+        while (pos_ < input_.size() && isDigit(input_[pos_])) ++pos_;
+    }
+    if (pos_ < input_.size() && input_[pos_] == '.') {
+        ++pos_;
+        if (pos_ >= input_.size() || !isDigit(input_[pos_])) {
+            return fail("Invalid number");
+        }
+        while (pos_ < input_.size() && isDigit(input_[pos_])) ++pos_;
+    }
+    if (pos_ < input_.size() && (input_[pos_] == 'e' || input_[pos_] == 'E')) {
+        ++pos_;
+        if (pos_ < input_.size() && (input_[pos_] == '+' || input_[pos_] == '-')) ++pos_;
+        if (pos_ >= input_.size() || !isDigit(input_[pos_])) {
+            return fail("Invalid number");
+        }
+        while (pos_ < input_.size() && isDigit(input_[pos_])) ++pos_;
+    }
+    text = input_.substr(start, pos_ - start);
+    return true;
+}
+
+bool JsonSaxParser::parseLiteral(std::string_view literal) {
+    if (input_.substr(pos_, literal.size()) != literal) {
+        return fail("Invalid value");
+    }
+    pos_ += literal.size();
+    return true;
+}
+
+void JsonSaxParser::skipWhitespace() {
+    while (pos_ < input_.size()) {
+        char c = input_[pos_];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            break;
+        }
+        ++pos_;
+    }
+}
+
+bool JsonSaxParser::fail(const std::string& reason) {
+    if (error_.empty()) {
+        error_ = reason;
+        error_offset_ = pos_;
+    }
+    return false;
+}
+
+bool JsonSaxParser::aborted() {
+    return fail("Aborted by handler");
+}
@@ -0,0 +1,58 @@
+#ifndef JSON_SAX_PARSER_H
+#define JSON_SAX_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// 单遍 SAX 风格的JSON解析器：边扫描边回调，不构建文档树
+// 字符串和数字以 string_view 形式交给处理器：不含转义的字符串直接指向输入缓冲区，
+// 含转义的字符串解码到解析器内部复用的缓冲区，回调返回后失效，处理器需要时自行复制
+class JsonSaxParser {
+public:
+    // 回调返回 false 时停止解析
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+        virtual bool onObjectStart() = 0;
+        virtual bool onObjectEnd() = 0;
+        virtual bool onArrayStart() = 0;
+        virtual bool onArrayEnd() = 0;
+        virtual bool onKey(std::string_view key) = 0;
+        virtual bool onString(std::string_view value) = 0;
+        virtual bool onNumber(std::string_view text) = 0;   // 原始文本，已校验格式
+        virtual bool onBool(bool value) = 0;
+        virtual bool onNull() = 0;
+    };
+
+    explicit JsonSaxParser(size_t max_depth = 64) : max_depth_(max_depth) {}
+
+    // 解析完整的JSON文本，格式错误或处理器中止时返回 false
+    bool parse(std::string_view json, Handler& handler);
+
+    // 失败时的原因和输入中的位置
+    const std::string& getError() const { return error_; }
+    size_t getErrorOffset() const { return error_offset_; }
+
+private:
+    size_t max_depth_;
+    std::string_view input_;
+    size_t pos_ = 0;
+    std::string scratch_;       // 转义字符串的解码缓冲区，跨调用复用
+    std::string error_;
+    size_t error_offset_ = 0;
+
+    bool parseValue(Handler& handler, size_t depth);
+    bool parseObject(Handler& handler, size_t depth);
+    bool parseArray(Handler& handler, size_t depth);
+    bool parseString(std::string_view& value);
+    bool parseNumber(std::string_view& text);
+    bool parseLiteral(std::string_view literal);
+    bool appendEscape();
+    void skipWhitespace();
+    bool fail(const std::string& reason);
+    bool aborted();
+};
+
+#endif // JSON_SAX_PARSER_H
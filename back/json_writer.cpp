@@ -0,0 +1,159 @@
+#include "json_writer.h"
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const char kHexDigits[] = "0123456789abcdef";
+
+inline bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+void appendEscapeSequence(std::string& out, unsigned char c) {
+    switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: {
+            char escaped[6] = {'\\', 'u', '0', '0', kHexDigits[c >> 4], kHexDigits[c & 0x0F]};
+            out.append(escaped, sizeof(escaped));
+            break;
+        }
+    }
+}
+
+} // namespace
+
+// ========== 转义 ==========
+
+void JsonWriter::appendEscaped(std::string& out, std::string_view text) {
+    const char* data = text.data();
+    size_t size = text.size();
+    size_t pos = 0;
+    size_t clean_start = 0;     // 尚未写出的无需转义区间起点
+
+#if defined(__SSE2__)
+    // 每次检查16字节：引号、反斜杠和小于 0x20 的控制字符，大多数数据整块跳过
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    while (pos + 16 <= size) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control_max), control_max));
+        int mask = _mm_movemask_epi8(special);
+        if (mask == 0) {
+            pos += 16;
+            continue;
+        }
+        size_t hit = pos + __builtin_ctz(mask);
+        out.append(data + clean_start, hit - clean_start);
+        appendEscapeSequence(out, static_cast<unsigned char>(data[hit]));
+        pos = hit + 1;
+        clean_start = pos;
+    }
+#endif
+
+    for (; pos < size; ++pos) {
+        unsigned char c = static_cast<unsigned char>(data[pos]);
+        if (needsEscape(c)) {
+            out.append(data + clean_start, pos - clean_start);
+            appendEscapeSequence(out, c);
+            clean_start = pos + 1;
+        }
+    }
+    out.append(data + clean_start, size - clean_start);
+}
+
+// ========== 写入 ==========
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    separate();
+    buffer_ += '"';
+    appendEscaped(buffer_, name);
+    buffer_ += "\":";
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    separate();
+    buffer_ += '"';
+    appendEscaped(buffer_, text);
+    buffer_ += '"';
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    // JSON 没有 NaN 和无穷大
+    if (!std::isfinite(number)) {
+        return null();
+    }
+    separate();
+    // 最短的可往返表示
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), number);
+    buffer_.append(digits, result.ptr - digits);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separate();
+    buffer_ += flag ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    buffer_ += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json) {
+    separate();
+    buffer_.append(json.data(), json.size());
+    return *this;
+}
+
+void JsonWriter::clear() {
+    buffer_.clear();
+    needs_comma_.clear();
+    after_key_ = false;
+}
+
+JsonWriter& JsonWriter::open(char bracket) {
+    separate();
+    buffer_ += bracket;
+    needs_comma_.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::close(char bracket) {
+    buffer_ += bracket;
+    if (!needs_comma_.empty()) {
+        needs_comma_.pop_back();
+    }
+    return *this;
+}
+
+void JsonWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (!needs_comma_.empty()) {
+        if (needs_comma_.back()) {
+            buffer_ += ',';
+        }
+        needs_comma_.back() = true;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <type_traits>
+
+// 追加式JSON写入器：直接写入可增长的缓冲区，逗号和冒号自动补齐
+// clear() 保留缓冲区容量，同一个写入器反复使用时不再重新分配
+class JsonWriter {
+public:
+    JsonWriter() : after_key_(false) {}
+
+    JsonWriter& beginObject() { return open('{'); }
+    JsonWriter& endObject() { return close('}'); }
+    JsonWriter& beginArray() { return open('['); }
+    JsonWriter& endArray() { return close(']'); }
+
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(double number);
+    JsonWriter& value(bool flag);
+    JsonWriter& null();
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, JsonWriter&>::type
+    value(T number) {
+        separate();
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        buffer_.append(digits, result.ptr - digits);
+        return *this;
+    }
+
+    // 键值对的简写
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& field_value) { return key(name).value(field_value); }
+
+    // 原样写入已序列化好的JSON值
+    JsonWriter& raw(std::string_view json);
+
+    // 清空内容，保留容量
+    void clear();
+    void reserve(size_t bytes) { buffer_.reserve(bytes); }
+
+    const std::string& str() const { return buffer_; }
+    size_t size() const { return buffer_.size(); }
+
+    // 把转义后的字符串（不含引号）追加到 out
+    static void appendEscaped(std::string& out, std::string_view text);
+
+private:
+    std::string buffer_;
+    std::vector<bool> needs_comma_;     // 每层容器是否已有元素
+    bool after_key_;
+
+    JsonWriter& open(char bracket);
+    JsonWriter& close(char bracket);
+    void separate();                    // 写值之前补逗号
+};
+
+#endif // JSON_WRITER_H
@@ -3,6 +3,7 @@
 #include <iomanip>
 #include <filesystem>
 #include <cstring>
+#include <algorithm>
 
 Logger& Logger::getInstance() {
     static Logger instance;
@@ -1,5 +1,7 @@
 #include "memory_database.h"
 #include "http_server.h"
+#include "replication.h"
+#include "binary_rpc.h"
 #include "logger.h"
 #include "error_handling.h"
 #include "monitoring.h"
@@ -50,14 +52,112 @@ int main(int argc, char* argv[]) {
     monitor.registerGauge("database_transactions_count", "Current total transaction count");
     monitor.registerHistogram("append_transaction_time", "Time spent appending transactions (ms)");
     monitor.registerHistogram("wal_write_time", "Time spent writing to WAL (ms)");
+    monitor.registerGauge("http_active_connections", "Number of open HTTP connections");
+    monitor.registerCounter("http_idle_connections_closed", "Keep-alive connections closed after idle timeout");
+    monitor.registerCounter("http_not_modified", "Conditional GETs answered with 304");
+    monitor.registerCounter("response_cache_hits", "Derived responses served from the response cache");
+    monitor.registerCounter("response_cache_misses", "Derived responses computed and cached");
+    monitor.registerCounter("response_cache_coalesced", "Requests that waited for a concurrent computation of the same response");
+    monitor.registerCounter("response_cache_evictions", "Responses evicted to stay within the cache budget");
+    monitor.registerGauge("response_cache_bytes", "Memory held by cached responses");
+    monitor.registerCounter("http_responses_compressed", "Responses sent with gzip or deflate encoding");
+    monitor.registerCounter("http_compression_saved_bytes", "Bytes saved by response compression");
+    monitor.registerGauge("sse_subscribers", "Open event stream connections");
+    monitor.registerCounter("sse_events_published", "Transaction events queued to event stream subscribers");
+    monitor.registerCounter("sse_subscribers_dropped", "Event stream clients disconnected for falling too far behind");
+    monitor.registerCounter("sse_catchup_pages", "Event stream backlogs sent as a bounded page for the client to resume");
+    monitor.registerCounter("json_cache_hits", "Transaction records served from cached JSON fragments");
+    monitor.registerCounter("json_cache_misses", "Transaction records serialized into the JSON fragment cache");
+    monitor.registerGauge("json_cache_bytes", "Memory held by cached JSON fragments");
+    monitor.registerGauge("worker_pool_queue_depth", "Requests waiting for a worker thread");
+    monitor.registerHistogram("worker_pool_queue_wait_time", "Time requests wait for a worker thread (ms)");
+    monitor.registerCounter("worker_pool_rejected", "Requests rejected because the queue was full");
+    monitor.registerCounter("worker_pool_expired", "Requests dropped after waiting past the queue deadline");
+    monitor.registerCounter("http_requests_shed", "Requests answered with 503 due to overload");
+    monitor.registerGauge("rpc_connections", "Open binary RPC connections");
+    monitor.registerCounter("rpc_requests", "Binary RPC requests executed");
+    monitor.registerCounter("rpc_request_errors", "Binary RPC requests that failed or were malformed");
+    monitor.registerCounter("rpc_accept_errors", "Binary RPC accept failures that triggered a backoff");
+    monitor.registerCounter("rpc_records_appended", "Records appended through binary RPC");
+    monitor.registerHistogram("rpc_request_time", "Time spent executing binary RPC requests (ms)");
+    monitor.registerGauge("replication_followers", "Number of connected replication followers");
+    monitor.registerCounter("replication_followers_dropped", "Followers disconnected for falling too far behind");
+    monitor.registerCounter("replication_accept_errors", "Replication accept failures that triggered a backoff");
+    monitor.registerGauge("replication_connected", "Whether this follower is connected to the primary");
+    monitor.registerGauge("replication_lag_ms", "Milliseconds between primary write and follower apply");
+    monitor.registerGauge("replication_lag_records", "Records the follower is behind the primary");
+    monitor.registerCounter("replication_records_applied", "Replicated records applied by this follower");
     
     LOG_INFO("Main", "startup", "Monitoring system initialized");
     
+    // 命令行：<端口> [--demo] [--data-dir 目录] [--replication-port 端口] [--follow 主机:端口] [--rpc-port 端口] [--compression-level 0-9]
+    //       [--snapshot-interval 秒] [--archive-after-days 天] [--checkpoint-interval 记录数]
+    //       [--memory-budget-mb MB] [--replication-bind 地址]
+    bool demo = false;
+    std::string data_dir = "./data";
+    int replication_port = 0;
+    std::string replication_bind = "127.0.0.1";
+    int rpc_port = 0;
+    std::string follow_host;
+    int follow_port = 0;
+    int compression_level = -1;
+    int snapshot_interval = 60;
+    int archive_after_days = -1;
+    long checkpoint_interval = 0;
+    long memory_budget_mb = 0;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--demo") {
+            demo = true;
+        } else if (arg == "--data-dir" && i + 1 < argc) {
+            data_dir = argv[++i];
+        } else if (arg == "--replication-port" && i + 1 < argc) {
+            replication_port = std::atoi(argv[++i]);
+        } else if (arg == "--replication-bind" && i + 1 < argc) {
+            replication_bind = argv[++i];
+        } else if (arg == "--rpc-port" && i + 1 < argc) {
+            rpc_port = std::atoi(argv[++i]);
+        } else if (arg == "--compression-level" && i + 1 < argc) {
+            compression_level = std::atoi(argv[++i]);
+        } else if (arg == "--snapshot-interval" && i + 1 < argc) {
+            snapshot_interval = std::atoi(argv[++i]);
+        } else if (arg == "--archive-after-days" && i + 1 < argc) {
+            archive_after_days = std::atoi(argv[++i]);
+        } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            checkpoint_interval = std::atol(argv[++i]);
+        } else if (arg == "--memory-budget-mb" && i + 1 < argc) {
+            memory_budget_mb = std::atol(argv[++i]);
+        } else if (arg == "--follow" && i + 1 < argc) {
+            std::string target = argv[++i];
+            size_t colon = target.rfind(':');
+            if (colon != std::string::npos) {
+                follow_host = target.substr(0, colon);
+                follow_port = std::atoi(target.c_str() + colon + 1);
+            }
+            if (follow_host.empty() || follow_port <= 0 || follow_port > 65535) {
+                std::cerr << "错误：--follow 需要 主机:端口" << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "警告：忽略未知参数 " << arg << std::endl;
+        }
+    }
+    
     // 创建内存数据库实例
     std::shared_ptr<MemoryDatabase> database;
     try {
-        database = std::make_shared<MemoryDatabase>();
+        database = std::make_shared<MemoryDatabase>(data_dir);
         LOG_INFO("Main", "startup", "Memory database initialized successfully");
+        
+        // 后台维护：定期快照，配置了归档天数时把冷数据移入归档段
+        database->setArchiveAfterDays(archive_after_days);
+        if (checkpoint_interval > 0) {
+            database->setInventoryCheckpointInterval(static_cast<size_t>(checkpoint_interval));
+        }
+        if (memory_budget_mb > 0) {
+            database->setMemoryBudget(static_cast<size_t>(memory_budget_mb) * 1024);
+        }
+        database->startMaintenance(std::chrono::seconds(snapshot_interval));
     } catch (const std::exception& e) {
         LOG_FATAL("Main", "startup", "Failed to initialize memory database: " + std::string(e.what()));
         logger.stop();
@@ -77,13 +177,46 @@ int main(int argc, char* argv[]) {
     // 创建HTTP服务器
     g_server = std::make_shared<HttpServer>(port, database);
     std::cout << "✓ HTTP服务器创建完成，端口: " << port << std::endl;
+    if (compression_level >= 0) {
+        g_server->setCompressionLevel(compression_level);
+    }
+    
+    // 复制：主库开放复制端口，从库只读并从主库接收记录
+    std::unique_ptr<ReplicationPrimary> replication_primary;
+    std::unique_ptr<ReplicationFollower> replication_follower;
+    if (!follow_host.empty()) {
+        g_server->setReadOnly(true);
+        replication_follower.reset(new ReplicationFollower(follow_host, follow_port, database));
+        replication_follower->start();
+        std::cout << "✓ 只读从库模式，复制源: " << follow_host << ":" << follow_port << std::endl;
+    }
+    if (replication_port > 0) {
+        replication_primary.reset(new ReplicationPrimary(replication_port, database, replication_bind));
+        if (!replication_primary->start()) {
+            std::cerr << "错误：复制端口监听失败" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ 复制端口: " << replication_bind << ":" << replication_port << std::endl;
+    }
+    
+    // 二进制RPC：高频写入方使用的 BinaryProtocol 接口，从库上只读
+    std::unique_ptr<BinaryRpcServer> rpc_server;
+    if (rpc_port > 0) {
+        rpc_server.reset(new BinaryRpcServer(rpc_port, database));
+        rpc_server->setReadOnly(!follow_host.empty());
+        if (!rpc_server->start()) {
+            std::cerr << "错误：RPC端口监听失败" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ 二进制RPC端口: " << rpc_port << std::endl;
+    }
     
     // 设置信号处理器
     signal(SIGINT, signalHandler);
     signal(SIGTERM, signalHandler);
     
     // 添加一些示例数据（可选）
-    if (argc > 2 && std::string(argv[2]) == "--demo") {
+    if (demo && follow_host.empty()) {
         std::cout << "正在添加示例数据..." << std::endl;
         
         TransactionRecord demo1;
@@ -166,6 +299,17 @@ int main(int argc, char* argv[]) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
     
+    if (rpc_server) {
+        rpc_server->stop();
+    }
+    if (replication_follower) {
+        replication_follower->stop();
+    }
+    if (replication_primary) {
+        replication_primary->stop();
+    }
+    database->stopMaintenance();
+    
     std::cout << "服务器已关闭" << std::endl;
     return 0;
 }
\ No newline at end of file
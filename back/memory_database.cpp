@@ -4,55 +4,98 @@
 #include <iomanip>
 #include <chrono>
 #include <iostream>
+#include <thread>
+
+namespace {
+
+// 每条内存记录的估算大小（字节），用于内存使用统计和内存预算
+const size_t kEstimatedRecordBytes = 500;
+
+}  // namespace
 
 MemoryDatabase::MemoryDatabase(const std::string& data_dir) 
-    : persistence_enabled_(true) {
+    : persistence_enabled_(true)
+    , checkpoint_interval_(10000)
+    , checkpoint_retention_(32)
+    , memory_budget_kb_(0) {
     
     LOG_INFO("MemoryDatabase", "constructor", "Initializing memory database with data_dir: " + data_dir);
     
     try {
         persistence_.reset(new PersistenceManager(data_dir));
         
-        // 启动时从持久化存储恢复数据
+        // 启动时从持久化存储恢复数据：先读取归档段和最新快照链的清单（库管员目录），再回放快照之后的WAL
+        // 分片文件在首次访问对应库管员时才映射
         TIMER("database_recovery_time");
-        auto recovered_data = persistence_->recoverFromWAL();
-        
-        if (!recovered_data.empty()) {
-            if (persistence_->validateDataIntegrity(recovered_data)) {
-                // 恢复数据到内存
-                size_t total_transactions = 0;
-                for (const auto& manager_pair : recovered_data) {
-                    const std::string& manager_id = manager_pair.first;
-                    const auto& transactions = manager_pair.second;
-                    
-                    ManagerData& data = managers_[manager_id];
-                    data.transactions = transactions;
-                    data.count.store(transactions.size(), std::memory_order_release);
-                    total_transactions += transactions.size();
-                    
-                    LOG_DEBUG("MemoryDatabase", "recovery", 
-                             "Restored " + std::to_string(transactions.size()) + 
-                             " transactions for manager: " + manager_id);
+        
+        size_t archived_transactions = 0;
+        auto archives = persistence_->openArchives();
+        for (const auto& part : archives) {
+            archived_transactions += attachSnapshot(part, true);
+        }
+        if (!archives.empty()) {
+            LOG_INFO("MemoryDatabase", "recovery", 
+                    "Found " + std::to_string(archives.size()) + " archive part files (" +
+                    std::to_string(archived_transactions) + " cold transactions)");
+        }
+        
+        auto chain = persistence_->openSnapshotChain();
+        uint64_t wal_checkpoint = chain.wal_segment;
+        if (!chain.empty()) {
+            size_t snapshot_transactions = 0;
+            for (const auto& part : chain.parts) {
+                snapshot_transactions += attachSnapshot(part, false);
+            }
+            
+            LOG_INFO("MemoryDatabase", "recovery", 
+                    "Loaded snapshot chain of " + std::to_string(chain.generations) + " snapshots (" +
+                    std::to_string(chain.parts.size()) + " part files, " +
+                    std::to_string(snapshot_transactions) + " transactions, mapped on first access)");
+        }
+        
+        // 流式回放WAL：逐条校验后直接移入库管员数据（追加在快照记录之后），坏记录被隔离而不影响其余记录
+        std::string current_id;
+        ManagerData* current = nullptr;
+        auto replay = persistence_->replayWAL(wal_checkpoint,
+            [this, &current_id, &current](const std::string& manager_id, TransactionRecord&& trans) {
+                // WAL中同一库管员的记录通常连续出现，缓存上一次的查找结果
+                if (!current || manager_id != current_id) {
+                    current = &managers_[manager_id];
+                    current_id = manager_id;
                 }
+                ManagerData& data = *current;
+                data.transactions.push_back(std::move(trans));
                 
-                LOG_INFO("MemoryDatabase", "recovery", 
-                        "Data recovery completed. Restored " + std::to_string(recovered_data.size()) +
-                        " managers with " + std::to_string(total_transactions) + " total transactions");
-                
-                // 更新监控指标
-                SET_GAUGE("database_managers_count", recovered_data.size());
-                SET_GAUGE("database_transactions_count", total_transactions);
-                
-            } else {
-                LOG_ERROR("MemoryDatabase", "recovery", "Data integrity validation failed, starting with empty state");
-                ErrorHandler::logError(ErrorCode::DATA_CORRUPTION_DETECTED, 
-                                      "Data integrity validation failed during recovery",
-                                      ERROR_CONTEXT("MemoryDatabase", "recovery"));
-            }
-        } else {
+                // 快照部分的索引已在分片索引文件中，只为WAL回放的记录建立内存索引
+                uint64_t position = data.hot_base + data.transactions.size() - 1;
+                indexTail(data, position, data.transactions.back());
+                data.count.store(position + 1, std::memory_order_release);
+            });
+        
+        if (replay.quarantined > 0) {
+            INC_COUNTER_BY("wal_records_quarantined", replay.quarantined);
+            LOG_ERROR("MemoryDatabase", "recovery", 
+                     "Quarantined " + std::to_string(replay.quarantined) +
+                     " invalid WAL records to wal_quarantine.log");
+            ErrorHandler::logError(ErrorCode::DATA_CORRUPTION_DETECTED, 
+                                  "Invalid WAL records quarantined during recovery",
+                                  ERROR_CONTEXT("MemoryDatabase", "recovery"));
+        }
+        
+        if (replay.replayed > 0) {
+            LOG_INFO("MemoryDatabase", "recovery", 
+                    "WAL replay completed. Restored " + std::to_string(replay.replayed) + " transactions");
+        } else if (chain.empty() && archives.empty()) {
             LOG_INFO("MemoryDatabase", "recovery", "No existing data found, starting with empty database");
         }
         
+        loadInventoryCheckpoints();
+        
+        // 更新监控指标
+        auto status = getSystemStatus();
+        SET_GAUGE("database_managers_count", status.total_managers);
+        SET_GAUGE("database_transactions_count", status.total_transactions);
+        
     } catch (const std::exception& e) {
         LOG_ERROR("MemoryDatabase", "constructor", "Persistence initialization failed: " + std::string(e.what()));
         ErrorHandler::logError(ErrorCode::PERSISTENCE_INIT_FAILED, e.what(),
@@ -64,19 +107,12 @@ MemoryDatabase::MemoryDatabase(const std::string& data_dir)
 }
 
 MemoryDatabase::~MemoryDatabase() {
+    stopMaintenance();
+    
     if (persistence_enabled_ && persistence_) {
         // 关闭前创建最终快照
-        try {
-            std::unordered_map<std::string, std::vector<TransactionRecord>> all_data;
-            for (const auto& manager_pair : managers_) {
-                all_data[manager_pair.first] = manager_pair.second.transactions;
-            }
-            
-            if (persistence_->createSnapshot(all_data)) {
-                std::cout << "✓ 最终快照创建成功" << std::endl;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "⚠️ 创建最终快照失败: " << e.what() << std::endl;
+        if (createSnapshot()) {
+            std::cout << "✓ 最终快照创建成功" << std::endl;
         }
     }
 }
@@ -117,18 +153,30 @@ Result<void> MemoryDatabase::appendTransaction(const std::string& manager_id, co
                                 ERROR_CONTEXT_WITH_IDS("MemoryDatabase", "appendTransaction", manager_id, trans.trans_id));
     }
     
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    
     // 检查重复交易ID（可选的业务逻辑）
     auto it = managers_.find(manager_id);
     if (it != managers_.end()) {
-        size_t current_count = it->second.count.load(std::memory_order_acquire);
-        for (size_t i = 0; i < current_count && i < it->second.transactions.size(); ++i) {
-            if (it->second.transactions[i].trans_id == trans.trans_id) {
-                LOG_WARNING("MemoryDatabase", "appendTransaction", 
-                           "Duplicate transaction ID detected: " + trans.trans_id);
-                return RESULT_ERROR_VOID(ErrorCode::DUPLICATE_TRANSACTION_ID, 
-                                        "Transaction ID already exists",
-                                        ERROR_CONTEXT_WITH_IDS("MemoryDatabase", "appendTransaction", manager_id, trans.trans_id));
-            }
+        // 通过交易ID索引查重，归档段、快照链和内存记录都要检查
+        std::vector<TransactionRecord> existing;
+        bool indexed;
+        {
+            std::lock_guard<std::mutex> lock(it->second.lazy_mutex);
+            indexed = lookupIndexed(it->second, SnapshotIndex::FIELD_TRANS_ID, trans.trans_id,
+                                    0, true, existing);
+        }
+        if (!indexed) {
+            return RESULT_ERROR_VOID(ErrorCode::SNAPSHOT_LOAD_FAILED,
+                                    "Failed to read snapshot index for manager",
+                                    ERROR_CONTEXT_WITH_IDS("MemoryDatabase", "appendTransaction", manager_id, trans.trans_id));
+        }
+        if (!existing.empty()) {
+            LOG_WARNING("MemoryDatabase", "appendTransaction", 
+                       "Duplicate transaction ID detected: " + trans.trans_id);
+            return RESULT_ERROR_VOID(ErrorCode::DUPLICATE_TRANSACTION_ID, 
+                                    "Transaction ID already exists",
+                                    ERROR_CONTEXT_WITH_IDS("MemoryDatabase", "appendTransaction", manager_id, trans.trans_id));
         }
     }
     
@@ -147,13 +195,31 @@ Result<void> MemoryDatabase::appendTransaction(const std::string& manager_id, co
             RECORD_WAL_WRITE(true, 0.0);  // Duration would be measured by TIMER
         }
         
-        // 内存更新：先追加记录，再原子性更新计数器
-        ManagerData& data = managers_[manager_id];
-        data.transactions.push_back(trans);
+        // 内存更新：先追加记录和索引，再原子性更新计数器
+        ManagerData& data = getOrCreateManager(manager_id);
+        size_t position = data.count.load(std::memory_order_relaxed);
+        bool checkpoint_due;
+        {
+            std::lock_guard<std::mutex> lock(data.lazy_mutex);
+            data.transactions.push_back(trans);
+            indexTail(data, position, trans);
+            
+            // 关键：写完数据后，原子性地增加计数器
+            // 这确保读者看到的计数器值对应已完成的写入
+            data.count.fetch_add(1, std::memory_order_release);
+            
+            size_t checkpoint_base = data.checkpoints.empty() ? 0 : data.checkpoints.back()->position;
+            checkpoint_due = position + 1 >= checkpoint_base + checkpoint_interval_;
+        }
+        touch(data);
+        if (checkpoint_due) {
+            requestCheckpoint();
+        }
         
-        // 关键：写完数据后，原子性地增加计数器
-        // 这确保读者看到的计数器值对应已完成的写入
-        data.count.fetch_add(1, std::memory_order_release);
+        // 通知监听者（如复制主库），仍持有写锁，保证按序列位置顺序回调
+        for (const auto& listener : append_listeners_) {
+            listener(manager_id, trans, position);
+        }
         
         // 记录业务指标
         RECORD_TRANSACTION(manager_id, trans.type, trans.getTotalAmount());
@@ -176,33 +242,119 @@ Result<void> MemoryDatabase::appendTransaction(const std::string& manager_id, co
 }
 
 std::vector<TransactionRecord> MemoryDatabase::getTransactions(const std::string& manager_id) const {
-    auto it = managers_.find(manager_id);
-    if (it == managers_.end()) {
+    const ManagerData* data = findManager(manager_id);
+    if (!data) {
         return std::vector<TransactionRecord>();
     }
     
-    // 无锁读取：先获取安全的记录数量，再读取对应数量的数据
-    const ManagerData& data = it->second;
-    size_t safe_count = data.count.load(std::memory_order_acquire);
+    return collectTransactions(*data);
+}
+
+std::vector<TransactionRecord> MemoryDatabase::getTransactionsFrom(const std::string& manager_id, size_t from,
+                                                                   size_t limit) const {
+    const ManagerData* data = findManager(manager_id);
+    if (!data) {
+        return std::vector<TransactionRecord>();
+    }
     
-    // 安全拷贝：只读取已确认写入完成的记录
-    std::vector<TransactionRecord> result;
-    result.reserve(safe_count);
+    return collectTransactions(*data, from, limit);
+}
+
+std::vector<TransactionRecord> MemoryDatabase::collectTransactions(const ManagerData& data, size_t from, size_t limit) const {
+    touch(data);
     
-    for (size_t i = 0; i < safe_count && i < data.transactions.size(); ++i) {
-        result.push_back(data.transactions[i]);
-    }
+    // 追加、归档和淘汰都在 lazy_mutex 下修改内存记录，拷贝期间持有同一把锁，vector 不会被重新分配
+    // 快照分片和归档段中的记录直接解码，不保留在内存中
+    std::lock_guard<std::mutex> lock(data.lazy_mutex);
     
+    std::vector<TransactionRecord> result;
+    size_t safe_count = data.count.load(std::memory_order_acquire);
+    if (from >= safe_count) {
+        return result;
+    }
+    size_t end = from + std::min(limit, safe_count - from);
+    result.reserve(end - from);
+    if (!collectRange(data, from, end, result)) {
+        ErrorHandler::logError(ErrorCode::DATA_CORRUPTION_DETECTED,
+                              "Snapshot or archive block checksum mismatch",
+                              ERROR_CONTEXT("MemoryDatabase", "collectTransactions"));
+        return std::vector<TransactionRecord>();
+    }
     return result;
 }
 
+bool MemoryDatabase::collectRange(const ManagerData& data, size_t from, size_t to,
+                                  std::vector<TransactionRecord>& out) const {
+    size_t start_size = out.size();
+    size_t position = from;
+    
+    // 归档段 [0, archived_count) 和快照块 [archived_count, hot_base)：只映射和解码与 [from, to) 相交的块
+    struct Layer {
+        const std::vector<SnapshotBlockRef>* blocks;
+        size_t end;
+    };
+    const Layer layers[] = {
+        { &data.archive_blocks, data.archived_count.load(std::memory_order_acquire) },
+        { &data.snapshot_blocks, data.hot_base }
+    };
+    for (const auto& layer : layers) {
+        size_t layer_end = std::min(to, layer.end);
+        for (const auto& ref : *layer.blocks) {
+            if (position >= layer_end) {
+                break;
+            }
+            if (ref.part.base_count + ref.part.record_count <= position) {
+                continue;
+            }
+            
+            const ColumnarSnapshot::BlockInfo* block = mapBlock(ref);
+            if (!block || !ColumnarSnapshot::decodeBlockFrom(*block, std::max<uint64_t>(position, ref.from), out)) {
+                return false;
+            }
+            
+            // 块可能越过本层末尾（已在内存中或已归档的部分），截掉
+            position = from + (out.size() - start_size);
+            if (position > layer_end) {
+                out.resize(start_size + (layer_end - from));
+                position = layer_end;
+            }
+        }
+    }
+    
+    // 内存中的记录
+    size_t hot_end = std::min(to, data.hot_base + data.transactions.size());
+    for (size_t pos = std::max(position, data.hot_base); pos < hot_end; ++pos) {
+        out.push_back(data.transactions[pos - data.hot_base]);
+    }
+    return true;
+}
+
+const ColumnarSnapshot::BlockInfo* MemoryDatabase::mapBlock(const SnapshotBlockRef& ref) const {
+    if (!ref.file) {
+        if (!persistence_) {
+            return nullptr;
+        }
+        ref.file = persistence_->openSnapshotPart(ref.part);
+        if (!ref.file) {
+            return nullptr;
+        }
+        INC_COUNTER("snapshot_parts_mapped");
+    }
+    return &ref.file->getBlocks().front();
+}
+
 size_t MemoryDatabase::getTransactionCount(const std::string& manager_id) const {
-    auto it = managers_.find(manager_id);
-    if (it == managers_.end()) {
+    const ManagerData* data = findManager(manager_id);
+    if (!data) {
         return 0;
     }
     
-    return it->second.count.load(std::memory_order_acquire);
+    return data->count.load(std::memory_order_acquire);
+}
+
+void MemoryDatabase::addAppendListener(AppendListener listener) {
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    append_listeners_.push_back(std::move(listener));
 }
 
 // ========== 持久化管理 ==========
@@ -216,75 +368,502 @@ bool MemoryDatabase::createSnapshot() {
         return false;
     }
     
+    std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+    
     try {
-        std::unordered_map<std::string, std::vector<TransactionRecord>> all_data;
-        for (const auto& manager_pair : managers_) {
-            all_data[manager_pair.first] = manager_pair.second.transactions;
+        bool full = persistence_->needsFullSnapshot();
+        std::unordered_map<std::string, PersistenceManager::RecordRange> all_data;
+        std::unordered_map<std::string, PersistenceManager::RecordRange> deltas;
+        std::unordered_map<std::string, size_t> captured_counts;
+        std::vector<std::pair<std::string, const ManagerData*>> full_managers;
+        uint64_t wal_segment;
+        {
+            // 封存WAL与记录各库管员的记录数必须原子完成：快照恰好包含已封存段中的全部记录
+            std::lock_guard<std::mutex> write_lock(write_mutex_);
+            
+            bool changed = false;
+            for (const auto& manager_pair : managers_) {
+                size_t count = manager_pair.second.count.load(std::memory_order_acquire);
+                changed = changed || count > manager_pair.second.snapshot_count;
+            }
+            
+            // 自上次快照以来没有变化
+            if (!changed && persistence_->hasSnapshotChain()) {
+                return true;
+            }
+            
+            for (const auto& manager_pair : managers_) {
+                const ManagerData& data = manager_pair.second;
+                size_t count = data.count.load(std::memory_order_acquire);
+                captured_counts[manager_pair.first] = count;
+                
+                if (full) {
+                    // 全量快照需要解码快照块中的记录，在写锁外读取
+                    full_managers.push_back(std::make_pair(manager_pair.first, &data));
+                } else if (count > data.snapshot_count) {
+                    // 增量：只拷贝快照链之后追加的记录（它们总在内存中，位于 hot_base 之后）
+                    auto& delta = deltas[manager_pair.first];
+                    delta.base_count = data.snapshot_count;
+                    delta.records.assign(data.transactions.begin() + (data.snapshot_count - data.hot_base),
+                                         data.transactions.begin() + (count - data.hot_base));
+                }
+            }
+            
+            wal_segment = persistence_->sealWAL();
+        }
+        
+        // 全量：从归档末尾开始，已归档的记录不再写入快照
+        // 已记录的位置之前的数据不再变化（归档和内存预算淘汰也持有 snapshot_mutex_），
+        // 解码期间只持有该库管员的 lazy_mutex，不阻塞其他库管员的写入
+        for (const auto& manager : full_managers) {
+            const ManagerData& data = *manager.second;
+            auto& range = all_data[manager.first];
+            range.base_count = data.archived_count.load(std::memory_order_acquire);
+            std::lock_guard<std::mutex> lock(data.lazy_mutex);
+            if (!collectRange(data, range.base_count, captured_counts[manager.first], range.records)) {
+                ErrorHandler::logError(ErrorCode::DATA_CORRUPTION_DETECTED,
+                                      "Snapshot block checksum mismatch for manager: " + manager.first,
+                                      ERROR_CONTEXT("MemoryDatabase", "createSnapshot"));
+                return false;
+            }
+        }
+        
+        std::vector<PersistenceManager::SnapshotPart> parts;
+        bool success = full ? persistence_->createSnapshot(all_data, wal_segment, parts)
+                            : persistence_->createDeltaSnapshot(deltas, wal_segment, parts);
+        
+        if (success) {
+            {
+                std::lock_guard<std::mutex> write_lock(write_mutex_);
+                for (const auto& captured : captured_counts) {
+                    auto it = managers_.find(captured.first);
+                    if (it != managers_.end()) {
+                        std::lock_guard<std::mutex> lock(it->second.lazy_mutex);
+                        it->second.snapshot_count = captured.second;
+                        pruneTailIndex(it->second);
+                    }
+                }
+                attachChainParts(parts, full);
+            }
+            
+            LOG_INFO("MemoryDatabase", "createSnapshot", 
+                    std::string(full ? "Full snapshot created for " : "Delta snapshot created for ") +
+                    std::to_string(full ? all_data.size() : deltas.size()) + " managers");
+            
+            updateInventoryCheckpoints();
+            enforceMemoryBudget();
         }
         
-        return persistence_->createSnapshot(all_data);
+        return success;
     } catch (const std::exception& e) {
         std::cerr << "创建快照失败: " << e.what() << std::endl;
         return false;
     }
 }
 
+bool MemoryDatabase::archiveOldData(int days_old) {
+    if (!persistence_enabled_ || !persistence_ || days_old < 0) {
+        return false;
+    }
+    
+    // 只归档已经包含在快照链中的记录，WAL回放从快照链末尾开始，不会与归档段重复
+    if (!createSnapshot()) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+    
+    auto cutoff_time = std::chrono::system_clock::to_time_t(
+        std::chrono::system_clock::now() - std::chrono::hours(24 * days_old));
+    std::ostringstream cutoff_stream;
+    cutoff_stream << std::put_time(std::gmtime(&cutoff_time), "%Y-%m-%dT%H:%M:%S");
+    std::string cutoff = cutoff_stream.str();
+    
+    try {
+        std::unordered_map<std::string, PersistenceManager::RecordRange> cold;
+        {
+            std::lock_guard<std::mutex> write_lock(write_mutex_);
+            
+            for (const auto& manager_pair : managers_) {
+                const ManagerData& data = manager_pair.second;
+                size_t archived = data.archived_count.load(std::memory_order_acquire);
+                if (data.snapshot_count <= archived) {
+                    continue;
+                }
+                
+                std::vector<TransactionRecord> candidates;
+                std::lock_guard<std::mutex> lock(data.lazy_mutex);
+                if (!collectRange(data, archived, data.snapshot_count, candidates)) {
+                    ErrorHandler::logError(ErrorCode::DATA_CORRUPTION_DETECTED,
+                                          "Snapshot block checksum mismatch for manager: " + manager_pair.first,
+                                          ERROR_CONTEXT("MemoryDatabase", "archiveOldData"));
+                    continue;
+                }
+                
+                // 归档必须是连续前缀：遇到第一条不够旧的记录即停止
+                size_t cold_count = 0;
+                while (cold_count < candidates.size() && candidates[cold_count].timestamp < cutoff) {
+                    cold_count++;
+                }
+                if (cold_count == 0) {
+                    continue;
+                }
+                
+                candidates.resize(cold_count);
+                auto& range = cold[manager_pair.first];
+                range.base_count = archived;
+                range.records.swap(candidates);
+            }
+        }
+        
+        if (cold.empty()) {
+            return true;
+        }
+        
+        // 写归档段期间不阻塞写入：新记录总是追加在快照链之后，不受影响
+        std::vector<PersistenceManager::SnapshotPart> parts;
+        if (!persistence_->archiveOldData(cold, parts)) {
+            LOG_ERROR("MemoryDatabase", "archiveOldData", "Failed to write archive segment");
+            return false;
+        }
+        
+        size_t archived_transactions = 0;
+        {
+            std::lock_guard<std::mutex> write_lock(write_mutex_);
+            for (const auto& part : parts) {
+                ManagerData& data = getOrCreateManager(part.manager_id);
+                std::lock_guard<std::mutex> lock(data.lazy_mutex);
+                trimColdPrefix(data, part);
+                archived_transactions += part.record_count;
+            }
+        }
+        
+        // 下一次快照重写为全量，快照链不再保存已归档的记录
+        persistence_->requestFullSnapshot();
+        
+        auto status = getSystemStatus();
+        SET_GAUGE("database_archived_transactions", status.archived_transactions);
+        
+        LOG_INFO("MemoryDatabase", "archiveOldData", 
+                "Archived " + std::to_string(archived_transactions) + " transactions older than " + cutoff +
+                " for " + std::to_string(parts.size()) + " managers");
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("MemoryDatabase", "archiveOldData", "Archive failed: " + std::string(e.what()));
+        return false;
+    }
+}
+
+// ========== 后台维护 ==========
+
+void MemoryDatabase::startMaintenance(std::chrono::seconds interval) {
+    if (!persistence_enabled_ || !persistence_ || interval.count() <= 0) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(maintenance_mutex_);
+    if (maintenance_running_) {
+        return; // 已经在运行
+    }
+    maintenance_interval_ = interval;
+    maintenance_running_ = true;
+    maintenance_thread_ = std::thread([this]() {
+        maintenanceLoop();
+    });
+    
+    LOG_INFO("MemoryDatabase", "startMaintenance", 
+            "Background maintenance every " + std::to_string(interval.count()) + "s" +
+            (archive_after_days_.load() >= 0 ?
+             ", archiving records older than " + std::to_string(archive_after_days_.load()) + " days" : ""));
+}
+
+void MemoryDatabase::stopMaintenance() {
+    {
+        std::lock_guard<std::mutex> lock(maintenance_mutex_);
+        maintenance_running_ = false;
+    }
+    maintenance_cv_.notify_all();
+    
+    if (maintenance_thread_.joinable()) {
+        maintenance_thread_.join();
+    }
+}
+
+void MemoryDatabase::requestCheckpoint() {
+    // 检查点创建前后续追加不再重复唤醒
+    if (checkpoint_requested_.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(maintenance_mutex_);
+    }
+    maintenance_cv_.notify_all();
+}
+
+void MemoryDatabase::maintenanceLoop() {
+    auto next_run = std::chrono::steady_clock::now() + maintenance_interval_;
+    std::unique_lock<std::mutex> lock(maintenance_mutex_);
+    while (true) {
+        bool checkpoint_only = maintenance_cv_.wait_until(lock, next_run, [this]() {
+            return !maintenance_running_ || checkpoint_requested_.load();
+        });
+        if (!maintenance_running_) {
+            break;
+        }
+        lock.unlock();
+        
+        try {
+            if (checkpoint_only) {
+                // 追加越过检查点间隔：只更新库存检查点，不提前触发快照
+                checkpoint_requested_.store(false);
+                std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+                if (persistence_enabled_) {
+                    updateInventoryCheckpoints();
+                }
+            } else {
+                // 定期快照把WAL中的新记录并入快照链，之后才能归档；归档本身会先创建快照
+                int days = archive_after_days_.load();
+                if (days >= 0) {
+                    archiveOldData(days);
+                } else {
+                    createSnapshot();
+                }
+                
+                // 没有新写入时快照不会执行预算，读取映射的分片在这里释放
+                {
+                    std::lock_guard<std::mutex> snapshot_lock(snapshot_mutex_);
+                    enforceMemoryBudget();
+                }
+                next_run = std::chrono::steady_clock::now() + maintenance_interval_;
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("MemoryDatabase", "maintenance", "Maintenance run failed: " + std::string(e.what()));
+        }
+        
+        lock.lock();
+    }
+}
+
 PersistenceManager::StorageInfo MemoryDatabase::getStorageInfo() const {
+    PersistenceManager::StorageInfo info;
     if (persistence_enabled_ && persistence_) {
-        return persistence_->getStorageInfo();
+        info = persistence_->getStorageInfo();
     }
     
-    return PersistenceManager::StorageInfo();
+    info.total_transactions = getSystemStatus().total_transactions;
+    return info;
 }
 
-// ========== 派生表计算 ==========
+// ========== 延迟加载 ==========
 
-std::map<std::string, std::vector<InventoryRecord>> MemoryDatabase::calculateInventory(const std::string& manager_id) const {
-    // 无锁读取交易记录
-    auto transactions = getTransactions(manager_id);
+size_t MemoryDatabase::attachSnapshot(const PersistenceManager::SnapshotPart& part, bool archive) {
+    ManagerData& data = managers_[part.manager_id];
+    uint64_t end = part.base_count + part.record_count;
     
-    std::map<std::string, std::vector<InventoryRecord>> result;
+    // 快照中已被归档段覆盖的部分（以及空块）跳过
+    if (!archive && end <= data.hot_base) {
+        return 0;
+    }
+    
+    bool contiguous = archive ? part.base_count == data.archived_count.load()
+                              : part.base_count <= data.hot_base;
+    if (!contiguous) {
+        LOG_ERROR("MemoryDatabase", "attachSnapshot", 
+                 "Non-contiguous snapshot block for manager: " + part.manager_id + " in " + part.path);
+        ErrorHandler::logError(ErrorCode::DATA_CORRUPTION_DETECTED,
+                              "Snapshot chain has a gap for manager: " + part.manager_id,
+                              ERROR_CONTEXT("MemoryDatabase", "attachSnapshot"));
+        return 0;
+    }
     
-    // 按 warehouse_id + item_id 分组计算库存
-    std::map<std::pair<std::string, std::string>, InventoryRecord> inventory_map;
+    SnapshotBlockRef ref;
+    ref.part = part;
+    ref.from = std::max<uint64_t>(part.base_count, data.hot_base);
     
-    for (const auto& trans : transactions) {
-        auto key = std::make_pair(trans.warehouse_id, trans.item_id);
-        
-        if (inventory_map.find(key) == inventory_map.end()) {
-            inventory_map[key].item_id = trans.item_id;
-            inventory_map[key].warehouse_id = trans.warehouse_id;
-            inventory_map[key].quantity = 0;
-            inventory_map[key].avg_price = 0.0;
+    if (archive) {
+        data.archive_blocks.push_back(ref);
+        data.archived_count.store(end, std::memory_order_release);
+    } else {
+        data.snapshot_blocks.push_back(ref);
+    }
+    data.hot_base = end;
+    data.snapshot_count = data.hot_base;
+    data.count.store(data.hot_base, std::memory_order_release);
+    
+    return end - ref.from;
+}
+
+void MemoryDatabase::attachChainParts(const std::vector<PersistenceManager::SnapshotPart>& parts, bool full) {
+    // 先为每个库管员构造新的块列表，再在一次 lazy_mutex 内替换或追加，读者不会看到被截断的快照链
+    std::unordered_map<ManagerData*, std::vector<SnapshotBlockRef>> attached;
+    
+    // 全量快照包含所有库管员从归档末尾开始的记录，替换原来的快照链
+    if (full) {
+        for (auto& manager_pair : managers_) {
+            attached[&manager_pair.second];
+        }
+    }
+    
+    for (const auto& part : parts) {
+        auto it = managers_.find(part.manager_id);
+        if (it == managers_.end() || part.record_count == 0) {
+            continue;
         }
         
-        auto& record = inventory_map[key];
-        
-        if (trans.isInbound()) {
-            // 入库：增加数量，更新平均价格
-            double total_value = record.quantity * record.avg_price + trans.quantity * trans.unit_price;
-            record.quantity += trans.quantity;
-            if (record.quantity > 0) {
-                record.avg_price = total_value / record.quantity;
-            }
+        ManagerData& data = it->second;
+        SnapshotBlockRef ref;
+        ref.part = part;
+        ref.from = std::max<uint64_t>(part.base_count, data.archived_count.load(std::memory_order_acquire));
+        attached[&data].push_back(ref);
+    }
+    
+    for (auto& entry : attached) {
+        ManagerData& data = *entry.first;
+        std::lock_guard<std::mutex> lock(data.lazy_mutex);
+        if (full) {
+            data.snapshot_blocks.swap(entry.second);
         } else {
-            // 出库：减少数量
-            record.quantity -= trans.quantity;
+            data.snapshot_blocks.insert(data.snapshot_blocks.end(), entry.second.begin(), entry.second.end());
         }
     }
+}
+
+void MemoryDatabase::trimColdPrefix(ManagerData& data, const PersistenceManager::SnapshotPart& archive_part) {
+    uint64_t archived = archive_part.base_count + archive_part.record_count;
+    
+    // 丢弃已被归档段完全覆盖的快照块，部分覆盖的块从归档末尾开始读取
+    std::vector<SnapshotBlockRef> remaining;
+    for (const auto& ref : data.snapshot_blocks) {
+        if (ref.part.base_count + ref.part.record_count > archived) {
+            remaining.push_back(ref);
+            remaining.back().from = std::max<uint64_t>(ref.from, archived);
+        }
+    }
+    data.snapshot_blocks.swap(remaining);
     
-    // 按仓库分组，只保留数量大于0的记录
-    for (const auto& pair : inventory_map) {
-        if (pair.second.quantity > 0) {
-            result[pair.first.first].push_back(pair.second);
+    data.archived_count.store(archived);
+    
+    // 内存中的冷记录：只保留热数据，释放原有容量
+    if (data.hot_base < archived) {
+        std::vector<TransactionRecord> hot(
+            std::make_move_iterator(data.transactions.begin() + (archived - data.hot_base)),
+            std::make_move_iterator(data.transactions.end()));
+        data.transactions.swap(hot);
+        data.hot_base = archived;
+    }
+    
+    SnapshotBlockRef ref;
+    ref.part = archive_part;
+    ref.from = archive_part.base_count;
+    data.archive_blocks.push_back(ref);
+}
+
+// ========== 内存预算 ==========
+
+void MemoryDatabase::enforceMemoryBudget() {
+    if (memory_budget_kb_ == 0) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    
+    // 常驻内存估算：内存中的记录加上已映射的分片；只有快照链已包含的部分可以释放
+    size_t resident = 0;
+    std::vector<std::pair<uint64_t, ManagerData*>> candidates;
+    for (auto& manager_pair : managers_) {
+        ManagerData& data = manager_pair.second;
+        size_t hot = data.count.load(std::memory_order_acquire) - data.hot_base;
+        size_t mapped = 0;
+        {
+            std::lock_guard<std::mutex> lock(data.lazy_mutex);
+            for (const auto* layer : { &data.archive_blocks, &data.snapshot_blocks }) {
+                for (const auto& ref : *layer) {
+                    mapped += ref.file ? ref.file->getMappedSize() : 0;
+                    mapped += ref.index ? ref.index->getMappedSize() : 0;
+                }
+            }
+        }
+        
+        resident += hot * kEstimatedRecordBytes + mapped;
+        if (data.snapshot_count > data.hot_base || mapped > 0) {
+            candidates.push_back(std::make_pair(data.last_access.load(std::memory_order_relaxed), &data));
         }
     }
     
-    return result;
+    size_t budget = memory_budget_kb_ * 1024;
+    if (resident <= budget) {
+        SET_GAUGE("database_resident_kb", resident / 1024);
+        return;
+    }
+    
+    // 最近最少访问的库管员先释放
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::pair<uint64_t, ManagerData*>& a, const std::pair<uint64_t, ManagerData*>& b) {
+                  return a.first < b.first;
+              });
+    
+    size_t evicted = 0;
+    size_t released = 0;
+    for (const auto& candidate : candidates) {
+        if (resident - released <= budget) {
+            break;
+        }
+        released += evictManager(*candidate.second);
+        evicted++;
+    }
+    
+    INC_COUNTER_BY("managers_evicted", evicted);
+    SET_GAUGE("database_resident_kb", (resident - released) / 1024);
+    LOG_INFO("MemoryDatabase", "enforceMemoryBudget", 
+            "Evicted " + std::to_string(evicted) + " idle managers, released about " +
+            std::to_string(released / 1024) + " KB (budget " + std::to_string(memory_budget_kb_) + " KB)");
+}
+
+size_t MemoryDatabase::evictManager(ManagerData& data) {
+    std::lock_guard<std::mutex> lock(data.lazy_mutex);
+    
+    size_t released = 0;
+    for (auto* layer : { &data.archive_blocks, &data.snapshot_blocks }) {
+        for (const auto& ref : *layer) {
+            if (ref.file) {
+                released += ref.file->getMappedSize();
+                ref.file.reset();
+            }
+            if (ref.index) {
+                released += ref.index->getMappedSize();
+                ref.index.reset();
+            }
+        }
+    }
+    
+    // 快照链已包含的内存记录改为从快照块读取
+    if (data.snapshot_count > data.hot_base) {
+        size_t drop = data.snapshot_count - data.hot_base;
+        std::vector<TransactionRecord> hot(
+            std::make_move_iterator(data.transactions.begin() + drop),
+            std::make_move_iterator(data.transactions.end()));
+        data.transactions.swap(hot);
+        data.hot_base = data.snapshot_count;
+        released += drop * kEstimatedRecordBytes;
+    }
+    
+    return released;
+}
+
+// ========== 派生表计算 ==========
+
+std::map<std::string, std::vector<InventoryRecord>> MemoryDatabase::calculateInventory(const std::string& manager_id) const {
+    return groupInventoryByWarehouse(replayInventory(manager_id, nullptr));
+}
+
+std::map<std::string, std::vector<InventoryRecord>> MemoryDatabase::calculateInventoryAsOf(
+    const std::string& manager_id,
+    const std::string& as_of) const {
+    return groupInventoryByWarehouse(replayInventory(manager_id, &as_of));
 }
 
 std::vector<ItemSummary> MemoryDatabase::getCurrentItems(const std::string& manager_id) const {
-    // 无锁读取交易记录
+    // 拷贝交易记录后在锁外计算
     auto transactions = getTransactions(manager_id);
     
     std::vector<ItemSummary> result;
@@ -300,7 +879,7 @@ std::vector<ItemSummary> MemoryDatabase::getCurrentItems(const std::string& mana
 }
 
 std::vector<DocumentSummary> MemoryDatabase::getDocuments(const std::string& manager_id) const {
-    // 无锁读取交易记录
+    // 拷贝交易记录后在锁外计算
     auto transactions = getTransactions(manager_id);
     
     std::vector<DocumentSummary> result;
@@ -313,66 +892,366 @@ std::vector<DocumentSummary> MemoryDatabase::getDocuments(const std::string& man
     return result;
 }
 
-// ========== 查询功能 ==========
+// ========== 库存检查点 ==========
 
-std::vector<TransactionRecord> MemoryDatabase::getTransactionsByTimeRange(
-    const std::string& manager_id,
-    const std::string& start_time,
-    const std::string& end_time) const {
+void MemoryDatabase::applyToInventory(InventoryBalanceMap& inventory, const TransactionRecord& trans) {
+    auto key = std::make_pair(trans.warehouse_id, trans.item_id);
+    
+    if (inventory.find(key) == inventory.end()) {
+        inventory[key].item_id = trans.item_id;
+        inventory[key].warehouse_id = trans.warehouse_id;
+        inventory[key].quantity = 0;
+        inventory[key].avg_price = 0.0;
+    }
     
-    // 无锁读取交易记录
-    auto transactions = getTransactions(manager_id);
+    auto& record = inventory[key];
     
-    std::vector<TransactionRecord> result;
+    if (trans.isInbound()) {
+        // 入库：增加数量，更新平均价格
+        double total_value = record.quantity * record.avg_price + trans.quantity * trans.unit_price;
+        record.quantity += trans.quantity;
+        if (record.quantity > 0) {
+            record.avg_price = total_value / record.quantity;
+        }
+    } else {
+        // 出库：减少数量
+        record.quantity -= trans.quantity;
+    }
+}
+
+std::map<std::string, std::vector<InventoryRecord>> MemoryDatabase::groupInventoryByWarehouse(
+    const InventoryBalanceMap& inventory) {
+    std::map<std::string, std::vector<InventoryRecord>> result;
     
-    for (const auto& trans : transactions) {
-        if (isTimeInRange(trans.timestamp, start_time, end_time)) {
-            result.push_back(trans);
+    // 按仓库分组，只保留数量大于0的记录
+    for (const auto& pair : inventory) {
+        if (pair.second.quantity > 0) {
+            result[pair.first.first].push_back(pair.second);
         }
     }
     
     return result;
 }
 
-std::vector<TransactionRecord> MemoryDatabase::getTransactionsByItem(
-    const std::string& manager_id,
-    const std::string& item_id) const {
+InventoryBalanceMap MemoryDatabase::replayInventory(const std::string& manager_id, const std::string* as_of) const {
+    const ManagerData* found = findManager(manager_id);
+    if (!found) {
+        return InventoryBalanceMap();
+    }
+    const ManagerData& data = *found;
     
-    // 无锁读取交易记录
-    auto transactions = getTransactions(manager_id);
+    std::vector<std::shared_ptr<const InventoryCheckpoint>> checkpoints;
+    {
+        std::lock_guard<std::mutex> lock(data.lazy_mutex);
+        checkpoints = data.checkpoints;
+    }
     
-    std::vector<TransactionRecord> result;
+    // 从最近的可用检查点开始：按时间点查询时，检查点包含的记录必须都不晚于 as_of
+    size_t count = data.count.load(std::memory_order_acquire);
+    for (auto cp = checkpoints.rbegin(); cp != checkpoints.rend(); ++cp) {
+        const InventoryCheckpoint& checkpoint = **cp;
+        if (checkpoint.position > count || (as_of && checkpoint.max_timestamp > *as_of)) {
+            continue;
+        }
+        
+        // 连同检查点的最后一条记录一起读取，校验检查点与数据一致
+        auto transactions = collectTransactions(data, checkpoint.position - 1);
+        if (transactions.empty() || transactions.front().trans_id != checkpoint.last_trans_id) {
+            LOG_WARNING("MemoryDatabase", "replayInventory", 
+                       "Inventory checkpoint at " + std::to_string(checkpoint.position) +
+                       " does not match data for manager: " + manager_id);
+            continue;
+        }
+        
+        InventoryBalanceMap inventory = checkpoint.balances;
+        for (size_t i = 1; i < transactions.size(); ++i) {
+            if (!as_of || transactions[i].timestamp <= *as_of) {
+                applyToInventory(inventory, transactions[i]);
+            }
+        }
+        INC_COUNTER("inventory_checkpoint_hits");
+        return inventory;
+    }
     
-    for (const auto& trans : transactions) {
-        if (trans.item_id == item_id) {
-            result.push_back(trans);
+    // 没有可用的检查点：从第一条记录开始重放
+    InventoryBalanceMap inventory;
+    for (const auto& trans : collectTransactions(data)) {
+        if (!as_of || trans.timestamp <= *as_of) {
+            applyToInventory(inventory, trans);
+        }
+    }
+    INC_COUNTER("inventory_checkpoint_misses");
+    return inventory;
+}
+
+void MemoryDatabase::loadInventoryCheckpoints() {
+    size_t loaded = 0;
+    for (auto& entry : persistence_->loadInventoryCheckpoints()) {
+        auto it = managers_.find(entry.first);
+        if (it == managers_.end()) {
+            continue;
+        }
+        
+        // 超出已恢复数据的检查点（WAL尾部丢失）不可用
+        ManagerData& data = it->second;
+        if (entry.second.position == 0 || entry.second.position > data.count.load() ||
+            (!data.checkpoints.empty() && data.checkpoints.back()->position >= entry.second.position)) {
+            continue;
         }
+        
+        data.checkpoints.push_back(std::make_shared<const InventoryCheckpoint>(std::move(entry.second)));
+        loaded++;
     }
     
-    return result;
+    if (loaded > 0) {
+        LOG_INFO("MemoryDatabase", "recovery", "Loaded " + std::to_string(loaded) + " inventory checkpoints");
+    }
 }
 
-std::vector<TransactionRecord> MemoryDatabase::getTransactionsByDocument(
-    const std::string& manager_id,
-    const std::string& document_no) const {
+void MemoryDatabase::updateInventoryCheckpoints() {
+    // 调用方持有 snapshot_mutex_：检查点只在这里创建，无需防止并发创建
+    std::vector<std::pair<std::string, ManagerData*>> managers;
+    {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        for (auto& manager_pair : managers_) {
+            managers.push_back(std::make_pair(manager_pair.first, &manager_pair.second));
+        }
+    }
     
-    // 无锁读取交易记录
-    auto transactions = getTransactions(manager_id);
+    std::vector<std::pair<std::string, InventoryCheckpoint>> created;
+    bool evicted = false;
+    for (const auto& manager : managers) {
+        ManagerData& data = *manager.second;
+        
+        // 在上一个检查点的基础上累加新增记录；与数据不一致的检查点被丢弃
+        std::shared_ptr<const InventoryCheckpoint> previous;
+        std::vector<TransactionRecord> transactions;
+        size_t base = 0;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(data.lazy_mutex);
+                previous = data.checkpoints.empty() ? nullptr : data.checkpoints.back();
+            }
+            
+            base = previous ? previous->position : 0;
+            if (data.count.load(std::memory_order_acquire) < base + checkpoint_interval_) {
+                transactions.clear();
+                break;
+            }
+            
+            transactions = collectTransactions(data, previous ? base - 1 : 0);
+            if (!previous || (!transactions.empty() && transactions.front().trans_id == previous->last_trans_id)) {
+                break;
+            }
+            
+            LOG_WARNING("MemoryDatabase", "updateInventoryCheckpoints", 
+                       "Dropping inventory checkpoint at " + std::to_string(base) +
+                       " that does not match data for manager: " + manager.first);
+            std::lock_guard<std::mutex> lock(data.lazy_mutex);
+            data.checkpoints.pop_back();
+            evicted = true;
+        }
+        
+        size_t first = previous ? 1 : 0;
+        if (transactions.size() <= first) {
+            continue;
+        }
+        
+        auto checkpoint = std::make_shared<InventoryCheckpoint>();
+        if (previous) {
+            checkpoint->balances = previous->balances;
+            checkpoint->max_timestamp = previous->max_timestamp;
+        }
+        for (size_t i = first; i < transactions.size(); ++i) {
+            applyToInventory(checkpoint->balances, transactions[i]);
+            checkpoint->max_timestamp = std::max(checkpoint->max_timestamp, transactions[i].timestamp);
+        }
+        checkpoint->position = base + transactions.size() - first;
+        checkpoint->last_trans_id = transactions.back().trans_id;
+        
+        {
+            std::lock_guard<std::mutex> lock(data.lazy_mutex);
+            data.checkpoints.push_back(checkpoint);
+            if (data.checkpoints.size() > checkpoint_retention_) {
+                data.checkpoints.erase(data.checkpoints.begin());
+                evicted = true;
+            }
+        }
+        created.push_back(std::make_pair(manager.first, *checkpoint));
+    }
     
-    std::vector<TransactionRecord> result;
+    if (created.empty() && !evicted) {
+        return;
+    }
     
-    for (const auto& trans : transactions) {
-        if (trans.document_no == document_no) {
-            result.push_back(trans);
+    // 有检查点被淘汰或丢弃时重写整个文件，否则追加
+    bool saved;
+    if (evicted) {
+        std::vector<std::pair<std::string, InventoryCheckpoint>> retained;
+        for (const auto& manager : managers) {
+            std::lock_guard<std::mutex> lock(manager.second->lazy_mutex);
+            for (const auto& checkpoint : manager.second->checkpoints) {
+                retained.push_back(std::make_pair(manager.first, *checkpoint));
+            }
+        }
+        saved = persistence_->rewriteInventoryCheckpoints(retained);
+    } else {
+        saved = persistence_->saveInventoryCheckpoints(created);
+    }
+    
+    if (!saved) {
+        LOG_ERROR("MemoryDatabase", "updateInventoryCheckpoints", "Failed to persist inventory checkpoints");
+    } else {
+        LOG_DEBUG("MemoryDatabase", "updateInventoryCheckpoints", 
+                 "Created " + std::to_string(created.size()) + " inventory checkpoints");
+    }
+}
+
+// ========== 二级索引 ==========
+
+const SnapshotIndex* MemoryDatabase::mapIndex(const SnapshotBlockRef& ref) const {
+    if (!ref.index && !ref.index_missing) {
+        ref.index = persistence_ ? persistence_->openSnapshotIndex(ref.part) : nullptr;
+        if (!ref.index) {
+            // 旧快照没有索引文件：不再重试，查询时扫描该分片
+            ref.index_missing = true;
+            LOG_DEBUG("MemoryDatabase", "mapIndex", "No usable index for snapshot part: " + ref.part.path);
+        }
+    }
+    return ref.index.get();
+}
+
+void MemoryDatabase::indexTail(ManagerData& data, size_t position, const TransactionRecord& trans) {
+    for (uint8_t f = 0; f < SnapshotIndex::FIELD_COUNT; ++f) {
+        const std::string& key = SnapshotIndex::fieldValue(trans, static_cast<SnapshotIndex::Field>(f));
+        data.tail_index[f][key].push_back(position);
+    }
+}
+
+void MemoryDatabase::pruneTailIndex(ManagerData& data) {
+    for (auto& field_index : data.tail_index) {
+        for (auto it = field_index.begin(); it != field_index.end(); ) {
+            auto& positions = it->second;
+            positions.erase(positions.begin(),
+                            std::lower_bound(positions.begin(), positions.end(), data.snapshot_count));
+            if (positions.empty()) {
+                it = field_index.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+bool MemoryDatabase::lookupIndexed(const ManagerData& data, SnapshotIndex::Field field, const std::string& key,
+                                   size_t from, bool first_only, std::vector<TransactionRecord>& out) const {
+    // 快照链和归档段中的记录：用分片的索引文件定位，只读取包含匹配记录的分片
+    struct Layer {
+        const std::vector<SnapshotBlockRef>* blocks;
+        size_t end;
+    };
+    const Layer layers[] = {
+        { &data.archive_blocks, data.archived_count.load(std::memory_order_acquire) },
+        { &data.snapshot_blocks, data.snapshot_count }
+    };
+    for (const auto& layer : layers) {
+        for (const auto& ref : *layer.blocks) {
+            uint64_t begin = std::max<uint64_t>(ref.from, from);
+            uint64_t end = std::min<uint64_t>(ref.part.base_count + ref.part.record_count, layer.end);
+            if (begin >= end) {
+                continue;
+            }
+            
+            std::vector<uint64_t> positions;
+            const SnapshotIndex* index = mapIndex(ref);
+            if (index) {
+                std::vector<uint32_t> offsets;
+                index->lookup(field, key, offsets);
+                for (uint32_t offset : offsets) {
+                    uint64_t position = ref.part.base_count + offset;
+                    if (position >= begin && position < end) {
+                        positions.push_back(position);
+                    }
+                }
+                if (positions.empty()) {
+                    continue;
+                }
+            }
+            
+            // 已在内存中的部分直接读取，否则解码分片
+            std::vector<TransactionRecord> decoded;
+            const TransactionRecord* records;
+            if (begin >= data.hot_base) {
+                records = data.transactions.data() + (begin - data.hot_base);
+            } else {
+                const ColumnarSnapshot::BlockInfo* block = mapBlock(ref);
+                if (!block || !ColumnarSnapshot::decodeBlockFrom(*block, begin, decoded)) {
+                    ErrorHandler::logError(ErrorCode::DATA_CORRUPTION_DETECTED,
+                                          "Snapshot block checksum mismatch in " + ref.part.path,
+                                          ERROR_CONTEXT("MemoryDatabase", "lookupIndexed"));
+                    return false;
+                }
+                records = decoded.data();
+            }
+            
+            if (!index) {
+                for (uint64_t position = begin; position < end; ++position) {
+                    if (SnapshotIndex::fieldValue(records[position - begin], field) == key) {
+                        positions.push_back(position);
+                    }
+                }
+            }
+            for (uint64_t position : positions) {
+                out.push_back(records[position - begin]);
+                if (first_only) {
+                    return true;
+                }
+            }
         }
     }
     
+    // 快照之后追加的记录：内存索引
+    const auto& field_index = data.tail_index[field];
+    auto it = field_index.find(key);
+    if (it != field_index.end()) {
+        size_t count = data.count.load(std::memory_order_acquire);
+        for (uint64_t position : it->second) {
+            if (position >= from && position < count) {
+                out.push_back(data.transactions[position - data.hot_base]);
+                if (first_only) {
+                    return true;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<TransactionRecord> MemoryDatabase::findIndexed(const std::string& manager_id,
+                                                           SnapshotIndex::Field field,
+                                                           const std::string& key) const {
+    const ManagerData* found = findManager(manager_id);
+    if (!found) {
+        return std::vector<TransactionRecord>();
+    }
+    
+    const ManagerData& data = *found;
+    touch(data);
+    
+    std::lock_guard<std::mutex> lock(data.lazy_mutex);
+    std::vector<TransactionRecord> result;
+    if (!lookupIndexed(data, field, key, 0, false, result)) {
+        return std::vector<TransactionRecord>();
+    }
     return result;
 }
 
-std::vector<TransactionRecord> MemoryDatabase::getTransactionsByPartner(
+// ========== 查询功能 ==========
+
+std::vector<TransactionRecord> MemoryDatabase::getTransactionsByTimeRange(
     const std::string& manager_id,
-    const std::string& partner_id) const {
+    const std::string& start_time,
+    const std::string& end_time) const {
     
     // 无锁读取交易记录
     auto transactions = getTransactions(manager_id);
@@ -380,7 +1259,7 @@ std::vector<TransactionRecord> MemoryDatabase::getTransactionsByPartner(
     std::vector<TransactionRecord> result;
     
     for (const auto& trans : transactions) {
-        if (trans.partner_id == partner_id) {
+        if (isTimeInRange(trans.timestamp, start_time, end_time)) {
             result.push_back(trans);
         }
     }
@@ -388,6 +1267,24 @@ std::vector<TransactionRecord> MemoryDatabase::getTransactionsByPartner(
     return result;
 }
 
+std::vector<TransactionRecord> MemoryDatabase::getTransactionsByItem(
+    const std::string& manager_id,
+    const std::string& item_id) const {
+    return findIndexed(manager_id, SnapshotIndex::FIELD_ITEM_ID, item_id);
+}
+
+std::vector<TransactionRecord> MemoryDatabase::getTransactionsByDocument(
+    const std::string& manager_id,
+    const std::string& document_no) const {
+    return findIndexed(manager_id, SnapshotIndex::FIELD_DOCUMENT_NO, document_no);
+}
+
+std::vector<TransactionRecord> MemoryDatabase::getTransactionsByPartner(
+    const std::string& manager_id,
+    const std::string& partner_id) const {
+    return findIndexed(manager_id, SnapshotIndex::FIELD_PARTNER_ID, partner_id);
+}
+
 // ========== 统计功能 ==========
 
 size_t MemoryDatabase::getTotalTransactionCount(const std::string& manager_id) const {
@@ -452,6 +1349,7 @@ std::map<std::string, int> MemoryDatabase::getInventoryByCategory(const std::str
 
 std::vector<std::string> MemoryDatabase::getAllManagerIds() const {
     std::vector<std::string> result;
+    std::shared_lock<std::shared_mutex> lock(managers_mutex_);
     for (const auto& pair : managers_) {
         result.push_back(pair.first);
     }
@@ -460,7 +1358,7 @@ std::vector<std::string> MemoryDatabase::getAllManagerIds() const {
 }
 
 bool MemoryDatabase::hasManager(const std::string& manager_id) const {
-    return managers_.find(manager_id) != managers_.end();
+    return findManager(manager_id) != nullptr;
 }
 
 std::string MemoryDatabase::generateTransactionId() const {
@@ -474,16 +1372,34 @@ std::string MemoryDatabase::generateTransactionId() const {
     return ss.str();
 }
 
+const MemoryDatabase::ManagerData* MemoryDatabase::findManager(const std::string& manager_id) const {
+    std::shared_lock<std::shared_mutex> lock(managers_mutex_);
+    auto it = managers_.find(manager_id);
+    return it == managers_.end() ? nullptr : &it->second;
+}
+
+MemoryDatabase::ManagerData& MemoryDatabase::getOrCreateManager(const std::string& manager_id) {
+    std::unique_lock<std::shared_mutex> lock(managers_mutex_);
+    return managers_[manager_id];
+}
+
 MemoryDatabase::SystemStatus MemoryDatabase::getSystemStatus() const {
     SystemStatus status;
+    std::shared_lock<std::shared_mutex> lock(managers_mutex_);
     status.total_managers = managers_.size();
     
+    size_t resident_transactions = 0;
     for (const auto& pair : managers_) {
-        status.total_transactions += pair.second.count.load(std::memory_order_acquire);
+        size_t count = pair.second.count.load(std::memory_order_acquire);
+        size_t archived = pair.second.archived_count.load(std::memory_order_acquire);
+        status.total_transactions += count;
+        status.archived_transactions += archived;
+        std::lock_guard<std::mutex> data_lock(pair.second.lazy_mutex);
+        resident_transactions += pair.second.transactions.size();
     }
     
-    // 粗略估算内存使用 (每条记录约500字节)
-    status.memory_usage_kb = status.total_transactions * 500 / 1024;
+    // 粗略估算内存使用 (每条记录约500字节，映射的快照块和归档段不计入)
+    status.memory_usage_kb = resident_transactions * kEstimatedRecordBytes / 1024;
     
     return status;
 }
@@ -10,8 +10,16 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <array>
 #include <memory>
 #include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 
 class MemoryDatabase {
 public:
@@ -23,9 +31,29 @@ public:
     // 启用/禁用持久化
     void enablePersistence(bool enable = true);
     
-    // 手动创建快照
+    // 手动创建快照（默认写增量快照，达到合并间隔时写全量快照）
     bool createSnapshot();
     
+    // 冷数据分层：把早于 days_old 天、且已包含在快照中的记录移入只读映射的归档段
+    // 归档后的记录不再占用内存，仍可通过所有查询接口读取
+    bool archiveOldData(int days_old);
+    
+    // 设置库存检查点间隔：库管员每新增 records 条记录保存一个检查点
+    // （追加越过间隔时由后台维护创建，快照后也会补齐）
+    void setInventoryCheckpointInterval(size_t records) { checkpoint_interval_ = records < 1 ? 1 : records; }
+    
+    // 设置内存预算（KB，0 表示不限制）：每次快照后和每轮后台维护时，超出预算则按最近最少访问的顺序
+    // 释放空闲库管员已持久化的内存记录和快照映射，下次访问时再从快照分片读取
+    void setMemoryBudget(size_t kb) { memory_budget_kb_ = kb; }
+    
+    // 设置归档天数：后台维护把早于 days 天的记录归档（负数表示不归档）
+    void setArchiveAfterDays(int days) { archive_after_days_.store(days); }
+    
+    // 后台维护：每隔 interval 创建一次快照（快照后更新库存检查点），设置了归档天数时随后归档冷数据，
+    // 然后执行内存预算（只读访问映射的分片也会被释放）；追加越过检查点间隔时立即创建检查点；析构前自动停止
+    void startMaintenance(std::chrono::seconds interval);
+    void stopMaintenance();
+    
     // 获取存储信息
     PersistenceManager::StorageInfo getStorageInfo() const;
     
@@ -37,14 +65,29 @@ public:
     // 读取指定库管员的交易记录（安全读取指定数量）
     std::vector<TransactionRecord> getTransactions(const std::string& manager_id) const;
     
+    // 读取序列位置 from 之后的交易记录，最多 limit 条（复制追赶时只发送从库缺少的部分）
+    std::vector<TransactionRecord> getTransactionsFrom(const std::string& manager_id, size_t from,
+                                                       size_t limit = std::numeric_limits<size_t>::max()) const;
+    
     // 获取当前交易记录数量
     size_t getTransactionCount(const std::string& manager_id) const;
     
+    // 追加监听：每条记录写入成功后以 (库管员ID, 记录, 序列位置) 回调
+    // 回调在写锁内按写入顺序执行，必须很快返回且不能再调用写接口
+    typedef std::function<void(const std::string& manager_id, const TransactionRecord& trans,
+                               size_t position)> AppendListener;
+    void addAppendListener(AppendListener listener);
+    
     // ========== 派生表计算 ==========
     
-    // 计算当前库存 (按仓库分组)
+    // 计算当前库存 (按仓库分组)，从最近的库存检查点开始重放
     std::map<std::string, std::vector<InventoryRecord>> calculateInventory(const std::string& manager_id) const;
     
+    // 计算某一时间点的库存：只计入时间戳不晚于 as_of 的记录（ISO 8601字符串比较）
+    std::map<std::string, std::vector<InventoryRecord>> calculateInventoryAsOf(
+        const std::string& manager_id,
+        const std::string& as_of) const;
+    
     // 获取物品清单
     std::vector<ItemSummary> getCurrentItems(const std::string& manager_id) const;
     
@@ -59,7 +102,7 @@ public:
         const std::string& start_time,
         const std::string& end_time) const;
     
-    // 按物品ID查询交易记录
+    // 按物品ID查询交易记录（以下三个查询使用二级索引：快照分片的索引文件 + 快照之后记录的内存索引）
     std::vector<TransactionRecord> getTransactionsByItem(
         const std::string& manager_id,
         const std::string& item_id) const;
@@ -115,35 +158,92 @@ public:
     struct SystemStatus {
         size_t total_managers;
         size_t total_transactions;
+        size_t archived_transactions;   // 其中已归档（不在内存中）的记录数
         size_t memory_usage_kb;
         
-        SystemStatus() : total_managers(0), total_transactions(0), memory_usage_kb(0) {}
+        SystemStatus() : total_managers(0), total_transactions(0), archived_transactions(0), memory_usage_kb(0) {}
     };
     
     SystemStatus getSystemStatus() const;
 
 private:
+    // 快照分片中的列块：启动时只知道清单中的位置，首次访问时才映射（映射由 lazy_mutex 保护）
+    struct SnapshotBlockRef {
+        PersistenceManager::SnapshotPart part;
+        uint64_t from;      // 从该序列位置开始有效（之前的记录已由归档段覆盖）
+        mutable std::shared_ptr<const MappedSnapshot> file;
+        mutable std::shared_ptr<const SnapshotIndex> index;
+        mutable bool index_missing;     // 没有可用的索引文件（旧快照），查询时扫描该分片
+        
+        SnapshotBlockRef() : from(0), index_missing(false) {}
+    };
+    
+    // 快照之后追加的记录的内存索引：键 -> 序列位置（升序）
+    typedef std::array<std::unordered_map<std::string, std::vector<uint64_t>>, SnapshotIndex::FIELD_COUNT> TailIndex;
+    
     // 核心数据结构：库管员ID -> 交易记录列表和原子计数器
+    // 序列位置依次分为三层：归档段 [0, archived_count)、快照块 [archived_count, hot_base)、内存 [hot_base, count)
     struct ManagerData {
-        std::vector<TransactionRecord> transactions;
+        std::vector<TransactionRecord> transactions;   // 内存中的记录，对应序列位置 [hot_base, count)
         std::atomic<size_t> count{0};  // 原子计数器：当前有效交易数量
         
+        // 延迟加载：快照中的记录不进入内存，直接从列块读取（写入也不需要先加载）
+        // 快照块始终覆盖快照链中的 [archived_count, snapshot_count)，其中 [archived_count, hot_base) 部分被读取
+        std::vector<SnapshotBlockRef> snapshot_blocks;
+        size_t hot_base = 0;
+        
+        // 冷数据：已归档的前缀始终留在只读映射的归档段中，不会读入内存
+        std::vector<SnapshotBlockRef> archive_blocks;   // 覆盖序列位置 [0, archived_count)
+        std::atomic<size_t> archived_count{0};
+        
+        // 修改块列表或内存记录需要同时持有 write_mutex_ 和此锁；读取记录时持有此锁（按需映射分片）
+        mutable std::mutex lazy_mutex;
+        
+        // 增量快照：快照链已持久化的记录数，之后的记录写入下一个增量快照
+        // （修改需要同时持有 write_mutex_ 和 lazy_mutex）
+        size_t snapshot_count = 0;
+        
+        // 二级索引：[0, snapshot_count) 由分片的索引文件覆盖，之后的记录在此（由 lazy_mutex 保护）
+        TailIndex tail_index;
+        
+        // 库存检查点，按位置升序（由 lazy_mutex 保护）
+        std::vector<std::shared_ptr<const InventoryCheckpoint>> checkpoints;
+        
+        // 内存预算：最近一次访问的逻辑时间
+        mutable std::atomic<uint64_t> last_access{0};
+        
         ManagerData() = default;
         
         // 禁用拷贝构造和赋值（因为atomic不可拷贝）
         ManagerData(const ManagerData&) = delete;
         ManagerData& operator=(const ManagerData&) = delete;
         
-        // 支持移动构造和赋值
+        // 支持移动构造和赋值（互斥量不移动）
         ManagerData(ManagerData&& other) noexcept 
             : transactions(std::move(other.transactions))
-            , count(other.count.load()) {
+            , count(other.count.load())
+            , snapshot_blocks(std::move(other.snapshot_blocks))
+            , hot_base(other.hot_base)
+            , archive_blocks(std::move(other.archive_blocks))
+            , archived_count(other.archived_count.load())
+            , snapshot_count(other.snapshot_count)
+            , tail_index(std::move(other.tail_index))
+            , checkpoints(std::move(other.checkpoints))
+            , last_access(other.last_access.load()) {
         }
         
         ManagerData& operator=(ManagerData&& other) noexcept {
             if (this != &other) {
                 transactions = std::move(other.transactions);
                 count.store(other.count.load());
+                snapshot_blocks = std::move(other.snapshot_blocks);
+                hot_base = other.hot_base;
+                archive_blocks = std::move(other.archive_blocks);
+                archived_count.store(other.archived_count.load());
+                snapshot_count = other.snapshot_count;
+                tail_index = std::move(other.tail_index);
+                checkpoints = std::move(other.checkpoints);
+                last_access.store(other.last_access.load());
             }
             return *this;
         }
@@ -151,10 +251,70 @@ private:
     
     std::unordered_map<std::string, ManagerData> managers_;
     
+    // 保护 managers_ 的查找与插入：插入只在持有 write_mutex_ 时进行（持有 write_mutex_ 时可直接遍历），
+    // 库管员不会被删除，元素地址在插入后不变，查到后可在锁外使用
+    mutable std::shared_mutex managers_mutex_;
+    
     // 持久化管理器
     std::unique_ptr<PersistenceManager> persistence_;
     bool persistence_enabled_;
     
+    // 串行化写入和快照（读取不加此锁）
+    std::mutex write_mutex_;
+    
+    // 串行化快照创建，保证增量快照按顺序衔接
+    std::mutex snapshot_mutex_;
+    
+    // 追加监听（由 write_mutex_ 保护）
+    std::vector<AppendListener> append_listeners_;
+    
+    // 库存检查点配置
+    size_t checkpoint_interval_;    // 两个检查点之间的记录数
+    size_t checkpoint_retention_;   // 每个库管员保留的检查点数
+    
+    // 内存预算
+    std::atomic<size_t> memory_budget_kb_;
+    mutable std::atomic<uint64_t> access_clock_{0};
+    
+    // 后台维护线程
+    std::atomic<int> archive_after_days_{-1};
+    std::chrono::seconds maintenance_interval_{0};
+    std::thread maintenance_thread_;
+    std::mutex maintenance_mutex_;
+    std::condition_variable maintenance_cv_;
+    bool maintenance_running_ = false;    // 由 maintenance_mutex_ 保护
+    std::atomic<bool> checkpoint_requested_{false};
+    void requestCheckpoint();
+    void maintenanceLoop();
+    
+    const ManagerData* findManager(const std::string& manager_id) const;
+    ManagerData& getOrCreateManager(const std::string& manager_id);   // 调用方持有 write_mutex_
+    
+    // 延迟加载与冷数据分层
+    size_t attachSnapshot(const PersistenceManager::SnapshotPart& part, bool archive);
+    void attachChainParts(const std::vector<PersistenceManager::SnapshotPart>& parts, bool full);  // 调用方持有 write_mutex_
+    std::vector<TransactionRecord> collectTransactions(const ManagerData& data, size_t from = 0,
+                                                       size_t limit = std::numeric_limits<size_t>::max()) const;
+    // 按序列位置 [from, to) 追加记录，调用方持有 lazy_mutex（按需映射分片）
+    bool collectRange(const ManagerData& data, size_t from, size_t to, std::vector<TransactionRecord>& out) const;
+    const ColumnarSnapshot::BlockInfo* mapBlock(const SnapshotBlockRef& ref) const;
+    void trimColdPrefix(ManagerData& data, const PersistenceManager::SnapshotPart& archive_part);
+    void touch(const ManagerData& data) const { data.last_access.store(++access_clock_, std::memory_order_relaxed); }
+    
+    // 二级索引，调用方持有 lazy_mutex
+    const SnapshotIndex* mapIndex(const SnapshotBlockRef& ref) const;
+    static void indexTail(ManagerData& data, size_t position, const TransactionRecord& trans);
+    static void pruneTailIndex(ManagerData& data);    // 丢弃已进入快照链的位置
+    // 查找序列位置不小于 from 且字段等于 key 的记录，first_only 时找到一条即返回；解码失败时返回 false
+    bool lookupIndexed(const ManagerData& data, SnapshotIndex::Field field, const std::string& key,
+                       size_t from, bool first_only, std::vector<TransactionRecord>& out) const;
+    std::vector<TransactionRecord> findIndexed(const std::string& manager_id, SnapshotIndex::Field field,
+                                               const std::string& key) const;
+    
+    // 内存预算：释放空闲库管员的内存，调用方持有 snapshot_mutex_
+    void enforceMemoryBudget();
+    size_t evictManager(ManagerData& data);   // 调用方持有 write_mutex_，返回释放的估算字节数
+    
     // 内部辅助方法
     std::vector<TransactionRecord> getEmptyTransactionList() const;
     bool isValidTimeFormat(const std::string& timestamp) const;
@@ -162,6 +322,14 @@ private:
                       const std::string& start_time, 
                       const std::string& end_time) const;
     
+    // 库存检查点
+    void loadInventoryCheckpoints();
+    void updateInventoryCheckpoints();
+    InventoryBalanceMap replayInventory(const std::string& manager_id, const std::string* as_of) const;
+    static void applyToInventory(InventoryBalanceMap& inventory, const TransactionRecord& trans);
+    static std::map<std::string, std::vector<InventoryRecord>> groupInventoryByWarehouse(
+        const InventoryBalanceMap& inventory);
+    
     // 计算辅助方法
     std::map<std::string, ItemSummary> buildItemSummaryMap(
         const std::vector<TransactionRecord>& transactions) const;
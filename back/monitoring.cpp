@@ -7,6 +7,7 @@
 #include <ctime>
 #include <iomanip>
 #include <limits>
+#include <algorithm>
 
 // ========== MonitoringManager 实现 ==========
 
@@ -1,9 +1,16 @@
 #include "persistence.h"
+#include "columnar_snapshot.h"
+#include "monitoring.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <chrono>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <iterator>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -12,12 +19,39 @@ PersistenceManager::PersistenceManager(const std::string& data_dir)
     : data_dir_(data_dir)
     , snapshot_interval_(3600)  // 默认1小时
     , wal_size_limit_(100 * 1024 * 1024)  // 默认100MB
+    , snapshot_compression_(true)
+    , snapshot_retention_(2)
+    , wal_segment_seq_(0)
+    , consolidation_interval_(8)
+    , snapshot_threads_(std::max(1u, std::min(8u, std::thread::hardware_concurrency())))
+    , has_chain_(false)
+    , chain_segment_(0)
+    , deltas_since_full_(0)
+    , archive_seq_(0)
     , lock_fd_(-1) {
     
     if (!initializeDataDirectory()) {
         throw std::runtime_error("Failed to initialize data directory: " + data_dir_);
     }
     
+    // 继续已有的WAL段编号
+    for (const auto& wal_file : getWALFiles()) {
+        wal_segment_seq_ = std::max(wal_segment_seq_, parseWALSegment(wal_file));
+    }
+    
+    // 继续已有的归档段编号
+    for (const auto& archive_dir : getArchiveDirs()) {
+        archive_seq_ = std::max(archive_seq_, parseSegment(archive_dir, "archive_"));
+    }
+    
+    // 清理上次中断的快照留下的临时目录
+    for (const auto& entry : std::filesystem::directory_iterator(data_dir_)) {
+        if (entry.is_directory() && entry.path().filename().string().ends_with(".tmp")) {
+            std::error_code ec;
+            std::filesystem::remove_all(entry.path(), ec);
+        }
+    }
+    
     wal_file_path_ = data_dir_ + "/current.wal";
     wal_stream_ = std::make_unique<std::ofstream>(wal_file_path_, std::ios::app);
     
@@ -75,6 +109,49 @@ bool PersistenceManager::flushWAL() {
     return false;
 }
 
+uint64_t PersistenceManager::sealWAL() {
+    if (!rotateWALFile()) {
+        logError("sealWAL", "WAL rotation failed, snapshot will cover current segment only up to last seal");
+    }
+    return wal_segment_seq_;
+}
+
+bool PersistenceManager::rotateWALFile() {
+    if (wal_stream_ && wal_stream_->is_open()) {
+        wal_stream_->flush();
+    }
+    
+    std::error_code ec;
+    auto size = std::filesystem::file_size(wal_file_path_, ec);
+    if (ec) {
+        logError("rotateWALFile", "Cannot stat WAL file: " + ec.message());
+        return false;
+    }
+    
+    // 空的WAL无需封存
+    if (size == 0) {
+        return true;
+    }
+    
+    wal_stream_->close();
+    
+    std::string sealed_file = generateWALFilename(wal_segment_seq_ + 1);
+    bool renamed = std::rename(wal_file_path_.c_str(), sealed_file.c_str()) == 0;
+    if (renamed) {
+        wal_segment_seq_++;
+    } else {
+        logError("rotateWALFile", "Failed to seal WAL segment: " + sealed_file);
+    }
+    
+    wal_stream_ = std::make_unique<std::ofstream>(wal_file_path_, std::ios::app);
+    if (!wal_stream_->is_open()) {
+        logError("rotateWALFile", "Failed to reopen WAL file: " + wal_file_path_);
+        return false;
+    }
+    
+    return renamed;
+}
+
 // ========== 序列化方法 ==========
 
 std::string PersistenceManager::serializeTransaction(const std::string& manager_id, const TransactionRecord& trans) const {
@@ -102,13 +179,18 @@ std::string PersistenceManager::serializeTransaction(const std::string& manager_
 }
 
 bool PersistenceManager::deserializeTransaction(const std::string& line, std::string& manager_id, TransactionRecord& trans) const {
-    std::istringstream iss(line);
-    std::string token;
     std::vector<std::string> fields;
     
-    // 按"|"分割字段
-    while (std::getline(iss, token, '|')) {
-        fields.push_back(token);
+    // 按"|"分割字段（保留末尾的空字段，如空备注）
+    size_t start = 0;
+    while (true) {
+        size_t pos = line.find('|', start);
+        if (pos == std::string::npos) {
+            fields.push_back(line.substr(start));
+            break;
+        }
+        fields.push_back(line.substr(start, pos - start));
+        start = pos + 1;
     }
     
     if (fields.size() != 16) {  // 期望16个字段
@@ -143,37 +225,129 @@ bool PersistenceManager::deserializeTransaction(const std::string& line, std::st
 
 // ========== 数据恢复 ==========
 
-std::unordered_map<std::string, std::vector<TransactionRecord>> PersistenceManager::recoverFromWAL() {
-    std::unordered_map<std::string, std::vector<TransactionRecord>> data;
+PersistenceManager::ReplayStats PersistenceManager::replayWAL(uint64_t after_segment, const RecordSink& sink) {
+    ReplayStats stats;
     
-    // 获取所有WAL文件，按时间排序
+    // 获取所有WAL文件，按段序号排序
     auto wal_files = getWALFiles();
     
     for (const auto& wal_file : wal_files) {
+        uint64_t segment = parseWALSegment(wal_file);
+        if (segment != 0 && segment <= after_segment) {
+            continue;  // 已包含在快照中
+        }
+        
         std::ifstream file(data_dir_ + "/" + wal_file);
         if (!file.is_open()) {
-            logError("recoverFromWAL", "Cannot open WAL file: " + wal_file);
+            logError("replayWAL", "Cannot open WAL file: " + wal_file);
             continue;
         }
         
         std::string line;
+        std::string manager_id;
+        size_t line_no = 0;
+        std::streamoff offset = 0;
+        std::vector<std::streamoff> quarantined;
         while (std::getline(file, line)) {
-            if (line.empty()) continue;
+            line_no++;
+            std::streamoff line_offset = offset;
+            offset += static_cast<std::streamoff>(line.size()) + 1;
+            
+            // '#' 开头的行已在之前的回放中隔离过
+            if (line.empty() || line[0] == '#') continue;
             
-            std::string manager_id;
             TransactionRecord trans;
+            std::string source = wal_file + ":" + std::to_string(line_no);
+            std::string reason;
             
-            if (deserializeTransaction(line, manager_id, trans)) {
-                data[manager_id].push_back(trans);
+            // 时间戳是WAL写入时的系统时间，时钟回拨后可能倒序，不能作为隔离依据
+            if (!deserializeTransaction(line, manager_id, trans)) {
+                reason = "unparseable line";
             } else {
-                logError("recoverFromWAL", "Failed to parse line: " + line);
+                validateTransaction(trans, reason);
+            }
+            
+            if (!reason.empty()) {
+                quarantineWALLine(source, reason, line);
+                quarantined.push_back(line_offset);
+                stats.quarantined++;
+                continue;
             }
+            
+            sink(manager_id, std::move(trans));
+            stats.replayed++;
+        }
+        
+        if (!quarantined.empty()) {
+            // 最后一行没有换行符（写入中断）时 offset 比文件长度多1
+            std::error_code ec;
+            auto size = std::filesystem::file_size(data_dir_ + "/" + wal_file, ec);
+            bool unterminated = !ec && static_cast<std::streamoff>(size) < offset;
+            file.close();
+            markQuarantinedLines(wal_file, quarantined, unterminated);
         }
     }
     
+    return stats;
+}
+
+std::unordered_map<std::string, std::vector<TransactionRecord>> PersistenceManager::recoverFromWAL(uint64_t after_segment) {
+    std::unordered_map<std::string, std::vector<TransactionRecord>> data;
+    replayWAL(after_segment, [&data](const std::string& manager_id, TransactionRecord&& trans) {
+        data[manager_id].push_back(std::move(trans));
+    });
     return data;
 }
 
+bool PersistenceManager::validateTransaction(const TransactionRecord& trans, std::string& reason) {
+    // 检查必填字段
+    if (trans.trans_id.empty() || trans.item_id.empty() ||
+        (trans.type != "in" && trans.type != "out") ||
+        trans.quantity <= 0) {
+        reason = "invalid transaction data";
+        return false;
+    }
+    return true;
+}
+
+void PersistenceManager::quarantineWALLine(const std::string& source, const std::string& reason, const std::string& line) {
+    logError("replayWAL", "Quarantined WAL record at " + source + " (" + reason + ")");
+    
+    // 隔离文件保留原始行，前面加一行注释说明来源和原因，便于人工核对后重新导入
+    std::ofstream out(data_dir_ + "/wal_quarantine.log", std::ios::app);
+    if (!out.is_open()) {
+        logError("replayWAL", "Cannot open WAL quarantine file");
+        return;
+    }
+    out << "# " << source << " " << reason << "\n" << line << "\n";
+}
+
+void PersistenceManager::markQuarantinedLines(const std::string& wal_file, const std::vector<std::streamoff>& offsets,
+                                              bool unterminated) {
+    // 原地改写首字节，不改变文件长度，current.wal 的追加写入不受影响
+    std::fstream file(data_dir_ + "/" + wal_file, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        logError("replayWAL", "Cannot mark quarantined records in WAL file: " + wal_file);
+        return;
+    }
+    
+    for (std::streamoff offset : offsets) {
+        file.seekp(offset);
+        file.put('#');
+    }
+    
+    // 中断的最后一行补上换行，之后追加的记录不会接在已标记的行后面
+    if (unterminated) {
+        file.seekp(0, std::ios::end);
+        file.put('\n');
+    }
+    
+    file.flush();
+    if (!file) {
+        logError("replayWAL", "Failed to mark quarantined records in WAL file: " + wal_file);
+    }
+}
+
 bool PersistenceManager::validateDataIntegrity(const std::unordered_map<std::string, std::vector<TransactionRecord>>& data) {
     for (const auto& manager_pair : data) {
         const auto& transactions = manager_pair.second;
@@ -187,10 +361,9 @@ bool PersistenceManager::validateDataIntegrity(const std::unordered_map<std::str
         }
         
         // 检查必填字段
+        std::string reason;
         for (const auto& trans : transactions) {
-            if (trans.trans_id.empty() || trans.item_id.empty() || 
-                (trans.type != "in" && trans.type != "out") ||
-                trans.quantity <= 0) {
+            if (!validateTransaction(trans, reason)) {
                 logError("validateDataIntegrity", "Invalid transaction data: " + trans.trans_id);
                 return false;
             }
@@ -202,80 +375,675 @@ bool PersistenceManager::validateDataIntegrity(const std::unordered_map<std::str
 
 // ========== 快照管理 ==========
 
-bool PersistenceManager::createSnapshot(const std::unordered_map<std::string, std::vector<TransactionRecord>>& data) {
-    std::string snapshot_file = generateSnapshotFilename();
-    std::string temp_file = snapshot_file + ".tmp";
+namespace {
+
+// 在 threads 个线程上并行执行 fn(0..count)，任务按下标动态领取
+void parallelFor(size_t count, size_t threads, const std::function<void(size_t)>& fn) {
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
     
-    std::ofstream file(temp_file);
-    if (!file.is_open()) {
-        logError("createSnapshot", "Cannot create snapshot file: " + temp_file);
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            fn(i);
+        }
+    };
+    
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+const char* const kManifestFile = "MANIFEST";
+const char* const kManifestMagic = "WMSNAP";
+
+// 分片的索引文件与分片同名，扩展名为 .idx
+std::string indexPathFor(const std::string& part_path) {
+    return part_path.substr(0, part_path.rfind('.')) + ".idx";
+}
+
+}  // namespace
+
+bool PersistenceManager::createSnapshot(const std::unordered_map<std::string, RecordRange>& data,
+                                        uint64_t wal_segment, std::vector<SnapshotPart>& parts) {
+    auto start_time = std::chrono::steady_clock::now();
+    
+    bool success = writeSnapshot(generateSnapshotPath("snapshot_", wal_segment), toBlockSources(data),
+                                 KIND_FULL, wal_segment, 0, snapshot_compression_, parts);
+    
+    if (success) {
+        last_snapshot_time_ = getCurrentTimestamp();
+        has_chain_ = true;
+        chain_segment_ = wal_segment;
+        deltas_since_full_ = 0;
+        applySnapshotRetention();
+    }
+    
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    MONITOR().recordSnapshotOperation("create", success, duration.count() / 1000.0);
+    
+    return success;
+}
+
+bool PersistenceManager::createDeltaSnapshot(const std::unordered_map<std::string, RecordRange>& deltas,
+                                             uint64_t wal_segment, std::vector<SnapshotPart>& parts) {
+    if (!has_chain_) {
+        logError("createDeltaSnapshot", "No base snapshot to chain the delta to");
         return false;
     }
     
-    try {
-        // 写入快照头部信息
-        file << "# Snapshot created at: " << getCurrentTimestamp() << std::endl;
-        file << "# Format: JSON lines, one manager per line" << std::endl;
+    // 增量必须覆盖新的WAL段，否则加载时无法与快照链末尾区分
+    if (wal_segment <= chain_segment_) {
+        logError("createDeltaSnapshot", "WAL was not sealed past segment " + std::to_string(chain_segment_));
+        return false;
+    }
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    bool success = writeSnapshot(generateSnapshotPath("delta_", wal_segment), toBlockSources(deltas),
+                                 KIND_DELTA, wal_segment, chain_segment_, snapshot_compression_, parts);
+    
+    if (success) {
+        last_snapshot_time_ = getCurrentTimestamp();
+        chain_segment_ = wal_segment;
+        deltas_since_full_++;
+    }
+    
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    MONITOR().recordSnapshotOperation("create_delta", success, duration.count() / 1000.0);
+    
+    return success;
+}
+
+bool PersistenceManager::needsFullSnapshot() const {
+    return !has_chain_ || deltas_since_full_ >= consolidation_interval_;
+}
+
+std::unordered_map<std::string, std::vector<TransactionRecord>> PersistenceManager::recoverFromSnapshot() {
+    std::unordered_map<std::string, std::vector<TransactionRecord>> data;
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    auto archives = openArchives();
+    auto chain = openSnapshotChain();
+    if (chain.empty() && archives.empty()) {
+        return data;  // 无快照文件
+    }
+    
+    // 同一库管员的分片按归档、快照链的顺序串行映射和解码，不同库管员之间并行
+    std::vector<SnapshotPart> all_parts(archives);
+    all_parts.insert(all_parts.end(), chain.parts.begin(), chain.parts.end());
+    
+    std::vector<std::string> manager_ids;
+    std::unordered_map<std::string, std::vector<const SnapshotPart*>> manager_parts;
+    for (const auto& part : all_parts) {
+        auto& parts = manager_parts[part.manager_id];
+        if (parts.empty()) {
+            manager_ids.push_back(part.manager_id);
+        }
+        parts.push_back(&part);
+    }
+    
+    std::vector<std::vector<TransactionRecord>> decoded(manager_ids.size());
+    std::atomic<bool> success{true};
+    parallelFor(manager_ids.size(), snapshot_threads_, [&](size_t i) {
+        auto& transactions = decoded[i];
+        for (const auto* part : manager_parts[manager_ids[i]]) {
+            // 快照中已被归档覆盖的前缀跳过
+            auto mapped = openSnapshotPart(*part);
+            if (!mapped || part->base_count > transactions.size() ||
+                !ColumnarSnapshot::decodeBlockFrom(mapped->getBlocks().front(), transactions.size(), transactions)) {
+                logError("recoverFromSnapshot", "Checksum or decode failure for manager: " + manager_ids[i]);
+                success = false;
+                return;
+            }
+        }
+    });
+    
+    if (success) {
+        for (size_t i = 0; i < manager_ids.size(); ++i) {
+            data[manager_ids[i]] = std::move(decoded[i]);
+        }
+    }
+    
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    MONITOR().recordSnapshotOperation("load", success, duration.count() / 1000.0);
+    
+    return data;
+}
+
+PersistenceManager::SnapshotChain PersistenceManager::openSnapshotChain() {
+    SnapshotChain chain;
+    auto snapshot_dirs = getSnapshotFiles();
+    
+    // 最新全量快照损坏时回退到较旧的快照（其后的WAL段仍被保留）
+    // 全量快照很大，启动时只读清单：分片的块头和列数据在首次访问该库管员时才映射和校验
+    SnapshotManifest manifest;
+    for (auto it = snapshot_dirs.rbegin(); it != snapshot_dirs.rend() && chain.empty(); ++it) {
+        std::string path = data_dir_ + "/" + *it;
+        if (!readManifest(path, manifest) || manifest.kind != KIND_FULL) {
+            MONITOR().recordSnapshotOperation("load", false, 0.0);
+            continue;
+        }
         
-        // 为每个库管员写入JSON格式的数据
-        for (const auto& manager_pair : data) {
-            file << "{\"manager_id\":\"" << manager_pair.first << "\",\"transactions\":[";
-            
-            const auto& transactions = manager_pair.second;
-            for (size_t i = 0; i < transactions.size(); ++i) {
-                if (i > 0) file << ",";
-                file << transactionToJSON(transactions[i]);
+        auto parts = toSnapshotParts(path, manifest);
+        bool complete = true;
+        for (const auto& part : parts) {
+            std::error_code ec;
+            if (!std::filesystem::is_regular_file(part.path, ec)) {
+                logError("openSnapshotChain", "Missing snapshot part: " + part.path);
+                complete = false;
+                break;
             }
-            
-            file << "]}" << std::endl;
+        }
+        if (!complete) {
+            MONITOR().recordSnapshotOperation("load", false, 0.0);
+            continue;
         }
         
-        file.flush();
-        file.close();
+        chain.parts = std::move(parts);
+        chain.wal_segment = manifest.wal_segment;
+        chain.generations = 1;
+    }
+    
+    if (chain.empty()) {
+        return chain;
+    }
+    
+    // 依次衔接基于链末尾的增量快照；损坏的增量被跳过，链在此中断，其后的记录由WAL回放补齐
+    // （之后基于同一链末尾重新写出的增量仍可衔接）
+    for (const auto& delta_dir : getDeltaFiles()) {
+        if (parseSegment(delta_dir, "delta_") <= chain.wal_segment) {
+            continue;
+        }
         
-        // 原子性重命名
-        if (std::rename(temp_file.c_str(), snapshot_file.c_str()) != 0) {
-            logError("createSnapshot", "Failed to rename temp file to snapshot");
-            return false;
+        std::string path = data_dir_ + "/" + delta_dir;
+        if (!readManifest(path, manifest)) {
+            MONITOR().recordSnapshotOperation("load", false, 0.0);
+            continue;
+        }
+        if (manifest.kind != KIND_DELTA || manifest.base_segment != chain.wal_segment) {
+            continue;  // 属于另一条快照链
         }
         
-        last_snapshot_time_ = getCurrentTimestamp();
-        return true;
+        // 增量快照很小，加载时即完整校验：损坏的增量无法在解码时再回退到WAL
+        // 校验后释放映射，之后与全量快照的分片一样按需映射
+        std::vector<std::shared_ptr<MappedSnapshot>> mapped;
+        if (!openSnapshotParts(path, true, manifest, mapped)) {
+            MONITOR().recordSnapshotOperation("load", false, 0.0);
+            continue;
+        }
         
-    } catch (const std::exception& e) {
-        logError("createSnapshot", e.what());
-        std::remove(temp_file.c_str());
-        return false;
+        auto parts = toSnapshotParts(path, manifest);
+        chain.parts.insert(chain.parts.end(), parts.begin(), parts.end());
+        chain.wal_segment = manifest.wal_segment;
+        chain.generations++;
     }
+    
+    // 新的增量快照接在已加载的链末尾
+    has_chain_ = true;
+    chain_segment_ = chain.wal_segment;
+    deltas_since_full_ = static_cast<int>(chain.generations) - 1;
+    
+    return chain;
 }
 
-std::unordered_map<std::string, std::vector<TransactionRecord>> PersistenceManager::recoverFromSnapshot() {
-    std::unordered_map<std::string, std::vector<TransactionRecord>> data;
+bool PersistenceManager::cleanupOldWAL(uint64_t up_to_segment) {
+    bool success = true;
+    for (const auto& wal_file : getWALFiles()) {
+        uint64_t segment = parseWALSegment(wal_file);
+        if (segment != 0 && segment <= up_to_segment) {
+            if (std::remove((data_dir_ + "/" + wal_file).c_str()) != 0) {
+                logError("cleanupOldWAL", "Failed to remove WAL segment: " + wal_file);
+                success = false;
+            }
+        }
+    }
+    return success;
+}
+
+void PersistenceManager::applySnapshotRetention() {
+    auto snapshot_dirs = getSnapshotFiles();
+    if (snapshot_dirs.size() < static_cast<size_t>(snapshot_retention_)) {
+        return;
+    }
     
-    auto snapshot_files = getSnapshotFiles();
-    if (snapshot_files.empty()) {
-        return data;  // 无快照文件
+    // 删除超出保留数量的旧快照
+    std::error_code ec;
+    size_t first_kept = snapshot_dirs.size() - snapshot_retention_;
+    for (size_t i = 0; i < first_kept; ++i) {
+        std::filesystem::remove_all(data_dir_ + "/" + snapshot_dirs[i], ec);
     }
     
-    // 使用最新的快照文件
-    std::string latest_snapshot = data_dir_ + "/" + snapshot_files.back();
-    std::ifstream file(latest_snapshot);
+    // 只删除最旧的保留快照已经包含的增量快照和WAL段，这样任何一个保留的快照链都能独立恢复
+    uint64_t oldest_kept = parseSegment(snapshot_dirs[first_kept], "snapshot_");
+    for (const auto& delta_dir : getDeltaFiles()) {
+        if (parseSegment(delta_dir, "delta_") <= oldest_kept) {
+            std::filesystem::remove_all(data_dir_ + "/" + delta_dir, ec);
+        }
+    }
+    cleanupOldWAL(oldest_kept);
+}
+
+bool PersistenceManager::writeSnapshot(const std::string& path, const std::vector<BlockSource>& blocks,
+                                       SnapshotKind kind, uint64_t wal_segment, uint64_t base_segment,
+                                       bool compress, std::vector<SnapshotPart>& parts) {
+    // 先写入临时目录，全部分片和清单写完后整体重命名
+    std::string temp_dir = path + ".tmp";
+    std::error_code ec;
+    std::filesystem::remove_all(temp_dir, ec);
+    if (!std::filesystem::create_directory(temp_dir, ec)) {
+        logError("createSnapshot", "Cannot create snapshot directory: " + temp_dir);
+        return false;
+    }
+    
+    std::string created_at = getCurrentTimestamp();
+    
+    bool delta = kind == KIND_DELTA;
+    
+    SnapshotManifest manifest;
+    manifest.kind = kind;
+    manifest.wal_segment = wal_segment;
+    manifest.base_segment = base_segment;
+    manifest.created_at = created_at;
+    manifest.parts.resize(blocks.size());
+    
+    // 大的库管员先开始，避免最后只剩一个线程在写大文件
+    std::vector<size_t> order(blocks.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&blocks](size_t a, size_t b) {
+        return blocks[a].count > blocks[b].count;
+    });
+    
+    std::atomic<bool> success{true};
+    parallelFor(order.size(), snapshot_threads_, [&](size_t n) {
+        size_t i = order[n];
+        const BlockSource& source = blocks[i];
+        
+        auto& part = manifest.parts[i];
+        std::ostringstream name;
+        name << "part_" << std::setfill('0') << std::setw(6) << i << ".snap";
+        part.file = name.str();
+        part.manager_id = *source.manager_id;
+        part.base_count = source.base_count;
+        part.record_count = source.count;
+        
+        try {
+            auto header = ColumnarSnapshot::encodeFileHeader(1, wal_segment, created_at,
+                                                             compress, delta, base_segment);
+            auto block = ColumnarSnapshot::encodeBlock(*source.manager_id, source.base_count,
+                                                       source.records, source.count,
+                                                       compress);
+            
+            std::ofstream file(temp_dir + "/" + part.file, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(header.data()), header.size());
+            file.write(reinterpret_cast<const char*>(block.data()), block.size());
+            file.flush();
+            if (!file.good()) {
+                logError("createSnapshot", "Write failed: " + temp_dir + "/" + part.file);
+                success = false;
+            }
+            
+            // 二级索引与分片一起写入，重启后直接映射使用
+            auto index = SnapshotIndex::encode(wal_segment, source.base_count, source.records, source.count);
+            std::string index_path = indexPathFor(temp_dir + "/" + part.file);
+            std::ofstream index_file(index_path, std::ios::binary | std::ios::trunc);
+            index_file.write(reinterpret_cast<const char*>(index.data()), index.size());
+            index_file.flush();
+            if (!index_file.good()) {
+                logError("createSnapshot", "Write failed: " + index_path);
+                success = false;
+            }
+        } catch (const std::exception& e) {
+            logError("createSnapshot", e.what());
+            success = false;
+        }
+    });
     
+    if (success && !writeManifest(temp_dir, manifest)) {
+        success = false;
+    }
+    
+    // 原子性重命名
+    if (success) {
+        std::filesystem::rename(temp_dir, path, ec);
+        if (ec) {
+            logError("createSnapshot", "Failed to rename temp directory to snapshot: " + ec.message());
+            success = false;
+        }
+    }
+    
+    if (success) {
+        parts = toSnapshotParts(path, manifest);
+    } else {
+        std::filesystem::remove_all(temp_dir, ec);
+    }
+    return success;
+}
+
+bool PersistenceManager::writeManifest(const std::string& dir, const SnapshotManifest& manifest) const {
+    // 文本清单：头部若干行，之后每个分片一行（manager_id 在最后，可包含空格）
+    std::ostringstream oss;
+    oss << kManifestMagic << " " << static_cast<int>(ColumnarSnapshot::FORMAT_VERSION) << "\n"
+        << "type " << (manifest.kind == KIND_DELTA ? "delta" : manifest.kind == KIND_ARCHIVE ? "archive" : "full") << "\n"
+        << "wal_segment " << manifest.wal_segment << "\n"
+        << "base_segment " << manifest.base_segment << "\n"
+        << "created_at " << manifest.created_at << "\n"
+        << "parts " << manifest.parts.size() << "\n";
+    for (const auto& part : manifest.parts) {
+        oss << part.file << " " << part.base_count << " " << part.record_count << " " << part.manager_id << "\n";
+    }
+    
+    std::string body = oss.str();
+    uint32_t checksum = ColumnarSnapshot::crc32(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+    
+    std::ofstream file(dir + "/" + kManifestFile, std::ios::trunc);
+    file << body << "crc32 " << checksum << "\n";
+    file.flush();
+    if (!file.good()) {
+        logError("createSnapshot", "Failed to write manifest in " + dir);
+        return false;
+    }
+    return true;
+}
+
+bool PersistenceManager::readManifest(const std::string& dir, SnapshotManifest& manifest) const {
+    std::ifstream file(dir + "/" + kManifestFile);
     if (!file.is_open()) {
-        logError("recoverFromSnapshot", "Cannot open snapshot file: " + latest_snapshot);
-        return data;
+        logError("readManifest", "Missing manifest in " + dir);
+        return false;
     }
     
-    std::string line;
+    std::string body, line, crc_line;
     while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#') continue;  // 跳过注释
+        if (line.starts_with("crc32 ")) {
+            crc_line = line;
+            break;
+        }
+        body += line + "\n";
+    }
+    
+    uint32_t checksum = ColumnarSnapshot::crc32(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+    if (crc_line != "crc32 " + std::to_string(checksum)) {
+        logError("readManifest", "Manifest checksum mismatch in " + dir);
+        return false;
+    }
+    
+    std::istringstream iss(body);
+    std::string magic, key, type;
+    int version = 0;
+    size_t part_count = 0;
+    iss >> magic >> version
+        >> key >> type
+        >> key >> manifest.wal_segment
+        >> key >> manifest.base_segment
+        >> key >> manifest.created_at
+        >> key >> part_count;
+    if (!iss || magic != kManifestMagic || version != ColumnarSnapshot::FORMAT_VERSION) {
+        logError("readManifest", "Invalid manifest header in " + dir);
+        return false;
+    }
+    if (type == "full") {
+        manifest.kind = KIND_FULL;
+    } else if (type == "delta") {
+        manifest.kind = KIND_DELTA;
+    } else if (type == "archive") {
+        manifest.kind = KIND_ARCHIVE;
+    } else {
+        logError("readManifest", "Unknown snapshot type in " + dir + ": " + type);
+        return false;
+    }
+    
+    manifest.parts.clear();
+    std::getline(iss, line);
+    while (std::getline(iss, line)) {
+        SnapshotManifest::Part part;
+        std::istringstream part_stream(line);
+        part_stream >> part.file >> part.base_count >> part.record_count;
+        part_stream.get();
+        std::getline(part_stream, part.manager_id);
+        if (part.file.empty() || part.manager_id.empty()) {
+            logError("readManifest", "Invalid part entry in " + dir + ": " + line);
+            return false;
+        }
+        manifest.parts.push_back(part);
+    }
+    
+    if (manifest.parts.size() != part_count) {
+        logError("readManifest", "Part count mismatch in " + dir);
+        return false;
+    }
+    return true;
+}
+
+bool PersistenceManager::openSnapshotParts(const std::string& dir, bool verify, SnapshotManifest& manifest,
+                                           std::vector<std::shared_ptr<MappedSnapshot>>& parts) {
+    if (!readManifest(dir, manifest)) {
+        return false;
+    }
+    
+    // 各分片独立映射和校验，并行进行
+    parts.assign(manifest.parts.size(), nullptr);
+    std::atomic<bool> success{true};
+    parallelFor(parts.size(), snapshot_threads_, [&](size_t i) {
+        const auto& entry = manifest.parts[i];
+        std::string error;
+        auto part = MappedSnapshot::open(dir + "/" + entry.file, error);
+        
+        if (part) {
+            const auto& header = part->getHeader();
+            const auto& blocks = part->getBlocks();
+            if (header.wal_segment != manifest.wal_segment || header.isDelta() != (manifest.kind == KIND_DELTA) ||
+                blocks.size() != 1 || blocks[0].manager_id != entry.manager_id ||
+                blocks[0].base_count != entry.base_count || blocks[0].record_count != entry.record_count) {
+                error = "Part does not match manifest: " + dir + "/" + entry.file;
+            } else if (verify && !part->verify()) {
+                error = "Corrupted snapshot part: " + dir + "/" + entry.file;
+            } else {
+                parts[i] = part;
+                return;
+            }
+        }
         
-        // 解析JSON行（简化版本，生产环境建议使用JSON库）
-        // 这里省略具体的JSON解析实现...
-        // 在实际项目中，建议使用nlohmann/json等库
+        logError("openSnapshotChain", error);
+        success = false;
+    });
+    
+    return success;
+}
+
+std::shared_ptr<MappedSnapshot> PersistenceManager::openSnapshotPart(const SnapshotPart& part) const {
+    std::string error;
+    auto mapped = MappedSnapshot::open(part.path, error);
+    if (mapped) {
+        const auto& blocks = mapped->getBlocks();
+        if (blocks.size() == 1 && blocks[0].manager_id == part.manager_id &&
+            blocks[0].base_count == part.base_count && blocks[0].record_count == part.record_count) {
+            return mapped;
+        }
+        error = "Part does not match manifest: " + part.path;
     }
     
-    return data;
+    logError("openSnapshotPart", error);
+    return nullptr;
+}
+
+std::shared_ptr<SnapshotIndex> PersistenceManager::openSnapshotIndex(const SnapshotPart& part) const {
+    // 旧版本写出的快照没有索引文件，属于正常情况；文件存在但无效时才报告错误
+    std::string path = indexPathFor(part.path);
+    std::string error;
+    std::error_code ec;
+    auto index = SnapshotIndex::open(path, part.wal_segment, part.base_count, part.record_count, error);
+    if (!index && std::filesystem::exists(path, ec)) {
+        logError("openSnapshotIndex", error);
+    }
+    return index;
+}
+
+std::vector<PersistenceManager::SnapshotPart> PersistenceManager::toSnapshotParts(
+    const std::string& dir, const SnapshotManifest& manifest) {
+    std::vector<SnapshotPart> parts(manifest.parts.size());
+    for (size_t i = 0; i < parts.size(); ++i) {
+        parts[i].path = dir + "/" + manifest.parts[i].file;
+        parts[i].manager_id = manifest.parts[i].manager_id;
+        parts[i].base_count = manifest.parts[i].base_count;
+        parts[i].record_count = manifest.parts[i].record_count;
+        parts[i].wal_segment = manifest.wal_segment;
+    }
+    return parts;
+}
+
+std::vector<PersistenceManager::BlockSource> PersistenceManager::toBlockSources(
+    const std::unordered_map<std::string, RecordRange>& ranges) {
+    std::vector<BlockSource> blocks;
+    blocks.reserve(ranges.size());
+    for (const auto& range_pair : ranges) {
+        if (range_pair.second.records.empty() && range_pair.second.base_count > 0) {
+            continue;  // 没有新记录的库管员（全量快照中的空库管员仍保留，用于恢复库管员列表）
+        }
+        BlockSource source;
+        source.manager_id = &range_pair.first;
+        source.base_count = range_pair.second.base_count;
+        source.records = range_pair.second.records.data();
+        source.count = range_pair.second.records.size();
+        blocks.push_back(source);
+    }
+    return blocks;
+}
+
+// ========== 库存检查点 ==========
+
+bool PersistenceManager::saveInventoryCheckpoints(
+    const std::vector<std::pair<std::string, InventoryCheckpoint>>& checkpoints) {
+    std::ofstream file(data_dir_ + "/inventory.ckpt", std::ios::binary | std::ios::app);
+    if (!file.is_open()) {
+        logError("saveInventoryCheckpoints", "Cannot open checkpoint file");
+        return false;
+    }
+    
+    for (const auto& checkpoint : checkpoints) {
+        auto record = ColumnarSnapshot::encodeCheckpoint(checkpoint.first, checkpoint.second);
+        file.write(reinterpret_cast<const char*>(record.data()), record.size());
+    }
+    
+    file.flush();
+    if (!file.good()) {
+        logError("saveInventoryCheckpoints", "Write failed");
+        return false;
+    }
+    return true;
+}
+
+bool PersistenceManager::rewriteInventoryCheckpoints(
+    const std::vector<std::pair<std::string, InventoryCheckpoint>>& checkpoints) {
+    std::string path = data_dir_ + "/inventory.ckpt";
+    std::string temp_file = path + ".tmp";
+    
+    {
+        std::ofstream file(temp_file, std::ios::binary | std::ios::trunc);
+        for (const auto& checkpoint : checkpoints) {
+            auto record = ColumnarSnapshot::encodeCheckpoint(checkpoint.first, checkpoint.second);
+            file.write(reinterpret_cast<const char*>(record.data()), record.size());
+        }
+        file.flush();
+        if (!file.good()) {
+            logError("rewriteInventoryCheckpoints", "Write failed: " + temp_file);
+            std::remove(temp_file.c_str());
+            return false;
+        }
+    }
+    
+    if (std::rename(temp_file.c_str(), path.c_str()) != 0) {
+        logError("rewriteInventoryCheckpoints", "Failed to replace checkpoint file");
+        std::remove(temp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::pair<std::string, InventoryCheckpoint>> PersistenceManager::loadInventoryCheckpoints() {
+    std::vector<std::pair<std::string, InventoryCheckpoint>> checkpoints;
+    
+    std::ifstream file(data_dir_ + "/inventory.ckpt", std::ios::binary);
+    if (!file.is_open()) {
+        return checkpoints;
+    }
+    
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t offset = 0;
+    while (offset < data.size()) {
+        std::pair<std::string, InventoryCheckpoint> checkpoint;
+        size_t used = ColumnarSnapshot::decodeCheckpoint(data.data() + offset, data.size() - offset,
+                                                         checkpoint.first, checkpoint.second);
+        if (used == 0) {
+            // 写入中断留下的不完整记录，之前的检查点仍然有效
+            logError("loadInventoryCheckpoints", "Ignoring truncated or corrupted checkpoint at offset " +
+                     std::to_string(offset));
+            break;
+        }
+        checkpoints.push_back(std::move(checkpoint));
+        offset += used;
+    }
+    
+    return checkpoints;
+}
+
+// ========== 冷数据归档 ==========
+
+bool PersistenceManager::archiveOldData(const std::unordered_map<std::string, RecordRange>& cold,
+                                        std::vector<SnapshotPart>& parts) {
+    auto start_time = std::chrono::steady_clock::now();
+    
+    uint64_t archive_seq = archive_seq_ + 1;
+    std::string path = generateSnapshotPath("archive_", archive_seq);
+    
+    // 归档段很少读取，总是压缩
+    bool success = writeSnapshot(path, toBlockSources(cold), KIND_ARCHIVE, archive_seq, 0, true, parts);
+    
+    if (success) {
+        archive_seq_ = archive_seq;
+    }
+    
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    MONITOR().recordSnapshotOperation("archive", success, duration.count() / 1000.0);
+    
+    return success;
+}
+
+std::vector<PersistenceManager::SnapshotPart> PersistenceManager::openArchives() {
+    std::vector<SnapshotPart> all_parts;
+    
+    for (const auto& archive_dir : getArchiveDirs()) {
+        std::string path = data_dir_ + "/" + archive_dir;
+        SnapshotManifest manifest;
+        if (!readManifest(path, manifest) || manifest.kind != KIND_ARCHIVE) {
+            // 归档段对应的WAL已经删除，后续归档无法衔接，只能停止
+            logError("openArchives", "Unreadable archive segment, later archives are ignored: " + archive_dir);
+            MONITOR().recordSnapshotOperation("load", false, 0.0);
+            break;
+        }
+        auto parts = toSnapshotParts(path, manifest);
+        all_parts.insert(all_parts.end(), parts.begin(), parts.end());
+    }
+    
+    return all_parts;
 }
 
 // ========== 工具方法 ==========
@@ -302,26 +1070,43 @@ std::string PersistenceManager::getCurrentTimestamp() const {
     return ss.str();
 }
 
-std::string PersistenceManager::generateSnapshotFilename() const {
+std::string PersistenceManager::generateSnapshotPath(const std::string& prefix, uint64_t sequence) const {
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
     
+    // 序号（WAL检查点或归档序号）在前，目录名排序即为新旧顺序
     std::stringstream ss;
-    ss << data_dir_ << "/snapshot_" << std::put_time(std::gmtime(&time_t), "%Y%m%d_%H%M%S") << ".json";
+    ss << data_dir_ << "/" << prefix << std::setfill('0') << std::setw(10) << sequence << "_"
+       << std::put_time(std::gmtime(&time_t), "%Y%m%d_%H%M%S");
     
     return ss.str();
 }
 
-std::string PersistenceManager::generateWALFilename() const {
+std::string PersistenceManager::generateWALFilename(uint64_t segment) const {
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
     
+    // 段序号在前，文件名排序即为写入顺序
     std::stringstream ss;
-    ss << data_dir_ << "/wal_" << std::put_time(std::gmtime(&time_t), "%Y%m%d_%H%M%S") << ".log";
+    ss << data_dir_ << "/wal_" << std::setfill('0') << std::setw(10) << segment << "_"
+       << std::put_time(std::gmtime(&time_t), "%Y%m%d_%H%M%S") << ".log";
     
     return ss.str();
 }
 
+uint64_t PersistenceManager::parseSegment(const std::string& filename, const std::string& prefix) {
+    // <prefix><segment>_<timestamp>.<ext>，不匹配（如 current.wal）返回0
+    if (!filename.starts_with(prefix)) {
+        return 0;
+    }
+    
+    uint64_t segment = 0;
+    for (size_t i = prefix.size(); i < filename.size() && filename[i] >= '0' && filename[i] <= '9'; ++i) {
+        segment = segment * 10 + (filename[i] - '0');
+    }
+    return segment;
+}
+
 bool PersistenceManager::shouldCreateSnapshot() const {
     // 检查WAL文件大小
     std::filesystem::path wal_path(wal_file_path_);
@@ -341,59 +1126,77 @@ bool PersistenceManager::shouldCreateSnapshot() const {
     return false;
 }
 
+PersistenceManager::StorageInfo PersistenceManager::getStorageInfo() const {
+    StorageInfo info;
+    info.data_dir = data_dir_;
+    info.current_wal_file = wal_file_path_;
+    info.last_snapshot_time = last_snapshot_time_;
+    
+    std::error_code ec;
+    auto wal_size = std::filesystem::file_size(wal_file_path_, ec);
+    if (!ec) {
+        info.wal_file_size = static_cast<size_t>(wal_size);
+    }
+    
+    auto snapshot_files = getSnapshotFiles();
+    if (!snapshot_files.empty()) {
+        info.latest_snapshot_file = data_dir_ + "/" + snapshot_files.back();
+    }
+    
+    return info;
+}
+
 std::vector<std::string> PersistenceManager::getWALFiles() const {
     std::vector<std::string> wal_files;
+    bool has_current = false;
     
     for (const auto& entry : std::filesystem::directory_iterator(data_dir_)) {
         if (entry.is_regular_file()) {
             std::string filename = entry.path().filename().string();
-            if (filename.ends_with(".wal") || filename.ends_with(".log")) {
+            if (filename == "current.wal") {
+                has_current = true;
+            } else if (filename.ends_with(".log") && parseWALSegment(filename) != 0) {
+                // 只收已封存的段（wal_<序号>_<时间>.log），隔离文件 wal_quarantine.log 不是WAL
                 wal_files.push_back(filename);
             }
         }
     }
     
     std::sort(wal_files.begin(), wal_files.end());
+    
+    // 当前WAL总是最新的，必须最后回放
+    if (has_current) {
+        wal_files.push_back("current.wal");
+    }
     return wal_files;
 }
 
 std::vector<std::string> PersistenceManager::getSnapshotFiles() const {
-    std::vector<std::string> snapshot_files;
+    return listSnapshotDirs("snapshot_");
+}
+
+std::vector<std::string> PersistenceManager::getDeltaFiles() const {
+    return listSnapshotDirs("delta_");
+}
+
+std::vector<std::string> PersistenceManager::getArchiveDirs() const {
+    return listSnapshotDirs("archive_");
+}
+
+std::vector<std::string> PersistenceManager::listSnapshotDirs(const std::string& prefix) const {
+    std::vector<std::string> dirs;
     
     for (const auto& entry : std::filesystem::directory_iterator(data_dir_)) {
-        if (entry.is_regular_file()) {
-            std::string filename = entry.path().filename().string();
-            if (filename.starts_with("snapshot_") && filename.ends_with(".json")) {
-                snapshot_files.push_back(filename);
+        if (entry.is_directory()) {
+            std::string name = entry.path().filename().string();
+            if (name.starts_with(prefix) && !name.ends_with(".tmp")) {
+                dirs.push_back(name);
             }
         }
     }
     
-    std::sort(snapshot_files.begin(), snapshot_files.end());
-    return snapshot_files;
-}
-
-std::string PersistenceManager::transactionToJSON(const TransactionRecord& trans) const {
-    std::ostringstream oss;
-    oss << "{"
-        << "\"trans_id\":\"" << trans.trans_id << "\","
-        << "\"item_id\":\"" << trans.item_id << "\","
-        << "\"item_name\":\"" << trans.item_name << "\","
-        << "\"type\":\"" << trans.type << "\","
-        << "\"quantity\":" << trans.quantity << ","
-        << "\"unit_price\":" << trans.unit_price << ","
-        << "\"category\":\"" << trans.category << "\","
-        << "\"model\":\"" << trans.model << "\","
-        << "\"unit\":\"" << trans.unit << "\","
-        << "\"partner_id\":\"" << trans.partner_id << "\","
-        << "\"partner_name\":\"" << trans.partner_name << "\","
-        << "\"warehouse_id\":\"" << trans.warehouse_id << "\","
-        << "\"document_no\":\"" << trans.document_no << "\","
-        << "\"timestamp\":\"" << trans.timestamp << "\","
-        << "\"note\":\"" << trans.note << "\""
-        << "}";
-    
-    return oss.str();
+    std::sort(dirs.begin(), dirs.end());
+    return dirs;
 }
 
 bool PersistenceManager::acquireFileLock() {
@@ -2,9 +2,12 @@
 #define PERSISTENCE_H
 
 #include "transaction.h"
+#include "columnar_snapshot.h"
+#include "snapshot_index.h"
 #include <string>
 #include <fstream>
 #include <memory>
+#include <functional>
 
 // 持久化管理器
 class PersistenceManager {
@@ -20,33 +23,130 @@ public:
     // 刷新WAL缓冲区到磁盘
     bool flushWAL();
     
+    // 封存当前WAL段，返回最后一个已封存段的序号
+    // 调用方需保证期间没有并发的 writeToWAL
+    uint64_t sealWAL();
+    
     // ========== 数据恢复 ==========
     
-    // 从WAL文件恢复所有数据
-    std::unordered_map<std::string, std::vector<TransactionRecord>> recoverFromWAL();
+    // 回放时每条通过校验的记录交给回调，记录可直接移走
+    using RecordSink = std::function<void(const std::string& manager_id, TransactionRecord&& trans)>;
+    
+    struct ReplayStats {
+        size_t replayed;        // 通过校验并交给回调的记录数
+        size_t quarantined;     // 无法解析或校验失败、写入隔离文件的行数
+        
+        ReplayStats() : replayed(0), quarantined(0) {}
+    };
+    
+    // 流式回放WAL（只回放序号大于 after_segment 的段和当前WAL），逐条解析和校验
+    // 坏记录追加到 wal_quarantine.log 后跳过，不影响其余记录的恢复；
+    // 隔离后WAL中该行的首字节被改写为 '#'，之后的回放直接跳过，每条坏记录只隔离一次
+    ReplayStats replayWAL(uint64_t after_segment, const RecordSink& sink);
+    
+    // 从WAL文件恢复数据（基于 replayWAL 收集到按库管员分组的表中）
+    std::unordered_map<std::string, std::vector<TransactionRecord>> recoverFromWAL(uint64_t after_segment = 0);
     
     // 验证数据完整性
     bool validateDataIntegrity(const std::unordered_map<std::string, std::vector<TransactionRecord>>& data);
     
     // ========== 快照管理 ==========
     
-    // 创建数据快照
-    bool createSnapshot(const std::unordered_map<std::string, std::vector<TransactionRecord>>& data);
+    // 某个库管员的一段连续记录，对应序列位置 [base_count, base_count + records.size())
+    struct RecordRange {
+        uint64_t base_count;
+        std::vector<TransactionRecord> records;
+        
+        RecordRange() : base_count(0) {}
+    };
+    
+    // 快照分片的位置：一个库管员在某个快照（或归档段）中的一段记录，只需读清单即可获得
+    struct SnapshotPart {
+        std::string path;
+        std::string manager_id;
+        uint64_t base_count;
+        uint64_t record_count;
+        uint64_t wal_segment;       // 所属快照的WAL段（归档段中为归档序号），用于校验索引文件
+        
+        SnapshotPart() : base_count(0), record_count(0), wal_segment(0) {}
+    };
+    
+    // 创建全量快照，wal_segment 为快照已包含的最后一个WAL段（见 sealWAL），成功时返回写入的分片
+    // 每个库管员从已归档的位置开始写入，归档段中的记录不再重复保存
+    bool createSnapshot(const std::unordered_map<std::string, RecordRange>& data, uint64_t wal_segment,
+                        std::vector<SnapshotPart>& parts);
+    
+    // 创建增量快照：只写入发生变化的库管员的新增记录，接在当前快照链末尾
+    bool createDeltaSnapshot(const std::unordered_map<std::string, RecordRange>& deltas,
+                             uint64_t wal_segment, std::vector<SnapshotPart>& parts);
+    
+    // 下一次快照强制写全量快照（如归档之后，让快照链不再包含已归档的记录）
+    void requestFullSnapshot() { deltas_since_full_ = consolidation_interval_; }
+    
+    // 是否应该写全量快照（尚无快照链，或增量快照数已达到合并阈值）
+    bool needsFullSnapshot() const;
     
-    // 从最新快照恢复
+    // 是否已有快照链（加载或创建过快照）
+    bool hasSnapshotChain() const { return has_chain_; }
+    
+    // 从归档段和最新快照链恢复（完整解码）
     std::unordered_map<std::string, std::vector<TransactionRecord>> recoverFromSnapshot();
     
-    // 清理旧的WAL文件（在快照后）
-    bool cleanupOldWAL(const std::string& before_timestamp);
+    // 快照链：每个快照是一个目录（清单 + 每个库管员一个分片文件）
+    struct SnapshotChain {
+        std::vector<SnapshotPart> parts;  // 分片按链顺序排列
+        uint64_t wal_segment;       // 链末尾快照已包含的WAL段，即WAL回放的起点
+        size_t generations;         // 链中的快照数（全量 + 增量）
+        
+        SnapshotChain() : wal_segment(0), generations(0) {}
+        
+        bool empty() const { return generations == 0; }
+    };
+    
+    // 读取最新的有效快照链（全量快照 + 依次衔接的增量快照）
+    // 全量快照只读清单并检查分片存在，增量快照完整校验；分片文件在访问时才映射
+    SnapshotChain openSnapshotChain();
+    
+    // 映射一个分片并检查与清单一致，失败时返回空指针
+    std::shared_ptr<MappedSnapshot> openSnapshotPart(const SnapshotPart& part) const;
+    
+    // 映射分片的二级索引（与分片同名的 .idx 文件），缺失或与分片不一致时返回空指针
+    std::shared_ptr<SnapshotIndex> openSnapshotIndex(const SnapshotPart& part) const;
+    
+    // 清理旧的WAL段（在快照后），删除序号不大于 up_to_segment 的段
+    bool cleanupOldWAL(uint64_t up_to_segment);
+    
+    // ========== 库存检查点 ==========
+    
+    // 追加库存检查点到 inventory.ckpt
+    bool saveInventoryCheckpoints(const std::vector<std::pair<std::string, InventoryCheckpoint>>& checkpoints);
+    
+    // 用给定的检查点整体重写 inventory.ckpt（原子替换，用于淘汰旧检查点）
+    bool rewriteInventoryCheckpoints(const std::vector<std::pair<std::string, InventoryCheckpoint>>& checkpoints);
+    
+    // 按写入顺序读取全部检查点，忽略末尾不完整或损坏的记录
+    std::vector<std::pair<std::string, InventoryCheckpoint>> loadInventoryCheckpoints();
     
     // ========== 配置管理 ==========
     
+    // 设置保留的快照数量（至少2个，保证最新快照损坏时可以回退）
+    void setSnapshotRetention(int count) { snapshot_retention_ = count < 2 ? 2 : count; }
+    
+    // 设置全量快照合并间隔：每写入 count 个增量快照后写一次全量快照
+    void setSnapshotConsolidation(int count) { consolidation_interval_ = count < 0 ? 0 : count; }
+    
+    // 设置快照分片并行读写的线程数
+    void setSnapshotThreads(int count) { snapshot_threads_ = count < 1 ? 1 : count; }
+    
     // 设置自动快照间隔（秒）
     void setSnapshotInterval(int seconds) { snapshot_interval_ = seconds; }
     
     // 设置WAL文件大小限制（MB）
     void setWALSizeLimit(int mb) { wal_size_limit_ = mb * 1024 * 1024; }
     
+    // 启用/禁用快照列数据的LZ压缩
+    void setSnapshotCompression(bool enable) { snapshot_compression_ = enable; }
+    
     // 检查是否需要创建快照
     bool shouldCreateSnapshot() const;
     
@@ -66,8 +166,15 @@ public:
     
     StorageInfo getStorageInfo() const;
     
-    // 压缩和归档旧数据
-    bool archiveOldData(int days_old);
+    // ========== 冷数据归档 ==========
+    
+    // 把冷数据写入新的只读归档段（archive_<seq>/，格式与快照相同），成功时返回写入的分片
+    // 归档段一旦写入不再修改，序列位置紧接在同一库管员之前的归档之后
+    bool archiveOldData(const std::unordered_map<std::string, RecordRange>& cold,
+                        std::vector<SnapshotPart>& parts);
+    
+    // 读取全部归档段的分片位置（只读清单），按归档顺序排列
+    std::vector<SnapshotPart> openArchives();
 
 private:
     std::string data_dir_;
@@ -77,26 +184,84 @@ private:
     // 配置参数
     int snapshot_interval_;     // 快照间隔（秒）
     size_t wal_size_limit_;     // WAL文件大小限制
+    bool snapshot_compression_; // 快照是否压缩
+    int snapshot_retention_;    // 保留的快照数量
+    uint64_t wal_segment_seq_;  // 最后一个已封存WAL段的序号
+    int consolidation_interval_;  // 两次全量快照之间最多的增量快照数
+    size_t snapshot_threads_;   // 快照分片并行读写的线程数
+    
+    // 当前快照链状态
+    bool has_chain_;            // 是否已有可供增量快照衔接的快照
+    uint64_t chain_segment_;    // 快照链末尾的WAL段序号
+    int deltas_since_full_;     // 最近一次全量快照之后的增量快照数
+    uint64_t archive_seq_;      // 最后一个归档段的序号
     std::string last_snapshot_time_;
     
     // 内部方法
     bool initializeDataDirectory();
     std::string getCurrentTimestamp() const;
-    std::string generateSnapshotFilename() const;
-    std::string generateWALFilename() const;
+    std::string generateSnapshotPath(const std::string& prefix, uint64_t sequence) const;
+    std::string generateWALFilename(uint64_t segment) const;
+    static uint64_t parseSegment(const std::string& filename, const std::string& prefix);
+    static uint64_t parseWALSegment(const std::string& filename) { return parseSegment(filename, "wal_"); }
     
     // 序列化方法
     std::string serializeTransaction(const std::string& manager_id, const TransactionRecord& trans) const;
     bool deserializeTransaction(const std::string& line, std::string& manager_id, TransactionRecord& trans) const;
+    static bool validateTransaction(const TransactionRecord& trans, std::string& reason);
+    void quarantineWALLine(const std::string& source, const std::string& reason, const std::string& line);
+    void markQuarantinedLines(const std::string& wal_file, const std::vector<std::streamoff>& offsets, bool unterminated);
     
     // 文件操作
     bool rotateWALFile();
-    std::vector<std::string> getWALFiles() const;
-    std::vector<std::string> getSnapshotFiles() const;
+    std::vector<std::string> getWALFiles() const;     // 已封存的段按序号排序，current.wal 在最后
+    std::vector<std::string> getSnapshotFiles() const;  // 全量快照目录，按WAL段序号排序
+    std::vector<std::string> getDeltaFiles() const;     // 增量快照目录，按WAL段序号排序
+    std::vector<std::string> getArchiveDirs() const;    // 归档段目录，按归档序号排序
+    std::vector<std::string> listSnapshotDirs(const std::string& prefix) const;
+    void applySnapshotRetention();
+    
+    // 快照文件读写（列式格式，见 columnar_snapshot.h）
+    struct BlockSource {
+        const std::string* manager_id;
+        uint64_t base_count;
+        const TransactionRecord* records;
+        size_t count;
+    };
+    enum SnapshotKind {
+        KIND_FULL,
+        KIND_DELTA,
+        KIND_ARCHIVE
+    };
+    bool writeSnapshot(const std::string& path, const std::vector<BlockSource>& blocks,
+                       SnapshotKind kind, uint64_t wal_segment, uint64_t base_segment,
+                       bool compress, std::vector<SnapshotPart>& parts);
+    static std::vector<BlockSource> toBlockSources(const std::unordered_map<std::string, RecordRange>& ranges);
     
-    // JSON序列化（用于快照）
-    std::string transactionToJSON(const TransactionRecord& trans) const;
-    bool transactionFromJSON(const std::string& json, TransactionRecord& trans) const;
+    // 快照清单（MANIFEST）：快照类型、WAL检查点和分片列表
+    struct SnapshotManifest {
+        struct Part {
+            std::string file;
+            std::string manager_id;
+            uint64_t base_count;
+            uint64_t record_count;
+            
+            Part() : base_count(0), record_count(0) {}
+        };
+        
+        SnapshotKind kind;
+        uint64_t wal_segment;       // 归档段中为归档序号
+        uint64_t base_segment;
+        std::string created_at;
+        std::vector<Part> parts;
+        
+        SnapshotManifest() : kind(KIND_FULL), wal_segment(0), base_segment(0) {}
+    };
+    bool writeManifest(const std::string& dir, const SnapshotManifest& manifest) const;
+    bool readManifest(const std::string& dir, SnapshotManifest& manifest) const;
+    bool openSnapshotParts(const std::string& dir, bool verify, SnapshotManifest& manifest,
+                           std::vector<std::shared_ptr<MappedSnapshot>>& parts);
+    static std::vector<SnapshotPart> toSnapshotParts(const std::string& dir, const SnapshotManifest& manifest);
     
     // 错误处理
     void logError(const std::string& operation, const std::string& error) const;
@@ -0,0 +1,636 @@
+#include "replication.h"
+#include "binary_protocol.h"
+#include "logger.h"
+#include "monitoring.h"
+#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <unordered_map>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+
+namespace {
+
+enum FrameKind : uint32_t {
+    FRAME_HELLO = 1,
+    FRAME_RECORD = 2,
+    FRAME_HEARTBEAT = 3
+};
+
+// RECORD 消息的 uint32 部分：[类型][位置低/高][写入时间低/高][数量][单价位模式低/高]
+const size_t kRecordNumbers = 8;
+const size_t kRecordFields = 15;
+
+// 单条消息的负载上限，防止错误的长度字段导致巨大的分配
+const uint32_t kMaxFramePayload = 16 * 1024 * 1024;
+
+const int kHeartbeatIntervalMs = 1000;
+const int kHelloTimeoutSeconds = 10;
+const int kReconnectDelayMs = 1000;
+
+// 追赶时每次从数据库读取的记录数，避免一次性复制库管员的全部历史
+const size_t kCatchupPageRecords = 10000;
+
+// accept 因描述符或内存耗尽失败时的退避等待（毫秒），逐次加倍
+const int kAcceptBackoffInitialMs = 10;
+const int kAcceptBackoffMaxMs = 1000;
+
+uint64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint32_t low32(uint64_t value) { return static_cast<uint32_t>(value); }
+uint32_t high32(uint64_t value) { return static_cast<uint32_t>(value >> 32); }
+uint64_t join64(uint32_t low, uint32_t high) { return static_cast<uint64_t>(low) | (static_cast<uint64_t>(high) << 32); }
+
+std::vector<uint8_t> encodeRecord(const std::string& manager_id, const TransactionRecord& trans,
+                                  uint64_t position, uint64_t written_ms) {
+    uint64_t price_bits;
+    std::memcpy(&price_bits, &trans.unit_price, sizeof(price_bits));
+
+    std::vector<uint32_t> numbers = {
+        FRAME_RECORD, low32(position), high32(position), low32(written_ms), high32(written_ms),
+        static_cast<uint32_t>(trans.quantity), low32(price_bits), high32(price_bits)
+    };
+    std::vector<std::string> fields = {
+        manager_id, trans.trans_id, trans.item_id, trans.item_name, trans.type,
+        trans.category, trans.model, trans.unit, trans.partner_id, trans.partner_name,
+        trans.warehouse_id, trans.document_no, trans.timestamp, trans.note, trans.manager_id
+    };
+    return BinaryProtocol::serializeMixedData(numbers, fields);
+}
+
+std::vector<uint8_t> encodeHeartbeat(uint64_t primary_total) {
+    uint64_t sent_ms = nowMs();
+    std::vector<uint32_t> numbers = { FRAME_HEARTBEAT, low32(primary_total), high32(primary_total), low32(sent_ms), high32(sent_ms) };
+    return BinaryProtocol::serializeMixedData(numbers, std::vector<std::string>());
+}
+
+bool decodeRecord(const std::vector<uint32_t>& numbers, const std::vector<std::string>& fields,
+                  std::string& manager_id, TransactionRecord& trans, uint64_t& position, uint64_t& written_ms) {
+    if (numbers.size() != kRecordNumbers || fields.size() != kRecordFields) {
+        return false;
+    }
+
+    position = join64(numbers[1], numbers[2]);
+    written_ms = join64(numbers[3], numbers[4]);
+    trans.quantity = static_cast<int>(numbers[5]);
+    uint64_t price_bits = join64(numbers[6], numbers[7]);
+    std::memcpy(&trans.unit_price, &price_bits, sizeof(price_bits));
+
+    manager_id = fields[0];
+    trans.trans_id = fields[1];
+    trans.item_id = fields[2];
+    trans.item_name = fields[3];
+    trans.type = fields[4];
+    trans.category = fields[5];
+    trans.model = fields[6];
+    trans.unit = fields[7];
+    trans.partner_id = fields[8];
+    trans.partner_name = fields[9];
+    trans.warehouse_id = fields[10];
+    trans.document_no = fields[11];
+    trans.timestamp = fields[12];
+    trans.note = fields[13];
+    trans.manager_id = fields[14];
+    return true;
+}
+
+bool sendFully(int fd, const std::vector<uint8_t>& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readFully(int fd, uint8_t* buffer, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t n = recv(fd, buffer + received, size - received, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 读取一条完整消息并校验，连接关闭、超时或消息损坏时返回 false
+bool readFrame(int fd, std::vector<uint32_t>& numbers, std::vector<std::string>& fields) {
+    const size_t header_size = sizeof(BinaryProtocol::MessageHeader);
+    std::vector<uint8_t> message(header_size);
+    if (!readFully(fd, message.data(), header_size)) {
+        return false;
+    }
+
+    BinaryProtocol::MessageHeader header;
+    if (!BinaryProtocol::parseHeader(message.data(), header_size, header) ||
+        header.message_type != BinaryProtocol::MSG_MIXED_DATA ||
+        header.payload_size > kMaxFramePayload) {
+        return false;
+    }
+
+    message.resize(header_size + header.payload_size);
+    if (!readFully(fd, message.data() + header_size, header.payload_size) ||
+        !BinaryProtocol::validateMessage(message.data(), message.size())) {
+        return false;
+    }
+
+    return BinaryProtocol::deserializeMixedData(message.data() + header_size, header.payload_size,
+                                                numbers, fields);
+}
+
+void setReceiveTimeout(int fd, int seconds) {
+    struct timeval timeout;
+    timeout.tv_sec = seconds;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+// 等待发送的记录：消息只编码一次，由所有从库共享
+struct PendingRecord {
+    std::string manager_id;
+    uint64_t position;
+    std::shared_ptr<const std::vector<uint8_t>> frame;
+};
+
+}  // namespace
+
+// ========== 主库 ==========
+
+struct ReplicationPrimary::Follower {
+    int socket;
+    std::string peer;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<PendingRecord> pending;
+    bool closed;
+
+    Follower(int fd, const std::string& address) : socket(fd), peer(address), closed(false) {}
+
+    // 调用方持有 mutex；唤醒阻塞在 send 上的发送线程
+    void disconnect() {
+        if (!closed) {
+            closed = true;
+            shutdown(socket, SHUT_RDWR);
+        }
+        ready.notify_one();
+    }
+};
+
+ReplicationPrimary::ReplicationPrimary(int port, std::shared_ptr<MemoryDatabase> db, const std::string& bind_address)
+    : port_(port), bind_address_(bind_address), db_(db), shared_(std::make_shared<Shared>()), running_(false), server_fd_(-1) {
+
+    // 追加监听在写锁内执行：只编码一次并放入各从库的发送队列
+    std::shared_ptr<Shared> shared = shared_;
+    db_->addAppendListener([shared](const std::string& manager_id, const TransactionRecord& trans, size_t position) {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        if (shared->followers.empty()) {
+            return;
+        }
+
+        PendingRecord record;
+        record.manager_id = manager_id;
+        record.position = position;
+        record.frame = std::make_shared<const std::vector<uint8_t>>(encodeRecord(manager_id, trans, position, nowMs()));
+
+        for (const auto& follower : shared->followers) {
+            std::lock_guard<std::mutex> follower_lock(follower->mutex);
+            if (follower->closed) {
+                continue;
+            }
+            if (follower->pending.size() >= shared->max_pending) {
+                // 从库跟不上：断开而不是无限积压，重连后从它的本地位置追赶
+                LOG_WARNING("ReplicationPrimary", "append", "Follower " + follower->peer +
+                           " fell too far behind, disconnecting");
+                INC_COUNTER("replication_followers_dropped");
+                follower->disconnect();
+                continue;
+            }
+            follower->pending.push_back(record);
+            follower->ready.notify_one();
+        }
+    });
+
+    LOG_INFO("ReplicationPrimary", "constructor", "Replication primary initialized on " + bind_address + ":" + std::to_string(port));
+}
+
+ReplicationPrimary::~ReplicationPrimary() {
+    stop();
+}
+
+bool ReplicationPrimary::start() {
+    if (running_) {
+        LOG_WARNING("ReplicationPrimary", "start", "Replication primary is already running");
+        return false;
+    }
+
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port_);
+    if (inet_pton(AF_INET, bind_address_.c_str(), &address.sin_addr) != 1) {
+        LOG_ERROR("ReplicationPrimary", "start", "Invalid replication bind address: " + bind_address_);
+        return false;
+    }
+
+    server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_fd_ == -1) {
+        LOG_ERROR("ReplicationPrimary", "start", "Failed to create socket: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    if (bind(server_fd_, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(server_fd_, 16) < 0) {
+        LOG_ERROR("ReplicationPrimary", "start", "Failed to listen on replication address " + bind_address_ + ":" +
+                 std::to_string(port_) + ": " + std::string(strerror(errno)));
+        close(server_fd_);
+        server_fd_ = -1;
+        return false;
+    }
+
+    running_ = true;
+    accept_thread_ = std::thread(&ReplicationPrimary::acceptLoop, this);
+
+    LOG_INFO("ReplicationPrimary", "start", "Replication primary listening on " + bind_address_ + ":" + std::to_string(port_));
+    return true;
+}
+
+void ReplicationPrimary::stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+
+    // 关闭监听 socket 以唤醒 accept
+    shutdown(server_fd_, SHUT_RDWR);
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+    close(server_fd_);
+    server_fd_ = -1;
+
+    // 断开所有从库，发送线程随后自行退出
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    for (const auto& follower : shared_->followers) {
+        std::lock_guard<std::mutex> follower_lock(follower->mutex);
+        follower->disconnect();
+    }
+
+    LOG_INFO("ReplicationPrimary", "stop", "Replication primary stopped");
+}
+
+size_t ReplicationPrimary::getFollowerCount() const {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    return shared_->followers.size();
+}
+
+void ReplicationPrimary::setMaxPendingRecords(size_t count) {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    shared_->max_pending = count < 1 ? 1 : count;
+}
+
+void ReplicationPrimary::acceptLoop() {
+    int backoff_ms = 0;
+    while (running_) {
+        struct sockaddr_in client_address;
+        socklen_t client_len = sizeof(client_address);
+
+        int client_socket = accept(server_fd_, (struct sockaddr*)&client_address, &client_len);
+        if (client_socket < 0) {
+            int accept_error = errno;
+            if (!running_ || accept_error == EINTR || accept_error == ECONNABORTED) {
+                continue;
+            }
+            // EMFILE、ENFILE 等错误会立即重复出现：退避等待资源释放，每次退避只记录一次
+            if (backoff_ms == 0) {
+                LOG_ERROR("ReplicationPrimary", "accept", "Failed to accept follower: " + std::string(strerror(accept_error)));
+                INC_COUNTER("replication_accept_errors");
+            }
+            backoff_ms = backoff_ms == 0 ? kAcceptBackoffInitialMs : std::min(backoff_ms * 2, kAcceptBackoffMaxMs);
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+            continue;
+        }
+        backoff_ms = 0;
+
+        int nodelay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        char host[64] = {0};
+        getnameinfo((struct sockaddr*)&client_address, client_len, host, sizeof(host), nullptr, 0, NI_NUMERICHOST);
+        auto follower = std::make_shared<Follower>(client_socket,
+                                                   std::string(host) + ":" + std::to_string(ntohs(client_address.sin_port)));
+
+        // 发送线程只持有共享状态，主库对象销毁后也能安全退出
+        std::thread(&ReplicationPrimary::serveFollower, shared_, db_, follower).detach();
+    }
+}
+
+void ReplicationPrimary::serveFollower(std::shared_ptr<Shared> shared, std::shared_ptr<MemoryDatabase> db,
+                                       std::shared_ptr<Follower> follower) {
+    // 握手：读取从库每个库管员的记录数
+    std::unordered_map<std::string, uint64_t> next_position;
+    std::vector<uint32_t> numbers;
+    std::vector<std::string> fields;
+    setReceiveTimeout(follower->socket, kHelloTimeoutSeconds);
+    if (!readFrame(follower->socket, numbers, fields) || numbers.empty() || numbers[0] != FRAME_HELLO ||
+        numbers.size() != 1 + fields.size() * 2) {
+        LOG_WARNING("ReplicationPrimary", "handshake", "Invalid handshake from " + follower->peer);
+        close(follower->socket);
+        return;
+    }
+    for (size_t i = 0; i < fields.size(); ++i) {
+        next_position[fields[i]] = join64(numbers[1 + i * 2], numbers[2 + i * 2]);
+    }
+
+    // 先登记再追赶：登记之后的追加都会进入发送队列，登记之前的追加一定能在追赶时读到
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->followers.push_back(follower);
+        SET_GAUGE("replication_followers", shared->followers.size());
+    }
+    LOG_INFO("ReplicationPrimary", "handshake", "Follower connected: " + follower->peer);
+
+    // 追赶前先发送主库总记录数，从库据此得到落后的记录数
+    bool healthy = sendFully(follower->socket, encodeHeartbeat(db->getSystemStatus().total_transactions));
+    for (const auto& manager_id : db->getAllManagerIds()) {
+        if (!healthy) {
+            break;
+        }
+        uint64_t& next = next_position[manager_id];
+        size_t count = db->getTransactionCount(manager_id);
+        if (next > count) {
+            LOG_ERROR("ReplicationPrimary", "catchup", "Follower " + follower->peer + " is ahead of primary for manager " +
+                     manager_id + " (" + std::to_string(next) + " > " + std::to_string(count) + ")");
+            healthy = false;
+            break;
+        }
+
+        // 追赶的记录写入时间未知，不能用当前时间冒充，否则从库会把积压显示为零延迟
+        // 按页读取到登记时的记录数为止，之后的追加已经进入发送队列
+        size_t sent = 0;
+        while (healthy && next < count) {
+            auto records = db->getTransactionsFrom(manager_id, next, std::min<size_t>(kCatchupPageRecords, count - next));
+            if (records.empty()) {
+                break;
+            }
+            for (const auto& trans : records) {
+                if (!sendFully(follower->socket, encodeRecord(manager_id, trans, next, 0))) {
+                    healthy = false;
+                    break;
+                }
+                next++;
+                sent++;
+            }
+        }
+        if (!healthy) {
+            break;
+        }
+        if (sent > 0) {
+            LOG_INFO("ReplicationPrimary", "catchup", "Sent " + std::to_string(sent) +
+                    " records of manager " + manager_id + " to " + follower->peer);
+        }
+    }
+
+    // 追赶完成后转发实时记录，跳过追赶时已经发送过的位置
+    auto last_heartbeat = std::chrono::steady_clock::now();
+    while (healthy) {
+        std::deque<PendingRecord> batch;
+        {
+            std::unique_lock<std::mutex> lock(follower->mutex);
+            follower->ready.wait_for(lock, std::chrono::milliseconds(kHeartbeatIntervalMs), [&follower]() {
+                return follower->closed || !follower->pending.empty();
+            });
+            if (follower->closed) {
+                break;
+            }
+            batch.swap(follower->pending);
+        }
+
+        for (const auto& record : batch) {
+            uint64_t& next = next_position[record.manager_id];
+            if (record.position < next) {
+                continue;
+            }
+            if (!sendFully(follower->socket, *record.frame)) {
+                healthy = false;
+                break;
+            }
+            next = record.position + 1;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (healthy && now - last_heartbeat >= std::chrono::milliseconds(kHeartbeatIntervalMs)) {
+            healthy = sendFully(follower->socket, encodeHeartbeat(db->getSystemStatus().total_transactions));
+            last_heartbeat = now;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        auto& followers = shared->followers;
+        followers.erase(std::remove(followers.begin(), followers.end(), follower), followers.end());
+        SET_GAUGE("replication_followers", followers.size());
+    }
+    {
+        std::lock_guard<std::mutex> lock(follower->mutex);
+        follower->disconnect();
+        close(follower->socket);
+    }
+    LOG_INFO("ReplicationPrimary", "disconnect", "Follower disconnected: " + follower->peer);
+}
+
+// ========== 从库 ==========
+
+ReplicationFollower::ReplicationFollower(const std::string& host, int port, std::shared_ptr<MemoryDatabase> db)
+    : host_(host), port_(port), db_(db), running_(false), connected_(false), socket_(-1), lag_ms_(0), lag_records_(0) {
+    LOG_INFO("ReplicationFollower", "constructor", "Replicating from " + host + ":" + std::to_string(port));
+}
+
+ReplicationFollower::~ReplicationFollower() {
+    stop();
+}
+
+bool ReplicationFollower::start() {
+    if (running_) {
+        LOG_WARNING("ReplicationFollower", "start", "Replication follower is already running");
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&ReplicationFollower::run, this);
+    return true;
+}
+
+void ReplicationFollower::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+        if (socket_ >= 0) {
+            shutdown(socket_, SHUT_RDWR);
+        }
+    }
+    stop_cv_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    LOG_INFO("ReplicationFollower", "stop", "Replication follower stopped");
+}
+
+void ReplicationFollower::run() {
+    while (running_) {
+        int fd = connectToPrimary();
+        if (fd >= 0) {
+            {
+                std::lock_guard<std::mutex> lock(stop_mutex_);
+                socket_ = fd;
+            }
+            if (running_) {
+                replicate(fd);
+            }
+            {
+                std::lock_guard<std::mutex> lock(stop_mutex_);
+                socket_ = -1;
+                close(fd);
+            }
+            connected_ = false;
+            SET_GAUGE("replication_connected", 0);
+        }
+
+        // 断线后稍后重连，stop() 会立即唤醒
+        std::unique_lock<std::mutex> lock(stop_mutex_);
+        stop_cv_.wait_for(lock, std::chrono::milliseconds(kReconnectDelayMs), [this]() { return !running_; });
+    }
+}
+
+int ReplicationFollower::connectToPrimary() {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host_.c_str(), std::to_string(port_).c_str(), &hints, &result) != 0 || !result) {
+        LOG_ERROR("ReplicationFollower", "connect", "Cannot resolve primary host: " + host_);
+        return -1;
+    }
+
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+
+    if (fd < 0) {
+        LOG_DEBUG("ReplicationFollower", "connect", "Primary " + host_ + ":" + std::to_string(port_) + " not reachable");
+        return -1;
+    }
+
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return fd;
+}
+
+void ReplicationFollower::replicate(int socket) {
+    // 握手：报告本地每个库管员的记录数，主库从这些位置开始发送
+    std::vector<uint32_t> numbers = { FRAME_HELLO };
+    std::vector<std::string> fields;
+    for (const auto& manager_id : db_->getAllManagerIds()) {
+        uint64_t count = db_->getTransactionCount(manager_id);
+        fields.push_back(manager_id);
+        numbers.push_back(low32(count));
+        numbers.push_back(high32(count));
+    }
+    if (!sendFully(socket, BinaryProtocol::serializeMixedData(numbers, fields))) {
+        return;
+    }
+
+    connected_ = true;
+    uint64_t connected_ms = nowMs();
+    SET_GAUGE("replication_connected", 1);
+    LOG_INFO("ReplicationFollower", "replicate", "Connected to primary " + host_ + ":" + std::to_string(port_));
+
+    while (running_) {
+        if (!readFrame(socket, numbers, fields) || numbers.empty()) {
+            if (running_) {
+                LOG_WARNING("ReplicationFollower", "replicate", "Lost connection to primary");
+            }
+            return;
+        }
+
+        if (numbers[0] == FRAME_HEARTBEAT && numbers.size() >= 3) {
+            uint64_t primary_total = join64(numbers[1], numbers[2]);
+            uint64_t local_total = db_->getSystemStatus().total_transactions;
+            lag_records_ = primary_total > local_total ? primary_total - local_total : 0;
+            if (lag_records_ == 0) {
+                lag_ms_ = 0;
+            }
+            SET_GAUGE("replication_lag_records", lag_records_);
+            SET_GAUGE("replication_lag_ms", lag_ms_);
+            continue;
+        }
+
+        std::string manager_id;
+        TransactionRecord trans;
+        uint64_t position;
+        uint64_t written_ms;
+        if (numbers[0] != FRAME_RECORD || !decodeRecord(numbers, fields, manager_id, trans, position, written_ms)) {
+            LOG_ERROR("ReplicationFollower", "replicate", "Malformed replication message, reconnecting");
+            return;
+        }
+
+        // 只应用紧接在本地末尾的记录：已有的跳过，出现缺口时重连从本地位置重新追赶
+        uint64_t local_count = db_->getTransactionCount(manager_id);
+        if (position < local_count) {
+            continue;
+        }
+        if (position > local_count) {
+            LOG_ERROR("ReplicationFollower", "replicate", "Replication gap for manager " + manager_id + ": expected position " +
+                     std::to_string(local_count) + ", got " + std::to_string(position));
+            return;
+        }
+
+        auto result = db_->appendTransaction(manager_id, trans);
+        if (result.isError()) {
+            LOG_ERROR("ReplicationFollower", "replicate", "Failed to apply replicated transaction " + trans.trans_id +
+                     ": " + result.getErrorMessage());
+            return;
+        }
+
+        // 追赶的记录（写入时间为0）写于连接之前，连接以来的时间是其延迟的下限
+        uint64_t now = nowMs();
+        uint64_t since = written_ms != 0 ? written_ms : connected_ms;
+        lag_ms_ = now > since ? now - since : 0;
+        if (written_ms == 0 && lag_records_ > 0) {
+            lag_records_--;
+        }
+        INC_COUNTER("replication_records_applied");
+        SET_GAUGE("replication_lag_ms", lag_ms_);
+        SET_GAUGE("replication_lag_records", lag_records_);
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include "memory_database.h"
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+// WAL日志传送：主库把每条追加的记录通过TCP推送给只读从库，从库按相同的序列位置应用
+//
+// 消息使用 BinaryProtocol 的混合数据格式（uint32 数组 + 字符串数组），第一个 uint32 为消息类型：
+//   HELLO     从库 -> 主库：本地每个库管员的记录数，主库从这些位置开始补发
+//   RECORD    主库 -> 从库：一条记录及其序列位置、主库写入时间（用于计算复制延迟，追赶时为0表示未知）
+//   HEARTBEAT 主库 -> 从库：主库当前的总记录数，追赶开始前一次，之后空闲时每秒一次
+// 序列位置保证从库只应用紧接在本地末尾的记录，断线重连后从本地位置继续，不会重复或遗漏
+
+// 主库：监听复制端口，每个从库一个发送线程
+// 复制连接没有认证，默认只监听本机地址，跨主机复制时应绑定到内网地址
+class ReplicationPrimary {
+public:
+    ReplicationPrimary(int port, std::shared_ptr<MemoryDatabase> db, const std::string& bind_address = "127.0.0.1");
+    ~ReplicationPrimary();
+
+    // 开始监听复制端口
+    bool start();
+
+    // 停止监听并断开所有从库
+    void stop();
+
+    bool isRunning() const { return running_; }
+
+    // 当前连接的从库数
+    size_t getFollowerCount() const;
+
+    // 单个从库允许积压的记录数，超出时断开该从库，由其重连后从本地位置追赶
+    void setMaxPendingRecords(size_t count);
+
+private:
+    struct Follower;
+
+    // 与追加监听和发送线程共享的状态（监听在数据库中注册后无法注销，不能引用 this）
+    struct Shared {
+        mutable std::mutex mutex;
+        std::vector<std::shared_ptr<Follower>> followers;
+        size_t max_pending;
+
+        Shared() : max_pending(100000) {}
+    };
+
+    int port_;
+    std::string bind_address_;
+    std::shared_ptr<MemoryDatabase> db_;
+    std::shared_ptr<Shared> shared_;
+    std::atomic<bool> running_;
+    int server_fd_;
+    std::thread accept_thread_;
+
+    void acceptLoop();
+    static void serveFollower(std::shared_ptr<Shared> shared, std::shared_ptr<MemoryDatabase> db,
+                              std::shared_ptr<Follower> follower);
+};
+
+// 从库：连接主库并应用收到的记录，断线后每秒重连
+class ReplicationFollower {
+public:
+    ReplicationFollower(const std::string& host, int port, std::shared_ptr<MemoryDatabase> db);
+    ~ReplicationFollower();
+
+    // 启动复制线程
+    bool start();
+
+    // 断开连接并停止复制线程
+    void stop();
+
+    bool isConnected() const { return connected_; }
+
+    // 复制延迟：最近应用的记录距主库写入的毫秒数，以及落后主库的记录数（心跳时校正，应用记录时递减）
+    // 追赶期间记录的写入时间未知，毫秒数取连接以来的时间（真实延迟的下限）
+    uint64_t getLagMs() const { return lag_ms_; }
+    uint64_t getLagRecords() const { return lag_records_; }
+
+private:
+    std::string host_;
+    int port_;
+    std::shared_ptr<MemoryDatabase> db_;
+    std::atomic<bool> running_;
+    std::atomic<bool> connected_;
+    std::atomic<int> socket_;
+    std::atomic<uint64_t> lag_ms_;
+    std::atomic<uint64_t> lag_records_;
+    std::thread thread_;
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+
+    void run();
+    int connectToPrimary();
+    void replicate(int socket);     // 一次连接的完整会话，连接断开或出错时返回
+};
+
+#endif // REPLICATION_H
@@ -0,0 +1,116 @@
+#include "response_cache.h"
+#include "monitoring.h"
+
+ResponseCache::ResponseCache(size_t max_bytes) : max_bytes_(max_bytes), cached_bytes_(0) {}
+
+HttpResponse ResponseCache::getOrCompute(const std::string& key, uint64_t version, const Producer& producer) {
+    std::shared_ptr<Pending> pending;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (max_bytes_ == 0) {
+            lock.unlock();
+            return producer();
+        }
+
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second->version >= version) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            INC_COUNTER("response_cache_hits");
+            return it->second->response;
+        }
+
+        // 已有线程在计算同一版本（或更新的版本）：等待其结果
+        auto waiting = pending_.find(key);
+        if (waiting != pending_.end() && waiting->second->version >= version) {
+            std::shared_ptr<Pending> leader = waiting->second;
+            INC_COUNTER("response_cache_coalesced");
+            computed_.wait(lock, [&leader]() { return leader->done; });
+            if (leader->succeeded) {
+                return leader->response;
+            }
+            // 计算失败：自己再算一次，不缓存
+            lock.unlock();
+            return producer();
+        }
+
+        INC_COUNTER("response_cache_misses");
+        pending = std::make_shared<Pending>();
+        pending->version = version;
+        pending_[key] = pending;
+    }
+
+    HttpResponse response;
+    try {
+        response = producer();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending->done = true;
+        auto it = pending_.find(key);
+        if (it != pending_.end() && it->second == pending) {
+            pending_.erase(it);
+        }
+        computed_.notify_all();
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending->done = true;
+        pending->succeeded = response.status_code == 200;
+        if (pending->succeeded) {
+            pending->response = response;
+            store(key, version, response);
+        }
+        auto it = pending_.find(key);
+        if (it != pending_.end() && it->second == pending) {
+            pending_.erase(it);
+        }
+    }
+    computed_.notify_all();
+    return response;
+}
+
+void ResponseCache::setMaxBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_bytes_ = bytes;
+    evictOverBudget();
+}
+
+size_t ResponseCache::getCachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+}
+
+void ResponseCache::store(const std::string& key, uint64_t version, const HttpResponse& response) {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        // 并发计算时较早的版本可能后完成，不覆盖更新的结果
+        if (it->second->version > version) {
+            return;
+        }
+        cached_bytes_ -= it->second->bytes;
+        lru_.erase(it->second);
+        entries_.erase(it);
+    }
+
+    size_t bytes = key.size() * 2 + response.body.size() + response.headers.size() +
+                   response.content_type.size() + sizeof(Entry);
+    if (bytes > max_bytes_) {
+        return;
+    }
+    lru_.push_front(Entry{key, version, response, bytes});
+    entries_[key] = lru_.begin();
+    cached_bytes_ += bytes;
+    evictOverBudget();
+}
+
+void ResponseCache::evictOverBudget() {
+    while (cached_bytes_ > max_bytes_ && !lru_.empty()) {
+        Entry& victim = lru_.back();
+        cached_bytes_ -= victim.bytes;
+        entries_.erase(victim.key);
+        lru_.pop_back();
+        INC_COUNTER("response_cache_evictions");
+    }
+    SET_GAUGE("response_cache_bytes", cached_bytes_);
+}
@@ -0,0 +1,58 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include "http_router.h"
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+// 派生接口的响应缓存：按 (请求路径含参数, 数据版本) 缓存成功的响应
+// 同一路径只保留最新版本；总大小超过上限时按最近最少使用的顺序淘汰
+// 同一键的并发未命中只由一个线程计算，其余线程等待并共享结果
+class ResponseCache {
+public:
+    typedef std::function<HttpResponse()> Producer;
+
+    explicit ResponseCache(size_t max_bytes);
+
+    // 取版本不低于 version 的缓存响应；没有时计算并缓存（只缓存 200 响应）
+    HttpResponse getOrCompute(const std::string& key, uint64_t version, const Producer& producer);
+
+    // 0 表示关闭缓存
+    void setMaxBytes(size_t bytes);
+    size_t getCachedBytes() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t version;
+        HttpResponse response;
+        size_t bytes;
+    };
+
+    // 正在计算中的请求
+    struct Pending {
+        uint64_t version;
+        bool done = false;
+        bool succeeded = false;
+        HttpResponse response;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable computed_;
+    std::list<Entry> lru_;      // 表头为最近使用
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries_;
+    std::unordered_map<std::string, std::shared_ptr<Pending>> pending_;
+    size_t max_bytes_;
+    size_t cached_bytes_;
+
+    void store(const std::string& key, uint64_t version, const HttpResponse& response);
+    void evictOverBudget();
+};
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,226 @@
+#include "snapshot_index.h"
+#include "columnar_snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+// 文件头：[magic:4][version:1][field_count:1][reserved:2][wal_segment:8][base_count:8][record_count:4][crc:4]
+const size_t kHeaderSize = 32;
+const size_t kFieldTableSize = 16;
+const size_t kEntrySize = 16;
+
+void putUint32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back((value >> 16) & 0xFF);
+    out.push_back((value >> 24) & 0xFF);
+}
+
+void putUint64(std::vector<uint8_t>& out, uint64_t value) {
+    putUint32(out, static_cast<uint32_t>(value));
+    putUint32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void setUint32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+    out[offset] = value & 0xFF;
+    out[offset + 1] = (value >> 8) & 0xFF;
+    out[offset + 2] = (value >> 16) & 0xFF;
+    out[offset + 3] = (value >> 24) & 0xFF;
+}
+
+uint32_t getUint32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t getUint64(const uint8_t* p) {
+    return static_cast<uint64_t>(getUint32(p)) | (static_cast<uint64_t>(getUint32(p + 4)) << 32);
+}
+
+}  // namespace
+
+const uint32_t SnapshotIndex::INDEX_MAGIC;
+const uint8_t SnapshotIndex::INDEX_VERSION;
+
+const std::string& SnapshotIndex::fieldValue(const TransactionRecord& record, Field field) {
+    switch (field) {
+        case FIELD_ITEM_ID:
+            return record.item_id;
+        case FIELD_DOCUMENT_NO:
+            return record.document_no;
+        case FIELD_PARTNER_ID:
+            return record.partner_id;
+        default:
+            return record.trans_id;
+    }
+}
+
+// ========== 编码 ==========
+
+std::vector<uint8_t> SnapshotIndex::encode(uint64_t wal_segment, uint64_t base_count,
+                                           const TransactionRecord* records, size_t count) {
+    std::vector<uint8_t> out;
+    putUint32(out, INDEX_MAGIC);
+    out.push_back(INDEX_VERSION);
+    out.push_back(FIELD_COUNT);
+    out.push_back(0);
+    out.push_back(0);
+    putUint64(out, wal_segment);
+    putUint64(out, base_count);
+    putUint32(out, static_cast<uint32_t>(count));
+    putUint32(out, 0);  // 校验和，最后填写
+
+    size_t directory = out.size();
+    out.resize(directory + FIELD_COUNT * kFieldTableSize, 0);
+
+    std::vector<uint32_t> order(count);
+    for (uint8_t f = 0; f < FIELD_COUNT; ++f) {
+        Field field = static_cast<Field>(f);
+
+        // 按键排序，相同的键保持记录顺序，偏移列表即为升序
+        for (size_t i = 0; i < count; ++i) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [records, field](uint32_t a, uint32_t b) {
+            return fieldValue(records[a], field) < fieldValue(records[b], field);
+        });
+
+        std::vector<uint8_t> entries;
+        std::vector<uint8_t> keys;
+        std::vector<uint8_t> postings;
+        uint32_t entry_count = 0;
+        for (size_t i = 0; i < count; ) {
+            const std::string& key = fieldValue(records[order[i]], field);
+            size_t j = i;
+            while (j < count && fieldValue(records[order[j]], field) == key) {
+                putUint32(postings, order[j]);
+                j++;
+            }
+
+            putUint32(entries, static_cast<uint32_t>(keys.size()));
+            putUint32(entries, static_cast<uint32_t>(key.size()));
+            putUint32(entries, static_cast<uint32_t>(i));
+            putUint32(entries, static_cast<uint32_t>(j - i));
+            keys.insert(keys.end(), key.begin(), key.end());
+            entry_count++;
+            i = j;
+        }
+
+        size_t table = directory + f * kFieldTableSize;
+        setUint32(out, table, entry_count);
+        setUint32(out, table + 4, static_cast<uint32_t>(out.size()));
+        out.insert(out.end(), entries.begin(), entries.end());
+        setUint32(out, table + 8, static_cast<uint32_t>(out.size()));
+        out.insert(out.end(), keys.begin(), keys.end());
+        setUint32(out, table + 12, static_cast<uint32_t>(out.size()));
+        out.insert(out.end(), postings.begin(), postings.end());
+    }
+
+    setUint32(out, kHeaderSize - 4, ColumnarSnapshot::crc32(out.data() + kHeaderSize, out.size() - kHeaderSize));
+    return out;
+}
+
+// ========== 读取 ==========
+
+SnapshotIndex::~SnapshotIndex() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+std::shared_ptr<SnapshotIndex> SnapshotIndex::open(const std::string& path, uint64_t wal_segment,
+                                                   uint64_t base_count, uint64_t record_count,
+                                                   std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        error = "Cannot open index file: " + path;
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize + FIELD_COUNT * kFieldTableSize) {
+        close(fd);
+        error = "Truncated index file: " + path;
+        return nullptr;
+    }
+
+    std::shared_ptr<SnapshotIndex> index(new SnapshotIndex());
+    index->size_ = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, index->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        error = "Failed to mmap index file: " + path;
+        return nullptr;
+    }
+    index->data_ = static_cast<const uint8_t*>(addr);
+
+    const uint8_t* p = index->data_;
+    if (getUint32(p) != INDEX_MAGIC || p[4] != INDEX_VERSION || p[5] != FIELD_COUNT) {
+        error = "Invalid index header: " + path;
+        return nullptr;
+    }
+
+    // 索引必须属于同一个分片：WAL段、起始位置和记录数都一致
+    if (getUint64(p + 8) != wal_segment || getUint64(p + 16) != base_count || getUint32(p + 24) != record_count) {
+        error = "Index does not match snapshot part: " + path;
+        return nullptr;
+    }
+
+    if (ColumnarSnapshot::crc32(p + kHeaderSize, index->size_ - kHeaderSize) != getUint32(p + 28)) {
+        error = "Index checksum mismatch: " + path;
+        return nullptr;
+    }
+
+    for (uint8_t f = 0; f < FIELD_COUNT; ++f) {
+        const uint8_t* table = p + kHeaderSize + f * kFieldTableSize;
+        FieldTable& field = index->fields_[f];
+        field.entry_count = getUint32(table);
+        field.entries_offset = getUint32(table + 4);
+        field.keys_offset = getUint32(table + 8);
+        field.postings_offset = getUint32(table + 12);
+
+        if (field.entries_offset + static_cast<uint64_t>(field.entry_count) * kEntrySize > field.keys_offset ||
+            field.keys_offset > field.postings_offset ||
+            field.postings_offset + record_count * 4 > index->size_) {
+            error = "Invalid index field table: " + path;
+            return nullptr;
+        }
+    }
+
+    return index;
+}
+
+void SnapshotIndex::lookup(Field field, const std::string& key, std::vector<uint32_t>& offsets) const {
+    const FieldTable& table = fields_[field];
+    const uint8_t* entries = data_ + table.entries_offset;
+
+    // 在有序键块中二分查找
+    size_t low = 0;
+    size_t high = table.entry_count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        const uint8_t* entry = entries + mid * kEntrySize;
+        const char* entry_key = reinterpret_cast<const char*>(data_ + table.keys_offset + getUint32(entry));
+        int cmp = key.compare(0, std::string::npos, entry_key, getUint32(entry + 4));
+        if (cmp == 0) {
+            const uint8_t* postings = data_ + table.postings_offset + static_cast<size_t>(getUint32(entry + 8)) * 4;
+            uint32_t posting_count = getUint32(entry + 12);
+            for (uint32_t i = 0; i < posting_count; ++i) {
+                offsets.push_back(getUint32(postings + i * 4));
+            }
+            return;
+        }
+        if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef SNAPSHOT_INDEX_H
+#define SNAPSHOT_INDEX_H
+
+#include "transaction.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// 快照分片的二级索引文件：与分片一起写入，只读映射后直接二分查找，重启时无需重建
+// 每个字段一个有序键块，键指向分片内的记录偏移列表
+class SnapshotIndex {
+public:
+    // ========== 格式常量 ==========
+
+    static const uint32_t INDEX_MAGIC = 0x49534D57;    // "WMSI"（小端）
+    static const uint8_t INDEX_VERSION = 1;
+
+    // 建立索引的字段
+    enum Field : uint8_t {
+        FIELD_TRANS_ID = 0,
+        FIELD_ITEM_ID = 1,
+        FIELD_DOCUMENT_NO = 2,
+        FIELD_PARTNER_ID = 3,
+        FIELD_COUNT = 4
+    };
+
+    static const std::string& fieldValue(const TransactionRecord& record, Field field);
+
+    // ========== 编码 ==========
+
+    // 为分片中的记录 records[0..count) 编码索引文件
+    // wal_segment 和 base_count 写入文件头，打开时用来确认索引属于同一个分片
+    static std::vector<uint8_t> encode(uint64_t wal_segment, uint64_t base_count,
+                                       const TransactionRecord* records, size_t count);
+
+    // ========== 读取 ==========
+
+    ~SnapshotIndex();
+
+    // 映射并校验索引文件，与分片的 WAL段、起始位置或记录数不一致时返回空指针并填写 error
+    static std::shared_ptr<SnapshotIndex> open(const std::string& path, uint64_t wal_segment,
+                                               uint64_t base_count, uint64_t record_count,
+                                               std::string& error);
+
+    // 查找键对应的记录偏移（相对分片起始位置，升序），追加到 offsets
+    void lookup(Field field, const std::string& key, std::vector<uint32_t>& offsets) const;
+
+    size_t getMappedSize() const { return size_; }
+
+private:
+    SnapshotIndex() : data_(nullptr), size_(0) {}
+
+    // 禁用拷贝
+    SnapshotIndex(const SnapshotIndex&) = delete;
+    SnapshotIndex& operator=(const SnapshotIndex&) = delete;
+
+    // 每个字段的键块位置
+    struct FieldTable {
+        uint32_t entry_count;
+        uint32_t entries_offset;    // 键条目：[key_offset:4][key_length:4][postings_offset:4][postings_count:4]
+        uint32_t keys_offset;       // 键字符串
+        uint32_t postings_offset;   // 记录偏移（uint32）
+
+        FieldTable() : entry_count(0), entries_offset(0), keys_offset(0), postings_offset(0) {}
+    };
+
+    const uint8_t* data_;
+    size_t size_;
+    FieldTable fields_[FIELD_COUNT];
+};
+
+#endif // SNAPSHOT_INDEX_H
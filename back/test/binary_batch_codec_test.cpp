@@ -0,0 +1,265 @@
+// 二进制协议交易记录批量的单元测试：列式编码往返、时间戳编码分支、字符串表索引宽度和格式错误的负载
+#include "unit_test.h"
+#include "binary_protocol.h"
+#include <random>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+namespace {
+
+const size_t kHeaderSize = sizeof(BinaryProtocol::MessageHeader);
+
+bool sameRecord(const TransactionRecord& a, const TransactionRecord& b) {
+    return a.trans_id == b.trans_id && a.item_id == b.item_id && a.item_name == b.item_name &&
+           a.type == b.type && a.quantity == b.quantity && a.timestamp == b.timestamp &&
+           a.manager_id == b.manager_id && a.note == b.note && a.category == b.category &&
+           a.model == b.model && a.unit == b.unit && a.unit_price == b.unit_price &&
+           a.partner_id == b.partner_id && a.partner_name == b.partner_name &&
+           a.warehouse_id == b.warehouse_id && a.document_no == b.document_no;
+}
+
+enum class Timestamps { UNIFORM, MIXED, UNPARSABLE };
+
+std::vector<TransactionRecord> makeRecords(size_t count, Timestamps timestamps, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<TransactionRecord> records;
+    for (size_t i = 0; i < count; ++i) {
+        TransactionRecord trans;
+        trans.trans_id = "TXN" + std::to_string(100000 + i);
+        trans.item_id = "ITEM" + std::to_string(rng() % 50);
+        trans.item_name = "物品" + trans.item_id;
+        trans.type = rng() % 2 ? "in" : "out";
+        trans.quantity = static_cast<int>(rng() % 1000) + 1;
+        if (i % 17 == 0) trans.quantity = -5;       // 编码不做业务校验，按位还原
+
+        // 时间戳不保证递增：差分可以为负
+        char timestamp[32];
+        unsigned month = 1 + rng() % 12, day = 1 + rng() % 28, hour = rng() % 24;
+        unsigned minute = rng() % 60, second = rng() % 60, millis = rng() % 1000;
+        std::snprintf(timestamp, sizeof(timestamp), "2024-%02u-%02uT%02u:%02u:%02u.%03uZ",
+                      month, day, hour, minute, second, millis);
+        trans.timestamp = timestamp;
+        if (timestamps == Timestamps::MIXED && i % 3 == 0) trans.timestamp = "1969-07-20T20:17:40";
+        if (timestamps == Timestamps::UNPARSABLE && i % 5 == 0) trans.timestamp = "昨天下午";
+
+        trans.manager_id = "m1";
+        trans.note = i % 3 ? "" : "备注 \"quoted\"";
+        trans.category = "C" + std::to_string(rng() % 5);
+        trans.unit = "个";
+        trans.unit_price = (rng() % 100000) / 100.0;
+        if (i % 13 == 0) trans.unit_price = 1.0 / 3;
+        trans.partner_id = "P" + std::to_string(rng() % 9);
+        trans.warehouse_id = "WH" + std::to_string(rng() % 3);
+        trans.document_no = "DOC" + std::to_string(i / 4);
+        records.push_back(trans);
+    }
+    return records;
+}
+
+// 对完整消息做校验并解码负载
+bool decodeMessage(const std::vector<uint8_t>& message, std::vector<uint32_t>& uint32_data,
+                   std::vector<std::string>& string_data, std::vector<TransactionRecord>& records) {
+    if (!BinaryProtocol::validateMessage(message.data(), message.size())) {
+        return false;
+    }
+    return BinaryProtocol::deserializeTransactions(message.data() + kHeaderSize, message.size() - kHeaderSize,
+                                                   uint32_data, string_data, records);
+}
+
+bool decodePayload(const std::vector<uint8_t>& payload) {
+    std::vector<uint32_t> uint32_data;
+    std::vector<std::string> string_data;
+    std::vector<TransactionRecord> records;
+    return BinaryProtocol::deserializeTransactions(payload.data(), payload.size(), uint32_data, string_data, records);
+}
+
+void testRoundTrip() {
+    std::vector<uint32_t> uint32_data = { 7, 0, 0xFFFFFFFFu };
+    std::vector<std::string> string_data = { "m1", "", "管理员" };
+
+    // 300 条记录的字符串表超过 256 项，索引宽度为 2 字节；7 万条超过 65536 项，宽度为 4 字节
+    for (size_t count : { 0, 1, 5, 300, 70000 }) {
+        for (Timestamps timestamps : { Timestamps::UNIFORM, Timestamps::MIXED, Timestamps::UNPARSABLE }) {
+            auto records = makeRecords(count, timestamps, static_cast<unsigned>(count));
+            auto message = BinaryProtocol::serializeTransactionBatch(uint32_data, string_data,
+                                                                     records.data(), records.size());
+
+            BinaryProtocol::MessageHeader header;
+            EXPECT_TRUE(BinaryProtocol::parseHeader(message.data(), message.size(), header));
+            EXPECT_EQ(header.message_type, BinaryProtocol::MSG_TRANSACTION_BATCH);
+
+            std::vector<uint32_t> decoded_uint32;
+            std::vector<std::string> decoded_strings;
+            std::vector<TransactionRecord> decoded;
+            EXPECT_TRUE(decodeMessage(message, decoded_uint32, decoded_strings, decoded));
+            EXPECT_TRUE(decoded_uint32 == uint32_data);
+            EXPECT_TRUE(decoded_strings == string_data);
+            EXPECT_EQ(decoded.size(), records.size());
+            bool same = decoded.size() == records.size();
+            for (size_t i = 0; same && i < records.size(); ++i) {
+                same = sameRecord(decoded[i], records[i]);
+            }
+            EXPECT_TRUE(same);
+        }
+    }
+}
+
+void testClientResult() {
+    auto records = makeRecords(50, Timestamps::UNIFORM, 9);
+    auto message = BinaryProtocol::serializeTransactionResult({ 200, 50 }, { "ok" }, records.data(), records.size());
+
+    BinaryClient client;
+    EXPECT_TRUE(client.handleMessage(message.data(), message.size()));
+    const auto& response = client.getLastResponse();
+    EXPECT_TRUE(response.success);
+    EXPECT_TRUE(response.uint32_data == std::vector<uint32_t>({ 200, 50 }));
+    EXPECT_TRUE(response.string_data == std::vector<std::string>({ "ok" }));
+    EXPECT_EQ(response.records.size(), records.size());
+    bool same = response.records.size() == records.size();
+    for (size_t i = 0; same && i < records.size(); ++i) {
+        same = sameRecord(response.records[i], records[i]);
+    }
+    EXPECT_TRUE(same);
+
+    // 列式编码应明显小于把每个字段作为字符串数组发送
+    auto many = makeRecords(1000, Timestamps::UNIFORM, 1);
+    std::vector<std::string> fields;
+    for (const auto& trans : many) {
+        fields.insert(fields.end(), { trans.trans_id, trans.item_id, trans.item_name, trans.type,
+                                      std::to_string(trans.quantity), trans.timestamp, trans.manager_id,
+                                      trans.note, trans.category, trans.model, trans.unit,
+                                      std::to_string(trans.unit_price), trans.partner_id, trans.partner_name,
+                                      trans.warehouse_id, trans.document_no });
+    }
+    auto compact = BinaryClient().sendTransactionBatch({}, {}, many);
+    EXPECT_TRUE(compact.size() * 2 < BinaryProtocol::serializeStringArray(fields).size());
+}
+
+void testMalformedPayload() {
+    auto records = makeRecords(20, Timestamps::MIXED, 4);
+    auto message = BinaryProtocol::serializeTransactionBatch({ 1, 2 }, { "a" }, records.data(), records.size());
+    std::vector<uint8_t> payload(message.begin() + kHeaderSize, message.end());
+    EXPECT_TRUE(decodePayload(payload));
+
+    // 任意位置截断或多出尾部字节都必须失败
+    for (size_t size = 0; size < payload.size(); ++size) {
+        EXPECT_TRUE(!decodePayload(std::vector<uint8_t>(payload.begin(), payload.begin() + size)));
+    }
+    auto trailing = payload;
+    trailing.push_back(0);
+    EXPECT_TRUE(!decodePayload(trailing));
+
+    // 失败时不留下部分解码的记录
+    std::vector<uint32_t> uint32_data;
+    std::vector<std::string> string_data;
+    std::vector<TransactionRecord> decoded(3);
+    EXPECT_TRUE(!BinaryProtocol::deserializeTransactions(trailing.data(), trailing.size(),
+                                                         uint32_data, string_data, decoded));
+    EXPECT_TRUE(decoded.empty());
+
+    // 整批消息：校验和与总长度（校验和逐位左移，只对负载末尾 32 字节的改动敏感）
+    auto flipped = message;
+    flipped[message.size() - 3] ^= 0x01;
+    EXPECT_TRUE(!BinaryProtocol::validateMessage(flipped.data(), flipped.size()));
+    EXPECT_TRUE(!BinaryProtocol::validateMessage(message.data(), message.size() - 1));
+    BinaryClient client;
+    EXPECT_TRUE(!client.handleMessage(flipped.data(), flipped.size()));
+}
+
+void testMalformedFields() {
+    // 单条记录、统一时间格式的批量：信封 [0:4][0:4]，之后是记录数和字符串表
+    auto records = makeRecords(1, Timestamps::UNIFORM, 2);
+    auto message = BinaryProtocol::serializeTransactionBatch({}, {}, records.data(), records.size());
+    std::vector<uint8_t> payload(message.begin() + kHeaderSize, message.end());
+    EXPECT_TRUE(decodePayload(payload));
+
+    const size_t count_offset = 8;
+    const size_t table_size_offset = 12;
+    auto patchUint32 = [](std::vector<uint8_t> data, size_t offset, uint32_t value) {
+        // 与信封的写入方式一致：先转网络字节序再按大端写出
+        value = BinaryProtocol::htonl_portable(value);
+        data[offset] = static_cast<uint8_t>(value >> 24);
+        data[offset + 1] = static_cast<uint8_t>(value >> 16);
+        data[offset + 2] = static_cast<uint8_t>(value >> 8);
+        data[offset + 3] = static_cast<uint8_t>(value);
+        return data;
+    };
+
+    // 记录数、字符串表条数过大：不能按声明的数量分配
+    EXPECT_TRUE(!decodePayload(patchUint32(payload, count_offset, 0xFFFFFFFFu)));
+    EXPECT_TRUE(!decodePayload(patchUint32(payload, count_offset, 2)));
+    EXPECT_TRUE(!decodePayload(patchUint32(payload, table_size_offset, 0x7FFFFFFFu)));
+    EXPECT_TRUE(!decodePayload(patchUint32(payload, 0, 0xFFFFFFFFu)));
+    EXPECT_TRUE(!decodePayload(patchUint32(payload, 4, 0xFFFFFFFFu)));
+
+    // 找到字符串表之后的索引宽度和时间戳编码字节
+    size_t offset = table_size_offset + 4;
+    uint32_t table_size = 0;
+    for (size_t b = 0; b < 4; ++b) table_size = (table_size << 8) | payload[table_size_offset + b];
+    table_size = BinaryProtocol::ntohl_portable(table_size);
+    for (uint32_t i = 0; i < table_size; ++i) {
+        uint32_t length = 0;
+        for (size_t b = 0; b < 4; ++b) length = (length << 8) | payload[offset + b];
+        offset += 4 + BinaryProtocol::ntohl_portable(length);
+    }
+    const size_t width_offset = offset;
+    EXPECT_EQ(payload[width_offset], 1u);
+
+    for (uint8_t width : { 0, 3, 8 }) {
+        auto bad = payload;
+        bad[width_offset] = width;
+        EXPECT_TRUE(!decodePayload(bad));
+    }
+    for (uint8_t encoding : { 5, 0x80, 0xFE }) {
+        auto bad = payload;
+        bad[width_offset + 1] = encoding;
+        EXPECT_TRUE(!decodePayload(bad));
+    }
+
+    // 字符串表索引越界
+    auto bad_index = payload;
+    bad_index[width_offset + 2] = static_cast<uint8_t>(table_size);
+    EXPECT_TRUE(!decodePayload(bad_index));
+
+    // 时间戳差分的 varint 超过 10 字节
+    auto long_varint = payload;
+    long_varint.resize(payload.size() - 1);
+    while (long_varint.size() < payload.size() + 10) long_varint.push_back(0x80);
+    long_varint.push_back(0x01);
+    EXPECT_TRUE(!decodePayload(long_varint));
+}
+
+void testRandomInput() {
+    // 随机字节和对有效负载的随机改写都不能越界或崩溃（由 ASan 构建发现）
+    auto records = makeRecords(8, Timestamps::MIXED, 6);
+    auto message = BinaryProtocol::serializeTransactionBatch({ 3 }, { "x" }, records.data(), records.size());
+    std::vector<uint8_t> payload(message.begin() + kHeaderSize, message.end());
+
+    std::mt19937 rng(13);
+    for (int n = 0; n < 5000; ++n) {
+        auto mutated = payload;
+        for (int k = 1 + rng() % 4; k > 0; --k) {
+            mutated[rng() % mutated.size()] = static_cast<uint8_t>(rng());
+        }
+        decodePayload(mutated);
+
+        std::vector<uint8_t> junk(rng() % 96);
+        for (auto& byte : junk) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        decodePayload(junk);
+    }
+    EXPECT_TRUE(decodePayload(payload));
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testRoundTrip);
+    RUN_TEST(testClientResult);
+    RUN_TEST(testMalformedPayload);
+    RUN_TEST(testMalformedFields);
+    RUN_TEST(testRandomInput);
+    return unit_test::report("binary_batch_codec_test");
+}
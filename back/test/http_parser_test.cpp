@@ -0,0 +1,212 @@
+// 增量HTTP请求解析器的单元测试：分块到达、流水线、chunked 请求体和格式错误的请求
+#include "unit_test.h"
+#include "http_parser.h"
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+const size_t kMaxHeader = 8192;
+const size_t kMaxBody = 1024 * 1024;
+
+// 一次性喂入全部数据，依次取出所有完整请求
+std::vector<HttpRequest> parseAll(const std::string& data, HttpRequestParser::Status& last) {
+    HttpRequestParser parser(kMaxHeader, kMaxBody);
+    parser.feed(data.data(), data.size());
+    std::vector<HttpRequest> requests;
+    HttpRequest request;
+    while ((last = parser.parse(request)) == HttpRequestParser::Status::COMPLETE) {
+        requests.push_back(request);
+    }
+    return requests;
+}
+
+// 每次只喂入 step 个字节，每次喂入后尽量取出请求
+std::vector<HttpRequest> parseInSteps(const std::string& data, size_t step) {
+    HttpRequestParser parser(kMaxHeader, kMaxBody);
+    std::vector<HttpRequest> requests;
+    HttpRequest request;
+    for (size_t pos = 0; pos < data.size(); pos += step) {
+        parser.feed(data.data() + pos, std::min(step, data.size() - pos));
+        HttpRequestParser::Status status;
+        while ((status = parser.parse(request)) == HttpRequestParser::Status::COMPLETE) {
+            requests.push_back(request);
+        }
+        if (status == HttpRequestParser::Status::FAILED) {
+            break;
+        }
+    }
+    return requests;
+}
+
+// 格式错误的请求：返回失败状态码，不完整时返回 0
+int failureStatus(const std::string& data, size_t max_header = kMaxHeader, size_t max_body = kMaxBody) {
+    HttpRequestParser parser(max_header, max_body);
+    parser.feed(data.data(), data.size());
+    HttpRequest request;
+    HttpRequestParser::Status status;
+    while ((status = parser.parse(request)) == HttpRequestParser::Status::COMPLETE) {
+    }
+    return status == HttpRequestParser::Status::FAILED ? parser.getErrorStatus() : 0;
+}
+
+void testSimpleGet() {
+    HttpRequestParser::Status last;
+    auto requests = parseAll("GET /api/managers/m1/transactions?limit=5 HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "X-Custom-Header:   padded value \t\r\n"
+                             "\r\n", last);
+    EXPECT_EQ(requests.size(), 1u);
+    EXPECT_TRUE(last == HttpRequestParser::Status::NEED_MORE);
+    if (requests.size() != 1) {
+        return;
+    }
+    const HttpRequest& request = requests[0];
+    EXPECT_EQ(request.method, std::string("GET"));
+    EXPECT_EQ(request.path, std::string("/api/managers/m1/transactions?limit=5"));
+    EXPECT_EQ(request.version, std::string("HTTP/1.1"));
+    EXPECT_EQ(request.getHeader("host"), std::string("localhost"));
+    EXPECT_EQ(request.getHeader("x-custom-header"), std::string("padded value"));
+    EXPECT_EQ(request.getHeader("missing"), std::string());
+    EXPECT_TRUE(request.body.empty());
+    EXPECT_TRUE(request.wantsKeepAlive());
+}
+
+void testKeepAlive() {
+    HttpRequestParser::Status last;
+    auto requests = parseAll("GET / HTTP/1.1\r\nConnection: Close\r\n\r\n"
+                             "GET / HTTP/1.0\r\n\r\n"
+                             "GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", last);
+    EXPECT_EQ(requests.size(), 3u);
+    if (requests.size() == 3) {
+        EXPECT_TRUE(!requests[0].wantsKeepAlive());
+        EXPECT_TRUE(!requests[1].wantsKeepAlive());
+        EXPECT_TRUE(requests[2].wantsKeepAlive());
+    }
+}
+
+void testSplitAtEveryByte() {
+    std::string body = "{\"item_id\":\"I1\",\"type\":\"in\",\"quantity\":3}";
+    std::string data = "POST /api/managers/m1/transactions HTTP/1.1\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                       "\r\n" + body +
+                       "GET /health HTTP/1.1\n\n";      // 只用 LF 的行尾也接受
+    for (size_t step : { 1, 2, 3, 7, 64, 4096 }) {
+        auto requests = parseInSteps(data, step);
+        EXPECT_EQ(requests.size(), 2u);
+        if (requests.size() == 2) {
+            EXPECT_EQ(requests[0].method, std::string("POST"));
+            EXPECT_EQ(requests[0].body, body);
+            EXPECT_EQ(requests[1].path, std::string("/health"));
+        }
+    }
+}
+
+void testPipelined() {
+    std::string data;
+    for (int i = 0; i < 50; ++i) {
+        std::string body = std::string(i, 'x');
+        data += "POST /r" + std::to_string(i) + " HTTP/1.1\r\nContent-Length: " +
+                std::to_string(body.size()) + "\r\n\r\n" + body;
+        data += "\r\n";     // 请求之间多余的空行忽略
+    }
+    HttpRequestParser::Status last;
+    auto requests = parseAll(data, last);
+    EXPECT_EQ(requests.size(), 50u);
+    bool in_order = requests.size() == 50;
+    for (size_t i = 0; in_order && i < requests.size(); ++i) {
+        in_order = requests[i].path == "/r" + std::to_string(i) && requests[i].body.size() == i;
+    }
+    EXPECT_TRUE(in_order);
+}
+
+void testChunkedBody() {
+    std::string data = "POST /upload HTTP/1.1\r\n"
+                       "Transfer-Encoding: chunked\r\n"
+                       "\r\n"
+                       "5\r\nhello\r\n"
+                       "1;ext=value\r\n \r\n"
+                       "A\r\n0123456789\r\n"
+                       "0\r\n"
+                       "Trailer-Field: ignored\r\n"
+                       "\r\n"
+                       "GET /next HTTP/1.1\r\n\r\n";
+    for (size_t step : { 1, 5, 4096 }) {
+        auto requests = parseInSteps(data, step);
+        EXPECT_EQ(requests.size(), 2u);
+        if (requests.size() == 2) {
+            EXPECT_EQ(requests[0].body, std::string("hello 0123456789"));
+            EXPECT_EQ(requests[1].path, std::string("/next"));
+        }
+    }
+}
+
+void testIncomplete() {
+    HttpRequestParser parser(kMaxHeader, kMaxBody);
+    std::string partial = "POST /x HTTP/1.1\r\nContent-Length: 10\r\n\r\n12345";
+    parser.feed(partial.data(), partial.size());
+    HttpRequest request;
+    EXPECT_TRUE(parser.parse(request) == HttpRequestParser::Status::NEED_MORE);
+    EXPECT_TRUE(parser.parse(request) == HttpRequestParser::Status::NEED_MORE);
+    parser.feed("67890", 5);
+    EXPECT_TRUE(parser.parse(request) == HttpRequestParser::Status::COMPLETE);
+    EXPECT_EQ(request.body, std::string("1234567890"));
+    EXPECT_EQ(parser.getBufferedBytes(), 0u);
+}
+
+void testMalformed() {
+    // 请求行
+    EXPECT_EQ(failureStatus("GET /\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("GET  / HTTP/1.1\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("GET / HTTP/1.1 extra\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("G(T / HTTP/1.1\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("GET / HTTP/2.0\r\n\r\n"), 505);
+    EXPECT_EQ(failureStatus("GET / FTP/1.1\r\n\r\n"), 400);
+
+    // 头部
+    EXPECT_EQ(failureStatus("GET / HTTP/1.1\r\nNo colon here\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("GET / HTTP/1.1\r\nBad Name: x\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("GET / HTTP/1.1\r\nX: " + std::string(9000, 'a') + "\r\n\r\n"), 431);
+    EXPECT_EQ(failureStatus("GET / HTTP/1.1\r\nX: " + std::string(9000, 'a')), 431);   // 没有换行也要限制
+
+    // 请求体长度
+    EXPECT_EQ(failureStatus("POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("POST / HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("POST / HTTP/1.1\r\nContent-Length: 99999999999999999999\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 4\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("POST / HTTP/1.1\r\nContent-Length: 2000000\r\n\r\n"), 413);
+    EXPECT_EQ(failureStatus("POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n"), 400);
+    EXPECT_EQ(failureStatus("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n"), 501);
+
+    // chunked 请求体
+    std::string chunked = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    EXPECT_EQ(failureStatus(chunked + "zz\r\n"), 400);
+    EXPECT_EQ(failureStatus(chunked + "\r\n"), 400);
+    EXPECT_EQ(failureStatus(chunked + "3\r\nabcX\r\n"), 400);
+    EXPECT_EQ(failureStatus(chunked + "fffffffffffffffff\r\n"), 400);
+    EXPECT_EQ(failureStatus(chunked + "200000\r\n"), 413);
+
+    // 失败后不再解析后续数据
+    HttpRequestParser parser(kMaxHeader, kMaxBody);
+    std::string data = "BAD\r\n\r\nGET / HTTP/1.1\r\n\r\n";
+    parser.feed(data.data(), data.size());
+    HttpRequest request;
+    EXPECT_TRUE(parser.parse(request) == HttpRequestParser::Status::FAILED);
+    EXPECT_TRUE(parser.parse(request) == HttpRequestParser::Status::FAILED);
+    EXPECT_TRUE(!parser.getError().empty());
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testSimpleGet);
+    RUN_TEST(testKeepAlive);
+    RUN_TEST(testSplitAtEveryByte);
+    RUN_TEST(testPipelined);
+    RUN_TEST(testChunkedBody);
+    RUN_TEST(testIncomplete);
+    RUN_TEST(testMalformed);
+    return unit_test::report("http_parser_test");
+}
@@ -0,0 +1,222 @@
+// SAX JSON解析器的单元测试：事件序列、转义解码、数字格式、嵌套深度、处理器中止和格式错误的输入
+#include "unit_test.h"
+#include "json_sax_parser.h"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 把回调记录成一串事件文本，便于整体比较；abort_after 次回调后返回 false
+class RecordingHandler : public JsonSaxParser::Handler {
+public:
+    std::vector<std::string> events;
+    size_t abort_after = SIZE_MAX;
+
+    bool onObjectStart() override { return record("{"); }
+    bool onObjectEnd() override { return record("}"); }
+    bool onArrayStart() override { return record("["); }
+    bool onArrayEnd() override { return record("]"); }
+    bool onKey(std::string_view key) override { return record("k:" + std::string(key)); }
+    bool onString(std::string_view value) override { return record("s:" + std::string(value)); }
+    bool onNumber(std::string_view text) override { return record("n:" + std::string(text)); }
+    bool onBool(bool value) override { return record(value ? "true" : "false"); }
+    bool onNull() override { return record("null"); }
+
+    std::string joined() const {
+        std::string out;
+        for (const auto& event : events) {
+            if (!out.empty()) out += ' ';
+            out += event;
+        }
+        return out;
+    }
+
+private:
+    bool record(std::string event) {
+        events.push_back(std::move(event));
+        return events.size() < abort_after;
+    }
+};
+
+// 解析成功时返回事件文本，失败时返回 "ERROR"
+std::string events(const std::string& json, size_t max_depth = 64) {
+    JsonSaxParser parser(max_depth);
+    RecordingHandler handler;
+    if (!parser.parse(json, handler)) {
+        return "ERROR";
+    }
+    return handler.joined();
+}
+
+// 格式错误的输入：返回错误原因，解析成功时返回空串
+std::string errorOf(const std::string& json, size_t* offset = nullptr) {
+    JsonSaxParser parser;
+    RecordingHandler handler;
+    if (parser.parse(json, handler)) {
+        return "";
+    }
+    if (offset) *offset = parser.getErrorOffset();
+    return parser.getError();
+}
+
+void testEventSequence() {
+    EXPECT_EQ(events("{\"manager_id\":\"m1\",\"items\":[1,-2.5,3e+2,true,false,null],\"empty\":{},\"list\":[]}"),
+              std::string("{ k:manager_id s:m1 k:items [ n:1 n:-2.5 n:3e+2 true false null ] "
+                          "k:empty { } k:list [ ] }"));
+    EXPECT_EQ(events(" \t\r\n[ { \"a\" : [ [ ] ] } ] \n"), std::string("[ { k:a [ [ ] ] } ]"));
+
+    // 顶层可以是任意值
+    EXPECT_EQ(events("\"text\""), std::string("s:text"));
+    EXPECT_EQ(events("0"), std::string("n:0"));
+    EXPECT_EQ(events("null"), std::string("null"));
+
+    // 重复键按原样交给处理器
+    EXPECT_EQ(events("{\"a\":1,\"a\":2}"), std::string("{ k:a n:1 k:a n:2 }"));
+}
+
+void testStringEscapes() {
+    EXPECT_EQ(events("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\""), std::string("s:a\"b\\c/d\b\f\n\r\t"));
+    EXPECT_EQ(events("\"\\u0041\\u00e9\\u4e2d\""), std::string("s:A\xC3\xA9\xE4\xB8\xAD"));
+    EXPECT_EQ(events("\"\\uD83D\\uDE00\""), std::string("s:\xF0\x9F\x98\x80"));     // 代理对
+    EXPECT_EQ(events("\"\\u0000\""), std::string("s:") + std::string(1, '\0'));
+    EXPECT_EQ(events("\"中文 原样\""), std::string("s:中文 原样"));
+
+    // 转义字符串解码到复用缓冲区：前一个值不能被后一个值覆盖
+    EXPECT_EQ(events("[\"x\\ny\",\"plain\",\"\\tz\"]"), std::string("[ s:x\ny s:plain s:\tz ]"));
+    EXPECT_EQ(events("{\"k\\u0031\":\"v\\u0032\"}"), std::string("{ k:k1 s:v2 }"));
+}
+
+void testNumbers() {
+    const char* valid[] = { "0", "-0", "12", "-12", "0.5", "1.25e10", "1E-3", "-0.0e+0", "123456789012345678901234" };
+    for (const char* text : valid) {
+        EXPECT_EQ(events(text), "n:" + std::string(text));
+    }
+
+    const char* invalid[] = { "01", "-", "+1", ".5", "1.", "1e", "1e+", "0x10", "1.2.3", "--1", "- 1" };
+    for (const char* text : invalid) {
+        EXPECT_EQ(events(text), std::string("ERROR"));
+    }
+}
+
+void testMaxDepth() {
+    std::string nested_ok = std::string(4, '[') + std::string(4, ']');
+    EXPECT_EQ(events(nested_ok, 4), std::string("[ [ [ [ ] ] ] ]"));
+
+    std::string too_deep = std::string(5, '[') + std::string(5, ']');
+    JsonSaxParser parser(4);
+    RecordingHandler handler;
+    EXPECT_TRUE(!parser.parse(too_deep, handler));
+    EXPECT_EQ(parser.getError(), std::string("Nesting too deep"));
+    EXPECT_EQ(parser.getErrorOffset(), 4u);
+
+    // 默认深度下深层嵌套不能耗尽栈
+    std::string hostile(100000, '[');
+    EXPECT_EQ(errorOf(hostile), std::string("Nesting too deep"));
+    std::string objects;
+    for (int i = 0; i < 100; ++i) objects += "{\"a\":";
+    EXPECT_EQ(errorOf(objects), std::string("Nesting too deep"));
+}
+
+void testHandlerAbort() {
+    std::string json = "{\"a\":[1,2,3],\"b\":\"x\\ny\",\"c\":true}";
+    size_t total = 0;
+    {
+        JsonSaxParser parser;
+        RecordingHandler handler;
+        EXPECT_TRUE(parser.parse(json, handler));
+        total = handler.events.size();
+    }
+    // 每个回调位置中止都要立即停止，不再产生后续事件
+    for (size_t n = 1; n <= total; ++n) {
+        JsonSaxParser parser;
+        RecordingHandler handler;
+        handler.abort_after = n;
+        bool ok = parser.parse(json, handler);
+        EXPECT_TRUE(!ok);
+        EXPECT_EQ(handler.events.size(), n);
+        EXPECT_EQ(parser.getError(), std::string("Aborted by handler"));
+    }
+}
+
+void testMalformed() {
+    EXPECT_EQ(errorOf(""), std::string("Unexpected end of input"));
+    EXPECT_EQ(errorOf("   "), std::string("Unexpected end of input"));
+    EXPECT_EQ(errorOf("{\"a\":1} x"), std::string("Unexpected trailing characters"));
+    EXPECT_EQ(errorOf("[1] [2]"), std::string("Unexpected trailing characters"));
+
+    // 对象和数组
+    EXPECT_EQ(errorOf("{"), std::string("Expected object key"));
+    EXPECT_EQ(errorOf("{a:1}"), std::string("Expected object key"));
+    EXPECT_EQ(errorOf("{\"a\":1,}"), std::string("Expected object key"));
+    EXPECT_EQ(errorOf("{\"a\" 1}"), std::string("Expected ':' after object key"));
+    EXPECT_EQ(errorOf("{\"a\":1"), std::string("Unterminated object"));
+    EXPECT_EQ(errorOf("{\"a\":1 \"b\":2}"), std::string("Expected ',' or '}' in object"));
+    EXPECT_EQ(errorOf("[1,2"), std::string("Unterminated array"));
+    EXPECT_EQ(errorOf("[1 2]"), std::string("Expected ',' or ']' in array"));
+    EXPECT_EQ(errorOf("[1,]"), std::string("Invalid value"));
+    EXPECT_EQ(errorOf("[tru]"), std::string("Invalid value"));
+    EXPECT_EQ(errorOf("nul"), std::string("Invalid value"));
+
+    // 字符串
+    EXPECT_EQ(errorOf("\"abc"), std::string("Unterminated string"));
+    EXPECT_EQ(errorOf("\"a\\nbc"), std::string("Unterminated string"));
+    EXPECT_EQ(errorOf("\"a\\"), std::string("Unterminated escape sequence"));
+    EXPECT_EQ(errorOf("\"a\nb\""), std::string("Control character in string"));
+    EXPECT_EQ(errorOf("\"\\x41\""), std::string("Invalid escape sequence"));
+    EXPECT_EQ(errorOf("\"\\u12\""), std::string("Invalid \\u escape"));
+    EXPECT_EQ(errorOf("\"\\u12G4\""), std::string("Invalid \\u escape"));
+    EXPECT_EQ(errorOf("\"\\uD83D\""), std::string("Unpaired surrogate in \\u escape"));
+    EXPECT_EQ(errorOf("\"\\uD83Dx\""), std::string("Unpaired surrogate in \\u escape"));
+    EXPECT_EQ(errorOf("\"\\uDE00\""), std::string("Unpaired surrogate in \\u escape"));
+    EXPECT_EQ(errorOf("\"\\uD83D\\u0041\""), std::string("Invalid surrogate pair in \\u escape"));
+
+    // 错误位置指向出错的字符
+    size_t offset = 0;
+    errorOf("[1, 2, x]", &offset);
+    EXPECT_EQ(offset, 7u);
+    errorOf("{\"a\":1}  !", &offset);
+    EXPECT_EQ(offset, 9u);
+
+    // 解析器可以复用：前一次的错误不影响下一次
+    JsonSaxParser parser;
+    RecordingHandler handler;
+    EXPECT_TRUE(!parser.parse("[", handler));
+    EXPECT_TRUE(parser.parse("[]", handler));
+    EXPECT_TRUE(parser.getError().empty());
+}
+
+void testRandomInput() {
+    // 随机截断和随机字节都不能越界或崩溃（由 ASan 构建发现）
+    std::string json = "{\"trans_id\":\"T\\u00e91\",\"quantity\":-12.5e3,\"tags\":[true,null,\"\\uD83D\\uDE00\"]}";
+    for (size_t size = 0; size < json.size(); ++size) {
+        EXPECT_EQ(events(json.substr(0, size)), std::string("ERROR"));
+    }
+
+    std::mt19937 rng(5);
+    const std::string alphabet = "{}[]\":,\\u0123456789abcdefDE-+.eEtrunlsx \n";
+    for (int n = 0; n < 5000; ++n) {
+        std::string junk(rng() % 48, ' ');
+        for (auto& c : junk) {
+            c = rng() % 8 == 0 ? static_cast<char>(rng()) : alphabet[rng() % alphabet.size()];
+        }
+        JsonSaxParser parser;
+        RecordingHandler handler;
+        if (!parser.parse(junk, handler)) {
+            EXPECT_TRUE(!parser.getError().empty() && parser.getErrorOffset() <= junk.size());
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testEventSequence);
+    RUN_TEST(testStringEscapes);
+    RUN_TEST(testNumbers);
+    RUN_TEST(testMaxDepth);
+    RUN_TEST(testHandlerAbort);
+    RUN_TEST(testMalformed);
+    RUN_TEST(testRandomInput);
+    return unit_test::report("json_sax_parser_test");
+}
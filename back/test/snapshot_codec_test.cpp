@@ -0,0 +1,213 @@
+// 列式快照编解码的单元测试：LZ压缩、数据块往返、校验和与损坏输入
+#include "unit_test.h"
+#include "columnar_snapshot.h"
+#include <random>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+namespace {
+
+bool sameRecord(const TransactionRecord& a, const TransactionRecord& b) {
+    return a.trans_id == b.trans_id && a.item_id == b.item_id && a.item_name == b.item_name &&
+           a.type == b.type && a.quantity == b.quantity && a.timestamp == b.timestamp &&
+           a.manager_id == b.manager_id && a.note == b.note && a.category == b.category &&
+           a.model == b.model && a.unit == b.unit && a.unit_price == b.unit_price &&
+           a.partner_id == b.partner_id && a.partner_name == b.partner_name &&
+           a.warehouse_id == b.warehouse_id && a.document_no == b.document_no;
+}
+
+// 覆盖各种编码分支：重复字符串、多种时间格式、无法差分的时间戳、非整分的单价
+std::vector<TransactionRecord> makeRecords(size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<TransactionRecord> records;
+    for (size_t i = 0; i < count; ++i) {
+        TransactionRecord trans;
+        trans.trans_id = "TXN" + std::to_string(100000 + i);
+        trans.item_id = "ITEM" + std::to_string(rng() % 50);
+        trans.item_name = "物品" + trans.item_id;
+        trans.type = rng() % 2 ? "in" : "out";
+        trans.quantity = static_cast<int>(rng() % 1000) + 1;
+
+        char timestamp[32];
+        unsigned month = 1 + rng() % 12, day = 1 + rng() % 28, hour = rng() % 24;
+        unsigned minute = rng() % 60, second = rng() % 60, millis = rng() % 1000;
+        std::snprintf(timestamp, sizeof(timestamp), "2024-%02u-%02uT%02u:%02u:%02u.%03uZ",
+                      month, day, hour, minute, second, millis);
+        trans.timestamp = timestamp;
+        if (i % 7 == 0) trans.timestamp = "2024-01-15T10:30:00";
+        if (i % 11 == 0) trans.timestamp = "not a timestamp";
+
+        trans.manager_id = "m1";
+        trans.note = i % 3 ? "" : "备注 \"quoted\"";
+        trans.category = "C" + std::to_string(rng() % 5);
+        trans.unit = "个";
+        trans.unit_price = (rng() % 100000) / 100.0;
+        if (i % 13 == 0) trans.unit_price = 1.0 / 3;
+        trans.partner_id = "P" + std::to_string(rng() % 9);
+        trans.warehouse_id = "WH" + std::to_string(rng() % 3);
+        trans.document_no = "DOC" + std::to_string(i / 4);
+        records.push_back(trans);
+    }
+    return records;
+}
+
+void testLzRoundTrip() {
+    std::vector<std::vector<uint8_t>> inputs;
+    inputs.push_back({});
+    inputs.push_back({ 42 });
+    inputs.push_back(std::vector<uint8_t>(100000, 'a'));         // 长重复（重叠匹配）
+
+    std::mt19937 rng(7);
+    for (int n = 0; n < 20; ++n) {
+        std::vector<uint8_t> data(rng() % 70000);
+        for (auto& byte : data) {
+            byte = rng() % 4 == 0 ? static_cast<uint8_t>(rng()) : static_cast<uint8_t>("abcabcabd"[rng() % 9]);
+        }
+        inputs.push_back(data);
+    }
+
+    for (const auto& input : inputs) {
+        auto compressed = ColumnarSnapshot::lzCompress(input.data(), input.size());
+        std::vector<uint8_t> output;
+        EXPECT_TRUE(ColumnarSnapshot::lzDecompress(compressed.data(), compressed.size(), input.size(), output));
+        EXPECT_TRUE(output == input);
+    }
+
+    auto repeated = std::vector<uint8_t>(100000, 'a');
+    EXPECT_TRUE(ColumnarSnapshot::lzCompress(repeated.data(), repeated.size()).size() < 1000);
+}
+
+void testLzMalformed() {
+    std::string text = "warehouse warehouse warehouse management management system";
+    std::vector<uint8_t> input(text.begin(), text.end());
+    auto compressed = ColumnarSnapshot::lzCompress(input.data(), input.size());
+    std::vector<uint8_t> output;
+
+    // 声明的原始长度不符
+    EXPECT_TRUE(!ColumnarSnapshot::lzDecompress(compressed.data(), compressed.size(), input.size() - 1, output));
+    EXPECT_TRUE(!ColumnarSnapshot::lzDecompress(compressed.data(), compressed.size(), input.size() + 1, output));
+
+    // 截断在任意位置都必须失败
+    for (size_t size = 0; size < compressed.size(); ++size) {
+        EXPECT_TRUE(!ColumnarSnapshot::lzDecompress(compressed.data(), size, input.size(), output));
+    }
+
+    // 指向输出之前的匹配偏移
+    std::vector<uint8_t> bad_offset = { 0x10, 'x', 0x05, 0x00 };
+    EXPECT_TRUE(!ColumnarSnapshot::lzDecompress(bad_offset.data(), bad_offset.size(), 5, output));
+
+    // 随机输入不能越界（由 ASan 构建发现）
+    std::mt19937 rng(11);
+    for (int n = 0; n < 2000; ++n) {
+        std::vector<uint8_t> junk(rng() % 64);
+        for (auto& byte : junk) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        ColumnarSnapshot::lzDecompress(junk.data(), junk.size(), rng() % 256, output);
+    }
+}
+
+void testBlockRoundTrip() {
+    for (size_t count : { 0, 1, 5, 1000, 20000 }) {
+        for (bool compress : { false, true }) {
+            auto records = makeRecords(count, static_cast<unsigned>(count));
+            auto block = ColumnarSnapshot::encodeBlock("m1", 7, records.data(), records.size(), compress);
+
+            ColumnarSnapshot::BlockInfo info;
+            EXPECT_TRUE(ColumnarSnapshot::parseBlock(block.data(), block.size(), info));
+            EXPECT_EQ(info.manager_id, std::string("m1"));
+            EXPECT_EQ(info.base_count, 7u);
+            EXPECT_EQ(info.record_count, count);
+            EXPECT_EQ(info.block_size, block.size());
+
+            std::vector<TransactionRecord> decoded;
+            EXPECT_TRUE(ColumnarSnapshot::decodeBlock(info, decoded));
+            EXPECT_EQ(decoded.size(), records.size());
+            bool same = decoded.size() == records.size();
+            for (size_t i = 0; same && i < records.size(); ++i) {
+                same = sameRecord(decoded[i], records[i]);
+            }
+            EXPECT_TRUE(same);
+        }
+    }
+}
+
+void testBlockCorruption() {
+    auto records = makeRecords(500, 3);
+    for (bool compress : { false, true }) {
+        auto block = ColumnarSnapshot::encodeBlock("m1", 0, records.data(), records.size(), compress);
+
+        // 截断的块头或列数据
+        ColumnarSnapshot::BlockInfo info;
+        EXPECT_TRUE(!ColumnarSnapshot::parseBlock(block.data(), 0, info));
+        EXPECT_TRUE(!ColumnarSnapshot::parseBlock(block.data(), 16, info));
+        EXPECT_TRUE(!ColumnarSnapshot::parseBlock(block.data(), block.size() - 1, info));
+
+        // 魔数错误
+        auto bad_magic = block;
+        bad_magic[0] ^= 0xFF;
+        EXPECT_TRUE(!ColumnarSnapshot::parseBlock(bad_magic.data(), bad_magic.size(), info));
+
+        // 任意位置的单字节翻转：块头校验失败，或列校验和在解码时失败
+        size_t detected = 0;
+        size_t flips = 0;
+        for (size_t pos = 0; pos < block.size(); pos += 1 + block.size() / 300) {
+            auto flipped = block;
+            flipped[pos] ^= 0x01;
+            flips++;
+            ColumnarSnapshot::BlockInfo flipped_info;
+            std::vector<TransactionRecord> decoded;
+            if (!ColumnarSnapshot::parseBlock(flipped.data(), flipped.size(), flipped_info) ||
+                !ColumnarSnapshot::decodeBlock(flipped_info, decoded)) {
+                detected++;
+            }
+        }
+        EXPECT_EQ(detected, flips);
+    }
+}
+
+void testCrc32() {
+    std::string check = "123456789";
+    EXPECT_EQ(ColumnarSnapshot::crc32(reinterpret_cast<const uint8_t*>(check.data()), check.size()), 0xCBF43926u);
+    EXPECT_EQ(ColumnarSnapshot::crc32(nullptr, 0), 0u);
+}
+
+void testTimestamps() {
+    const char* valid[] = {
+        "2024-01-15T10:30:00", "2024-01-15T10:30:00Z", "2024-02-29T23:59:59.999Z",
+        "1969-12-31T23:59:59.001", "1970-01-01T00:00:00Z"
+    };
+    for (const char* text : valid) {
+        int64_t epoch_ms = 0;
+        uint8_t format = 0;
+        EXPECT_TRUE(ColumnarSnapshot::parseTimestamp(text, epoch_ms, format));
+        EXPECT_EQ(ColumnarSnapshot::formatTimestamp(epoch_ms, format), std::string(text));
+    }
+
+    int64_t epoch_ms = 0;
+    uint8_t format = 0;
+    EXPECT_TRUE(ColumnarSnapshot::parseTimestamp("1970-01-01T00:00:01Z", epoch_ms, format));
+    EXPECT_EQ(epoch_ms, 1000);
+
+    // 无法无损还原的输入必须拒绝，由字典编码保存原文
+    const char* invalid[] = {
+        "", "2024-13-01T00:00:00", "2024-02-30T00:00:00", "2024-01-15 10:30:00",
+        "2024-01-15T10:30:00X", "2024-01-15T10:30:00.12Z", "２０２４-01-15T10:30:00"
+    };
+    for (const char* text : invalid) {
+        EXPECT_TRUE(!ColumnarSnapshot::parseTimestamp(text, epoch_ms, format));
+    }
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testLzRoundTrip);
+    RUN_TEST(testLzMalformed);
+    RUN_TEST(testBlockRoundTrip);
+    RUN_TEST(testBlockCorruption);
+    RUN_TEST(testCrc32);
+    RUN_TEST(testTimestamps);
+    return unit_test::report("snapshot_codec_test");
+}
@@ -0,0 +1,50 @@
+#ifndef UNIT_TEST_H
+#define UNIT_TEST_H
+
+#include <iostream>
+#include <string>
+
+// 单元测试的最小断言工具：失败时打印位置并计数，不中断后续检查
+// 每个测试程序在 main 末尾返回 unit_test::report()，由 ctest 根据退出码判断结果
+
+namespace unit_test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int& checks() {
+    static int count = 0;
+    return count;
+}
+
+inline int report(const std::string& suite) {
+    if (failures() == 0) {
+        std::cout << "✅ " << suite << ": " << checks() << " 项检查全部通过" << std::endl;
+        return 0;
+    }
+    std::cout << "❌ " << suite << ": " << failures() << "/" << checks() << " 项检查失败" << std::endl;
+    return 1;
+}
+
+} // namespace unit_test
+
+#define EXPECT_TRUE(cond) \
+    do { \
+        unit_test::checks()++; \
+        if (!(cond)) { \
+            unit_test::failures()++; \
+            std::cout << "  ❌ " << __FILE__ << ":" << __LINE__ << ": " << #cond << std::endl; \
+        } \
+    } while (0)
+
+#define EXPECT_EQ(a, b) EXPECT_TRUE((a) == (b))
+
+#define RUN_TEST(test) \
+    do { \
+        std::cout << "🧪 " << #test << std::endl; \
+        test(); \
+    } while (0)
+
+#endif // UNIT_TEST_H
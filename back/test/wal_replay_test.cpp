@@ -0,0 +1,153 @@
+// WAL回放的单元测试：坏记录隔离、隔离标记后不重复隔离、中断的最后一行、按段跳过已快照的WAL
+#include "unit_test.h"
+#include "persistence.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+std::string testDir() {
+    return (std::filesystem::temp_directory_path() / ("wal_replay_test_" + std::to_string(getpid()))).string();
+}
+
+TransactionRecord makeRecord(const std::string& trans_id, int quantity) {
+    TransactionRecord trans;
+    trans.trans_id = trans_id;
+    trans.item_id = "ITEM1";
+    trans.item_name = "物品";
+    trans.type = "in";
+    trans.quantity = quantity;
+    trans.unit_price = 2.5;
+    trans.warehouse_id = "WH1";
+    trans.note = "备注";
+    return trans;
+}
+
+struct Replayed {
+    PersistenceManager::ReplayStats stats;
+    std::vector<std::string> trans_ids;
+};
+
+Replayed replay(const std::string& dir, uint64_t after_segment) {
+    PersistenceManager persistence(dir);
+    Replayed result;
+    result.stats = persistence.replayWAL(after_segment, [&result](const std::string& manager_id, TransactionRecord&& trans) {
+        result.trans_ids.push_back(manager_id + "/" + trans.trans_id);
+    });
+    return result;
+}
+
+std::vector<std::string> readLines(const std::string& path) {
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+void testQuarantine() {
+    std::string dir = testDir();
+    std::filesystem::remove_all(dir);
+
+    // 一个已封存的段和当前WAL
+    {
+        PersistenceManager persistence(dir);
+        for (int i = 0; i < 5; ++i) {
+            EXPECT_TRUE(persistence.writeToWAL("m1", makeRecord("A" + std::to_string(i), i + 1)));
+        }
+        EXPECT_EQ(persistence.sealWAL(), 1u);
+        for (int i = 0; i < 3; ++i) {
+            EXPECT_TRUE(persistence.writeToWAL("m2", makeRecord("B" + std::to_string(i), i + 1)));
+        }
+    }
+
+    // 追加坏记录，夹着通过校验的记录；最后一行模拟写入中断，没有换行符
+    {
+        std::ofstream wal(dir + "/current.wal", std::ios::app);
+        wal << "garbage line\n";
+        wal << "2090-01-01 00:00:00|m1|X1|ITEM1|n|in|0|1.00|c|m|u|p|pn|WH1|D|数量非法\n";
+        wal << "2090-01-01 00:00:00|m2|X2|ITEM1|n|sideways|3|1.00|c|m|u|p|pn|WH1|D|类型非法\n";
+        wal << "2090-01-01 00:00:00|m1|X3|ITEM1|n|in|99999999999|1.00|c|m|u|p|pn|WH1|D|数量溢出\n";
+        wal << "1999-01-01 00:00:00|m1|C1|ITEM1|n|in|3|1.00|c|m|u|p|pn|WH1|D|时钟回拨\n";
+        wal << "2099-01-01 00:00:00|m1|C2|ITEM1|n|out|2|1.00|c|m|u|p|pn|WH1|D|\n";
+        wal << "2099-01-01 00:00:00|m1|X4|ITEM1|n";
+    }
+
+    auto first = replay(dir, 0);
+    EXPECT_EQ(first.stats.replayed, 10u);
+    EXPECT_EQ(first.stats.quarantined, 5u);
+    EXPECT_TRUE(first.trans_ids == std::vector<std::string>({
+        "m1/A0", "m1/A1", "m1/A2", "m1/A3", "m1/A4", "m2/B0", "m2/B1", "m2/B2", "m1/C1", "m1/C2" }));
+
+    // 隔离文件：每条坏记录一行说明加一行原文
+    auto quarantine = readLines(dir + "/wal_quarantine.log");
+    EXPECT_EQ(quarantine.size(), 10u);
+    if (quarantine.size() == 10) {
+        EXPECT_TRUE(quarantine[0].rfind("# current.wal:4 ", 0) == 0);
+        EXPECT_EQ(quarantine[1], std::string("garbage line"));
+        EXPECT_EQ(quarantine[9], std::string("2099-01-01 00:00:00|m1|X4|ITEM1|n"));
+    }
+
+    // 再次回放：已标记的行直接跳过，不重复隔离
+    auto second = replay(dir, 0);
+    EXPECT_EQ(second.stats.replayed, 10u);
+    EXPECT_EQ(second.stats.quarantined, 0u);
+    EXPECT_EQ(readLines(dir + "/wal_quarantine.log").size(), 10u);
+
+    // 中断的最后一行已补上换行，之后追加的记录单独成行
+    {
+        PersistenceManager persistence(dir);
+        EXPECT_TRUE(persistence.writeToWAL("m1", makeRecord("D1", 1)));
+    }
+    auto third = replay(dir, 0);
+    EXPECT_EQ(third.stats.replayed, 11u);
+    EXPECT_EQ(third.stats.quarantined, 0u);
+    EXPECT_TRUE(!third.trans_ids.empty() && third.trans_ids.back() == "m1/D1");
+
+    // 已包含在快照中的段不再回放
+    auto after_snapshot = replay(dir, 1);
+    EXPECT_EQ(after_snapshot.stats.replayed, 6u);
+    EXPECT_TRUE(!after_snapshot.trans_ids.empty() && after_snapshot.trans_ids.front() == "m2/B0");
+
+    std::filesystem::remove_all(dir);
+}
+
+void testRecoverGroupsByManager() {
+    std::string dir = testDir();
+    std::filesystem::remove_all(dir);
+    {
+        PersistenceManager persistence(dir);
+        for (int i = 0; i < 6; ++i) {
+            EXPECT_TRUE(persistence.writeToWAL(i % 2 ? "m1" : "m2", makeRecord("R" + std::to_string(i), i + 1)));
+        }
+    }
+    {
+        PersistenceManager persistence(dir);
+        auto data = persistence.recoverFromWAL();
+        EXPECT_EQ(data.size(), 2u);
+        EXPECT_EQ(data["m1"].size(), 3u);
+        EXPECT_EQ(data["m2"].size(), 3u);
+        if (data["m1"].size() == 3) {
+            const auto& trans = data["m1"][0];
+            EXPECT_EQ(trans.trans_id, std::string("R1"));
+            EXPECT_EQ(trans.quantity, 2);
+            EXPECT_EQ(trans.unit_price, 2.5);
+            EXPECT_EQ(trans.note, std::string("备注"));
+            EXPECT_TRUE(!trans.timestamp.empty());
+        }
+    }
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testQuarantine);
+    RUN_TEST(testRecoverGroupsByManager);
+    return unit_test::report("wal_replay_test");
+}
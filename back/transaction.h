@@ -5,6 +5,8 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <utility>
+#include <cstdint>
 
 // 交易记录结构体 - 唯一的数据源
 struct TransactionRecord {
@@ -77,6 +79,20 @@ struct InventoryRecord {
     InventoryRecord() : quantity(0), avg_price(0.0) {}
 };
 
+// 库存余额表：(warehouse_id, item_id) -> 库存记录
+typedef std::map<std::pair<std::string, std::string>, InventoryRecord> InventoryBalanceMap;
+
+// 库存检查点 - 某个序列位置上的库存余额
+// 库存计算从最近的检查点继续，只需重放其后的交易记录
+struct InventoryCheckpoint {
+    uint64_t position;           // 已包含的交易记录数
+    std::string last_trans_id;   // 位置 position-1 处的交易ID，用于校验检查点与数据一致
+    std::string max_timestamp;   // 已包含记录中最大的时间戳（用于按时间点查询）
+    InventoryBalanceMap balances;
+    
+    InventoryCheckpoint() : position(0) {}
+};
+
 // 单据摘要 - 从交易记录计算得出
 struct DocumentSummary {
     std::string document_no;
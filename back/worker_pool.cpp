@@ -0,0 +1,89 @@
+#include "worker_pool.h"
+#include "logger.h"
+#include "monitoring.h"
+
+WorkerPool::WorkerPool(size_t threads, size_t max_queue, std::chrono::milliseconds max_wait)
+    : max_queue_(max_queue < 1 ? 1 : max_queue), max_wait_(max_wait), stopping_(false) {
+    if (threads < 1) {
+        threads = 1;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&WorkerPool::workerLoop, this);
+    }
+    LOG_INFO("WorkerPool", "constructor", "Started " + std::to_string(threads) + " workers, queue limit " +
+            std::to_string(max_queue_) + ", wait deadline " + std::to_string(max_wait.count()) + "ms");
+}
+
+WorkerPool::~WorkerPool() {
+    shutdown();
+}
+
+bool WorkerPool::submit(Task task) {
+    size_t depth;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || queue_.size() >= max_queue_) {
+            INC_COUNTER("worker_pool_rejected");
+            return false;
+        }
+        queue_.push_back(QueuedTask{std::move(task), std::chrono::steady_clock::now()});
+        depth = queue_.size();
+    }
+    ready_.notify_one();
+    SET_GAUGE("worker_pool_queue_depth", depth);
+    return true;
+}
+
+void WorkerPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    ready_.notify_all();
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+size_t WorkerPool::getQueueDepth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        QueuedTask item;
+        size_t depth;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;     // 已关闭且队列已清空
+            }
+            item = std::move(queue_.front());
+            queue_.pop_front();
+            depth = queue_.size();
+        }
+        SET_GAUGE("worker_pool_queue_depth", depth);
+
+        auto waited = std::chrono::steady_clock::now() - item.enqueued;
+        OBSERVE_HISTOGRAM("worker_pool_queue_wait_time",
+                          std::chrono::duration_cast<std::chrono::microseconds>(waited).count() / 1000.0);
+        bool expired = waited > max_wait_;
+        if (expired) {
+            INC_COUNTER("worker_pool_expired");
+        }
+
+        try {
+            item.task(expired);
+        } catch (const std::exception& e) {
+            LOG_ERROR("WorkerPool", "worker", "Task threw exception: " + std::string(e.what()));
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// 固定大小的工作线程池，队列有上限
+// 队列满时拒绝提交；任务排队超过期限时不再执行业务逻辑，由任务自己快速给出拒绝结果
+class WorkerPool {
+public:
+    // expired 为 true 表示任务在队列中等待超过了期限
+    typedef std::function<void(bool expired)> Task;
+
+    WorkerPool(size_t threads, size_t max_queue, std::chrono::milliseconds max_wait);
+    ~WorkerPool();
+
+    // 提交任务，队列已满或线程池已关闭时返回 false（任务不会执行）
+    bool submit(Task task);
+
+    // 停止接受任务，执行完已排队的任务后回收线程
+    void shutdown();
+
+    size_t getQueueDepth() const;
+    size_t getThreadCount() const { return threads_.size(); }
+
+private:
+    struct QueuedTask {
+        Task task;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    size_t max_queue_;
+    std::chrono::milliseconds max_wait_;
+    std::vector<std::thread> threads_;
+    std::deque<QueuedTask> queue_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_;
+
+    void workerLoop();
+};
+
+#endif // WORKER_POOL_H